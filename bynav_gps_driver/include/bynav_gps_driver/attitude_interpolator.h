@@ -0,0 +1,55 @@
+#ifndef BYNAV_ATTITUDE_INTERPOLATOR_H_
+#define BYNAV_ATTITUDE_INTERPOLATOR_H_
+
+#include <cstdint>
+
+#include <bynav_gps_driver/gps_time_sync.h>
+
+namespace bynav_gps_driver {
+
+// Orientation at any GPS time, slerped between the INS attitude epochs
+// (INSPVA/INSATT) on either side of it. Only the most recent epochs are
+// kept, in a fixed ring.
+class AttitudeInterpolator {
+public:
+  struct Quaternion {
+    double x;
+    double y;
+    double z;
+    double w;
+  };
+
+  enum Result {
+    INTERPOLATED,
+    // No epoch at or after the time yet.
+    PENDING,
+    // Older than every epoch that is still kept.
+    UNAVAILABLE
+  };
+
+  static constexpr size_t CAPACITY = 32;
+
+  // Same convention as tf: rotate about fixed X, then Y, then Z.
+  static Quaternion FromRollPitchYaw(double roll, double pitch, double yaw);
+
+  static Quaternion Slerp(const Quaternion &a, const Quaternion &b, double t);
+
+  // Epochs must arrive in order; older or repeated ones are ignored.
+  void Add(double gps_time, const Quaternion &q);
+
+  Result Lookup(double gps_time, Quaternion &q) const;
+
+  // The newest epoch at or before the time, for when waiting for the next
+  // one takes too long.
+  bool Hold(double gps_time, Quaternion &q) const;
+
+  bool Empty() const { return epochs_.Empty(); }
+
+  void Clear() { epochs_.Clear(); }
+
+private:
+  GpsTimeRing<Quaternion, CAPACITY> epochs_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_ATTITUDE_INTERPOLATOR_H_
@@ -1,6 +1,8 @@
 #ifndef BYNAV_CONNECTION_H_
 #define BYNAV_CONNECTION_H_
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <queue>
 #include <string>
@@ -9,8 +11,13 @@
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 #include <boost/circular_buffer.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
-#include <swri_serial_util/serial_port.h>
+#include <rclcpp/rclcpp.hpp>
+
+#include <bynav_gps_driver/command_channel.h>
+#include <bynav_gps_driver/config_snapshot.h>
 
 namespace bynav_gps_driver {
 
@@ -32,23 +39,97 @@ public:
   BynavConnection();
   virtual ~BynavConnection();
 
+  // Opens the device and configures it. Listening for a network peer gives
+  // up after DEFAULT_CONNECT_TIMEOUT_MS.
   bool Connect(const std::string &device, ConnectionType connection,
                BynavMessageOpts const &opts);
 
+  // Only opens the device, waiting at most timeout_ms for a TCP connection,
+  // a client or the first UDP datagram, so the caller stays responsive.
+  // Call Configure() once it succeeds.
+  bool Open(const std::string &device, ConnectionType connection,
+            int32_t timeout_ms);
+
+  // True if the last Open() timed out listening for a client, which is not
+  // an error.
+  bool WaitingForPeer() const { return waiting_for_peer_; }
+
   void Disconnect();
 
   std::string ErrorMsg() const { return error_msg_; }
 
   bool IsConnected() { return is_connected_; }
 
+  // Descriptor of the open device, for callers that wait on several devices
+  // at once; -1 if there is none.
+  int NativeHandle();
+
   static ConnectionType ParseConnection(const std::string &connection);
 
   void SetSerialBaud(int32_t serial_baud);
 
+  // Before configuring a serial receiver, find the baud rate its port is
+  // currently at and move it to the configured rate with SERIALCONFIG.
+  // receiver_port names the port on the receiver side, e.g. COM1.
+  void SetAutoBaud(bool enable,
+                   const std::string &receiver_port = "THISPORT");
+
+  // Baud rate the serial port was last opened at.
+  int32_t ActiveSerialBaud() const { return active_baud_; }
+
+  // How long ReadData blocks waiting for the device before reporting a
+  // timeout. Reads return as soon as any bytes are available.
+  void SetReadTimeout(int32_t timeout_ms) { read_timeout_ms_ = timeout_ms; }
+
   bool Write(const std::string &command);
 
+  bool Write(const uint8_t *data, size_t size);
+
+  // Queues a command for the receiver; the result is ready once it was
+  // answered, timed out or the connection went away. Responses are picked
+  // up by whichever thread reads from the device.
+  std::shared_future<CommandResult> SendCommand(const std::string &command,
+                                                int32_t timeout_ms = -1);
+
+  // Sends the commands back to back and waits for all of their responses.
+  // Called from the thread that connected, this reads the device itself
+  // while waiting; the bytes are still handed to the parsers afterwards.
+  bool ExecuteCommands(const std::vector<std::string> &commands,
+                       std::vector<CommandResult> *results = nullptr,
+                       int32_t timeout_ms = -1);
+
+  bool ExecuteCommand(const std::string &command, int32_t timeout_ms = -1);
+
+  // How long to wait for each response and how often to send a command
+  // again. A timeout of zero or less doesn't wait for responses at all.
+  void SetCommandTimeout(int32_t timeout_ms, int32_t retries);
+
+  const CommandChannel &Commands() const { return commands_; }
+
+  // Where to keep a snapshot of the last configuration applied to each
+  // device. When the receiver's log list still matches it on connect,
+  // Configure() leaves the receiver alone. Empty disables the cache.
+  void SetConfigSnapshotDir(const std::string &directory) {
+    snapshot_.SetDirectory(directory);
+  }
+
+  // True if the last connect found the receiver already configured.
+  bool ConfigurationSkipped() const { return configuration_skipped_; }
+
   static constexpr uint16_t DEFAULT_TCP_PORT = 3001;
   static constexpr uint16_t DEFAULT_UDP_PORT = 3002;
+  static constexpr int32_t DEFAULT_CONNECT_TIMEOUT_MS = 5000;
+
+  static constexpr int32_t BAUD_PROBE_TIMEOUT_MS = 500;
+  static constexpr int32_t BAUD_SWITCH_DELAY_MS = 200;
+  // Bytes taken per serial read and how long a write may wait for the
+  // driver's transmit buffer to drain.
+  static constexpr size_t SERIAL_READ_SIZE = 4096;
+  static constexpr int32_t SERIAL_WRITE_TIMEOUT_MS = 1000;
+
+  // Granularity of waits for command responses.
+  static constexpr int32_t COMMAND_POLL_MS = 10;
+  static constexpr int32_t LOGLIST_TIMEOUT_MS = 1000;
 
   static constexpr size_t MAX_BUFFER_SIZE = 100;
   static constexpr size_t SYNC_BUFFER_SIZE = 10;
@@ -57,28 +138,114 @@ public:
 
   virtual ReadResult ReadData();
 
+  // Where one read ended in the received data, and when its bytes arrived.
+  // UDP reads carry the kernel's receive time; TCP and serial reads are
+  // stamped from CLOCK_MONOTONIC as soon as poll reports data.
+  struct ReadStamp {
+    size_t end;
+    ros::Time stamp;
+  };
+
+  // Reads like ReadData, but hands the bytes and their read stamps to the
+  // caller instead of leaving them in the internal buffers.
+  ReadResult ReadChunk(std::vector<uint8_t> &data,
+                       std::vector<ReadStamp> &stamps);
+
 protected:
-  bool CreateIpConnection(const std::string &endpoint,
-                          BynavMessageOpts const &opts);
+  bool CreateIpConnection(const std::string &endpoint, int32_t timeout_ms);
 
-  bool CreateSerialConnection(const std::string &device,
-                              BynavMessageOpts const &opts);
+  bool CreateSerialConnection(const std::string &device);
+
+  // Runs the pending asynchronous operation for at most timeout_ms; after
+  // that it is cancelled and false is returned.
+  bool RunIo(int32_t timeout_ms, const bool &done,
+             const std::function<void()> &cancel);
+
+  // Opens the tty raw at 8N1 without flow control.
+  bool OpenSerial(const std::string &device, int32_t baud);
+
+  void CloseSerial();
+
+  bool WriteSerial(const uint8_t *data, size_t size);
+
+  // Appends whatever is available once the port is readable, and when it
+  // became readable.
+  ReadResult ReadSerial(std::vector<uint8_t> &data, int32_t timeout_ms,
+                        ros::Time &stamp);
+
+  // Now on CLOCK_MONOTONIC, mapped onto ROS time with the offset taken when
+  // the link was opened, so clock steps while connected don't move it.
+  ros::Time MonotonicStamp() const;
+
+  // True if a complete, checksummed message arrives within the timeout.
+  bool ProbeSerial(int32_t timeout_ms);
+
+  // Leaves the port open at the detected rate. Returns -1 if the receiver
+  // didn't answer at any rate.
+  int32_t DetectBaud(const std::string &device);
+
+  bool NegotiateBaud(const std::string &device);
+
+  ReadResult ReadDevice(int32_t timeout_ms);
+
+  // Receives one datagram into socket_buffer_ and takes its kernel receive
+  // time if there is one.
+  ssize_t ReceiveDatagram(ros::Time &stamp);
+
+  // Removes bytes from data_buffer_ and keeps read_stamps_ pointing at the
+  // same data.
+  void EraseData(size_t begin, size_t end);
+
+  void ClearData();
+
+  bool WaitForCommands(std::vector<std::shared_future<CommandResult>> &futures);
+
+  // Requests LOGLISTA and returns its body. Must be called from the thread
+  // that connected; the log is taken out of the data left for the parsers.
+  bool QueryLogList(std::string &loglist);
+
+  // Requests a log and takes every complete line starting with flag out of
+  // the received data. With quiet_ms > 0 it keeps collecting until no line
+  // has arrived for that long, for logs that span several lines.
+  bool QueryLog(const std::string &command, const std::string &flag,
+                int32_t quiet_ms, std::vector<std::string> &lines);
 
   ConnectionType connection_;
+  std::string device_;
 
   std::string error_msg_;
 
-  bool is_connected_;
+  std::atomic<bool> is_connected_;
+  bool waiting_for_peer_;
 
   int32_t serial_baud_;
-  swri_serial_util::SerialPort serial_;
+  int32_t active_baud_;
+  bool auto_baud_;
+  std::string receiver_port_;
+  int32_t read_timeout_ms_;
+  int64_t monotonic_offset_ns_;
+  int serial_fd_;
+
+  boost::mutex write_mutex_;
+  // Set by Write, which may run with the command channel locked or on
+  // another thread; the read path disconnects.
+  std::atomic<bool> write_failed_;
+
+  CommandChannel commands_;
+  // The thread that connected owns reads.
+  boost::thread::id io_thread_;
+
+  ConfigSnapshot snapshot_;
+  bool configuration_skipped_;
 
   boost::asio::io_service io_service_;
   boost::asio::ip::tcp::socket tcp_socket_;
+  boost::shared_ptr<boost::asio::ip::tcp::acceptor> tcp_acceptor_;
   boost::shared_ptr<boost::asio::ip::udp::socket> udp_socket_;
   boost::shared_ptr<boost::asio::ip::udp::endpoint> udp_endpoint_;
 
   std::vector<uint8_t> data_buffer_;
+  std::vector<ReadStamp> read_stamps_;
   boost::array<uint8_t, 10000> socket_buffer_;
 };
 
@@ -8,10 +8,12 @@
 
 #include <boost/asio.hpp>
 #include <boost/circular_buffer.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <swri_serial_util/serial_port.h>
 
 #include <bynav_gps_driver/bynav_connection.h>
+#include <bynav_gps_driver/receiver_config.h>
 #include <bynav_gps_msgs/BynavConfig.h>
 
 namespace bynav_gps_driver {
@@ -77,8 +79,49 @@ public:
   BynavControl();
   virtual ~BynavControl() = default;
 
+  // Also seeds the configuration model from the receiver's RXCONFIG, so the
+  // first SetupConfig only sends what actually differs. Skipped when the
+  // receiver was left as it was; the model is kept from the last connect.
+  bool Configure(BynavMessageOpts const &opts) override;
+
+  // Replaces the configuration model with the receiver's RXCONFIG. Must be
+  // called from the thread that reads the device.
+  bool RefreshReceiverConfig();
+
+  // Applies only the settings that differ from what is known of the
+  // receiver, in one batch, and saves them once. Changes are rolled back if
+  // the batch is rejected.
   bool SetupConfig(const bynav_gps_msgs::BynavConfig &conf);
 
+  static std::vector<std::string>
+  ConfigCommands(const bynav_gps_msgs::BynavConfig &conf);
+
+  // Setters called between these only save the configuration once, at the
+  // end.
+  void BeginConfigBatch();
+  bool EndConfigBatch();
+
+  // Seeds the configuration model from an RXCONFIGA log.
+  size_t LoadRxConfig(const std::string &rxconfig) {
+    boost::unique_lock<boost::mutex> lock(receiver_config_mutex_);
+    return receiver_config_.LoadRxConfig(rxconfig);
+  }
+
+  void ClearReceiverConfig() {
+    boost::unique_lock<boost::mutex> lock(receiver_config_mutex_);
+    receiver_config_.Clear();
+  }
+
+  ReceiverConfig GetReceiverConfig() const {
+    boost::unique_lock<boost::mutex> lock(receiver_config_mutex_);
+    return receiver_config_;
+  }
+
+  static constexpr int32_t RXCONFIG_QUIET_MS = 200;
+
+  // Writing flash takes the receiver a while to answer.
+  static constexpr int32_t SAVECONFIG_TIMEOUT_MS = 5000;
+
 protected:
   bool UnlogAll(BYNAV_PORT port);
   bool UnlogAllPorts();
@@ -151,6 +194,25 @@ protected:
   bool StopRecord(BYNAV_PORT port);
   bool StopDiff(BYNAV_PORT port);
   bool Init();
+
+  // Sends a batch of configuration commands and waits for the receiver to
+  // accept all of them. applied is set to the number of leading commands
+  // that may have taken effect.
+  virtual bool SendCommands(const std::vector<std::string> &commands,
+                            size_t &applied);
+
+  void RollbackCommands(const std::vector<std::string> &commands,
+                        size_t applied);
+
+  // Requests RXCONFIGA; one line per setting.
+  virtual bool QueryRxConfig(std::string &rxconfig);
+
+  // The model is seeded on the read thread and applied from the caller of
+  // SetupConfig.
+  mutable boost::mutex receiver_config_mutex_;
+  ReceiverConfig receiver_config_;
+  int32_t config_batch_depth_;
+  bool save_pending_;
 };
 
 } // namespace bynav_gps_driver
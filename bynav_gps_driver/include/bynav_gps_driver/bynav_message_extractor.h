@@ -49,11 +49,14 @@ private:
   static const std::string BYNAV_SENTENCE_FLAG;
   static const std::string BYNAV_ASCII_FLAGS;
   static const std::string BYNAV_MM_FLAG;
+  static const std::string BYNAV_RESPONSE_FLAG;
   static const std::string BYNAV_BINARY_SYNC_BYTES;
   static const std::string BYNAV_ENDLINE;
   static const std::string BYNAV_BINARY_MICRO_SYNC_BYTES;
 
   static constexpr uint32_t BYNAV_CRC32_POLYNOMIAL = 0xEDB88320L;
+  // Set in the message type of binary command responses.
+  static constexpr uint8_t BINARY_RESPONSE_BIT = 0x80;
 
   uint32_t CalculateBlockCRC32(uint32_t ulCount, const uint8_t *ucBuffer);
 
@@ -1,13 +1,15 @@
 #ifndef BYNAV_NMEA_H_
 #define BYNAV_NMEA_H_
 
+#include <atomic>
 #include <map>
-#include <queue>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/circular_buffer.hpp>
+#include <boost/thread.hpp>
 
 #include <swri_serial_util/serial_port.h>
 
@@ -15,16 +17,26 @@
 
 #include <bynav_gps_msgs/BynavCorrectedImuData.h>
 #include <bynav_gps_msgs/BynavPosition.h>
+#include <bynav_gps_msgs/EventPose.h>
 #include <bynav_gps_msgs/Gpgga.h>
 #include <bynav_gps_msgs/Gphdt.h>
 #include <bynav_gps_msgs/Gprmc.h>
+#include <bynav_gps_msgs/ImuArray.h>
+#include <bynav_gps_msgs/InsCov.h>
 #include <bynav_gps_msgs/Inspva.h>
 #include <bynav_gps_msgs/Inspvax.h>
 #include <bynav_gps_msgs/Insstdev.h>
 #include <bynav_gps_msgs/Psrvel.h>
 
+#include <bynav_gps_driver/attitude_interpolator.h>
 #include <bynav_gps_driver/bynav_control.h>
 #include <bynav_gps_driver/bynav_message_extractor.h>
+#include <bynav_gps_driver/clock_model.h>
+#include <bynav_gps_driver/gps_time_sync.h>
+#include <bynav_gps_driver/imu_batcher.h>
+#include <bynav_gps_driver/ins_covariance.h>
+#include <bynav_gps_driver/pose_interpolator.h>
+#include <bynav_gps_driver/shm_refclock.h>
 
 #include <bynav_gps_driver/parsers/bdsephemerisb.h>
 #include <bynav_gps_driver/parsers/bestgnsspos.h>
@@ -41,9 +53,13 @@
 #include <bynav_gps_driver/parsers/gprmc.h>
 #include <bynav_gps_driver/parsers/gpsphemb.h>
 #include <bynav_gps_driver/parsers/heading.h>
+#include <bynav_gps_driver/parsers/insatt.h>
+#include <bynav_gps_driver/parsers/inscov.h>
 #include <bynav_gps_driver/parsers/inspva.h>
 #include <bynav_gps_driver/parsers/inspvax.h>
 #include <bynav_gps_driver/parsers/insstdev.h>
+#include <bynav_gps_driver/parsers/mark2time.h>
+#include <bynav_gps_driver/parsers/marktime.h>
 #include <bynav_gps_driver/parsers/ptnlpjk.h>
 #include <bynav_gps_driver/parsers/qzssephemerisb.h>
 #include <bynav_gps_driver/parsers/rangecmpb.h>
@@ -60,10 +76,10 @@ public:
   using BynavConnection::ReadResult;
 
   BynavNmea();
-  virtual ~BynavNmea() = default;
+  virtual ~BynavNmea();
 
-  bool Connect(const std::string &device, ConnectionType connection,
-               BynavMessageOpts const &opts);
+  // Adds the default logs unless they were turned off.
+  bool Configure(BynavMessageOpts const &opts) override;
 
   void GetFixMessages(std::vector<gps_msgs::msg::GPSFixPtr> &fix_messages);
 
@@ -79,7 +95,10 @@ public:
 
   void GetGpdopMessages(std::vector<bynav_gps_msgs::GpdopPtr> &gpdop_messages);
 
-  void GetImuMessages(std::vector<sensor_msgs::msg::ImuPtr> &imu_messages);
+  // IMU messages are built here and handed over, not shared, so they can be
+  // published without a copy.
+  void GetImuMessages(
+      std::vector<std::unique_ptr<sensor_msgs::msg::Imu>> &imu_messages);
 
   void
   GetInspvaMessages(std::vector<bynav_gps_msgs::InspvaPtr> &inspva_messages);
@@ -90,11 +109,19 @@ public:
   void GetInsstdevMessages(
       std::vector<bynav_gps_msgs::InsstdevPtr> &insstdev_messages);
 
+  void
+  GetInscovMessages(std::vector<bynav_gps_msgs::InsCovPtr> &inscov_messages);
+
   void GetBynavCorrectedImuData(
       std::vector<bynav_gps_msgs::BynavCorrectedImuDataPtr> &imu_messages);
 
   void GetRawImuData(std::vector<bynav_gps_msgs::RawIMUPtr> &imu_messages);
 
+  void GetImuArrays(
+      std::vector<std::unique_ptr<bynav_gps_msgs::ImuArray>> &imu_arrays);
+
+  void GetEventPoses(std::vector<bynav_gps_msgs::EventPosePtr> &event_poses);
+
   void
   GetBynavPositions(std::vector<bynav_gps_msgs::BynavPositionPtr> &positions);
 
@@ -126,14 +153,139 @@ public:
 
   ReadResult ProcessData();
 
+  // Frames and parses bytes that were read elsewhere, e.g. by a separate
+  // I/O thread through ReadChunk().
+  ReadResult ParseData(const uint8_t *data, size_t size,
+                       const ros::Time &stamp);
+
+  // Same, for bytes from several reads; each read's frames get its stamp.
+  ReadResult ParseData(const uint8_t *data, size_t size,
+                       const std::vector<ReadStamp> &stamps);
+
+  const std::string &GetLatestGgaSentence() const {
+    return latest_gga_sentence_;
+  }
+
   void SetImuRate(double imu_rate, bool force = true);
 
+  // Publish an Imu message for every CORRIMUDATA sample, with the
+  // orientation slerped between the INSPVA/INSATT epochs around it, instead
+  // of only for samples that line up with an INSPVA. A sample waits for the
+  // next epoch until the IMU stream is max_wait_s past it, then takes the
+  // latest orientation as is.
+  void SetImuInterpolation(bool enable, double max_wait_s);
+
+  // Interpolation mode only: samples published with a held orientation and
+  // samples that had no orientation at all.
+  uint64_t ImuHeldSamples() const { return imu_held_samples_; }
+
+  uint64_t ImuDroppedSamples() const { return imu_dropped_samples_; }
+
+  // Convert RAWIMU/RAWIMUS samples to SI units with the scale factors of
+  // RawImuModel and pack them into ImuArray messages of up to max_samples
+  // samples or max_latency_s. Zero samples turns it off.
+  void SetImuBatching(size_t max_samples, double max_latency_s);
+
+  // Interpolate the INS pose (INSPVA/INSPVAX) at every MARKTIME and
+  // MARK2TIME event and stamp it with the event time in host time. An
+  // event waits for the first INS epoch after it; epochs more than
+  // max_gap_s apart are not interpolated across.
+  void SetEventPoses(bool enable, double max_gap_s);
+
+  // Events published without a pose.
+  uint64_t EventsWithoutPose() const { return events_without_pose_; }
+
+  // The latest INS covariances, for use outside the parsing thread.
+  InsCovariance GetInsCovariance() const {
+    boost::unique_lock<boost::mutex> lock(ins_covariance_mutex_);
+    return ins_covariance_;
+  }
+
+  // Number of worker threads for the bulk lane (raw observations,
+  // ephemerides, GPGSV). With zero workers bulk messages are parsed inline,
+  // after everything else in the same read.
+  void SetBulkWorkers(int32_t workers);
+
+  // Parses the bulk lane on a pool shared with other receivers instead of
+  // our own workers. The service must outlive every read that posts to it.
+  void SetBulkService(boost::asio::io_service *service);
+
+  uint64_t BulkParseFailures() const { return bulk_parse_failures_; }
+
+  // Configure normally adds the logs the driver itself relies on (GGA, RMC,
+  // BESTPOS, ephemerides, ...). Turn this off when the caller manages the
+  // full log set.
+  void SetDefaultLogs(bool enable) { default_logs_ = enable; }
+
+  static void AddDefaultLogs(BynavMessageOpts &opts);
+
+  // Stamp messages from the GPS time in their header, mapped to host time
+  // through a model of the receiver clock, instead of with their arrival
+  // time. Messages keep their arrival stamp until the model has settled.
+  void SetGpsTimeStamps(bool enable) { gps_time_stamps_ = enable; }
+
+  const ClockModel &GetClockModel() const { return clock_model_; }
+
+  // BESTPOS/BESTVEL and CORRIMUDATA/INSPVA pairing used for the GPSFix and
+  // Imu messages.
+  typedef GpsTimeSync<SYNC_BUFFER_SIZE, bynav_gps_msgs::BynavPositionPtr,
+                      bynav_gps_msgs::BynavVelocityPtr>
+      FixSync;
+  typedef GpsTimeSync<MAX_BUFFER_SIZE, bynav_gps_msgs::BynavCorrectedImuDataPtr,
+                      bynav_gps_msgs::InspvaPtr>
+      ImuSync;
+
+  const FixSync &GetFixSync() const { return fix_sync_; }
+
+  const ImuSync &GetImuSync() const { return imu_sync_; }
+
+  // Publish (UTC, host time) samples from the clock model to the NTP SHM
+  // segment of the given unit, at most once per GPS second and only while
+  // the receiver reports fine time. A negative unit turns it off.
+  // leap_seconds is GPS - UTC.
+  // The clock model tracks the least delayed arrivals, so its host times
+  // still include the link's minimum latency (serial framing, USB polling).
+  // offset_s is subtracted from them before publishing to take that out.
+  bool SetShmRefclock(int32_t unit, int32_t leap_seconds,
+                      double offset_s = 0.0);
+
+  const ShmRefclock &GetShmRefclock() const { return shm_refclock_; }
+
   double gpsfix_sync_tol_;
   bool wait_for_sync_;
 
 private:
+  void QueueImuSample(const bynav_gps_msgs::BynavCorrectedImuDataPtr &imu);
+
+  void QueueAttitude(const bynav_gps_msgs::InspvaPtr &inspva);
+
+  void AddAttitude(uint32_t week, double seconds, double roll, double pitch,
+                   double azimuth);
+
+  void AddRawImuSample(const bynav_gps_msgs::RawIMUPtr &imu);
+
+  void AddEventPose(uint32_t week, double seconds, double latitude,
+                    double longitude, double height, double north_velocity,
+                    double east_velocity, double up_velocity, double roll,
+                    double pitch, double azimuth);
+
+  void QueueEvent(const bynav_gps_msgs::MarkTimePtr &mark,
+                  const ros::Time &arrival);
+
+  void ResolveEvents();
+
   void GenerateImuMessages();
 
+  void InterpolateImuMessages();
+
+  void
+  AddImuMessage(const bynav_gps_msgs::BynavCorrectedImuDataPtr &corrimudata,
+                const AttitudeInterpolator::Quaternion &orientation);
+
+  void ParseBulkMessages(const std::vector<BinaryMessage> &binary,
+                         const std::vector<NmeaSentence> &nmea,
+                         const ros::Time &stamp);
+
   BynavNmea::ReadResult
   ParseBinaryMessage(const BinaryMessage &msg,
                      const ros::Time &stamp) noexcept(false);
@@ -150,18 +302,49 @@ private:
   ParseBynavSentence(const BynavSentence &sentence,
                      const ros::Time &stamp) noexcept(false);
 
+  enum TimeQuality { TIME_UNKNOWN, TIME_COARSE, TIME_FINE };
+
+  // Stamp for a message generated at the given GPS time that arrived at
+  // arrival. With learn set the message also feeds the clock model.
+  ros::Time MessageStamp(uint32_t week, double seconds, TimeQuality quality,
+                         const ros::Time &arrival, bool learn);
+
+  ros::Time MessageStamp(const BinaryMessage &msg, const ros::Time &arrival,
+                         bool learn);
+
+  ros::Time MessageStamp(const BinaryMicroMessage &msg,
+                         const ros::Time &arrival, bool learn);
+
+  ros::Time MessageStamp(const BynavSentence &sentence,
+                         const ros::Time &arrival, bool learn);
+
   static constexpr uint32_t SECONDS_PER_WEEK = 604800;
+  // Binary time status from COARSE up means the receiver knows GPS time.
+  static constexpr uint8_t TIME_STATUS_COARSE = 100;
+  // FINE, FINEBACKUPSTEERING, FINESTEERING and SATTIME.
+  static constexpr uint8_t TIME_STATUS_FINE = 160;
+  // Seconds from the Unix epoch to the GPS epoch.
+  static constexpr double GPS_EPOCH_UNIX = 315964800.0;
   static constexpr double IMU_TOLERANCE_S = 0.0002;
   static constexpr double DEGREES_TO_RADIANS = M_PI / 180.0;
+  // At 30 Hz triggers and a 100 Hz INS, events wait about 10 ms each.
+  static constexpr size_t EVENT_QUEUE_SIZE = 32;
 
   bool imu_rate_forced_;
   bool enable_imu_;
   bool use_micro_imu_msg_;
 
-  double utc_offset_;
+  bool gps_time_stamps_;
+  ClockModel clock_model_;
+  ShmRefclock shm_refclock_;
+  int32_t leap_seconds_;
+  double refclock_offset_s_;
+  int64_t refclock_second_;
 
   std::string nmea_buffer_;
 
+  std::string latest_gga_sentence_;
+
   BynavMessageExtractor extractor_;
 
   BestposParser bestpos_parser_;
@@ -175,9 +358,13 @@ private:
   GpgsvParser gpgsv_parser_;
   GphdtParser gphdt_parser_;
   GprmcParser gprmc_parser_;
+  InsattParser insatt_parser_;
+  InscovParser inscov_parser_;
   InspvaParser inspva_parser_;
   InspvaxParser inspvax_parser_;
   InsstdevParser insstdev_parser_;
+  MarkTimeParser marktime_parser_;
+  Mark2TimeParser mark2time_parser_;
   GpdopParser gpdop_parser_;
 
   RawIMUSParser rawimus_parser_;
@@ -197,17 +384,16 @@ private:
   boost::circular_buffer<bynav_gps_msgs::GpgsvPtr> gpgsv_msgs_;
   boost::circular_buffer<bynav_gps_msgs::GphdtPtr> gphdt_msgs_;
   boost::circular_buffer<bynav_gps_msgs::GprmcPtr> gprmc_msgs_;
-  boost::circular_buffer<sensor_msgs::msg::ImuPtr> imu_msgs_;
+  boost::circular_buffer<std::unique_ptr<sensor_msgs::msg::Imu>> imu_msgs_;
   boost::circular_buffer<bynav_gps_msgs::InspvaPtr> inspva_msgs_;
   boost::circular_buffer<bynav_gps_msgs::InspvaxPtr> inspvax_msgs_;
   boost::circular_buffer<bynav_gps_msgs::InsstdevPtr> insstdev_msgs_;
+  boost::circular_buffer<bynav_gps_msgs::InsCovPtr> inscov_msgs_;
   boost::circular_buffer<bynav_gps_msgs::BynavPositionPtr> bynav_positions_;
   boost::circular_buffer<bynav_gps_msgs::BynavPositionPtr>
       bynav_gnss_positions_;
   boost::circular_buffer<bynav_gps_msgs::PtnlPJKPtr> bynav_pjk_positions_;
   boost::circular_buffer<bynav_gps_msgs::BynavVelocityPtr> bynav_velocities_;
-  boost::circular_buffer<bynav_gps_msgs::BynavPositionPtr> bestpos_sync_buffer_;
-  boost::circular_buffer<bynav_gps_msgs::BynavVelocityPtr> bestvel_sync_buffer_;
   boost::circular_buffer<bynav_gps_msgs::HeadingPtr> heading_msgs_;
   boost::circular_buffer<bynav_gps_msgs::GpdopPtr> gpdop_msgs_;
   boost::circular_buffer<bynav_gps_msgs::TimePtr> time_msgs_;
@@ -222,10 +408,37 @@ private:
 
   bynav_gps_msgs::GpdopPtr latest_gpdop_;
 
-  std::queue<bynav_gps_msgs::BynavCorrectedImuDataPtr> corrimudata_queue_;
-  std::queue<bynav_gps_msgs::InspvaPtr> inspva_queue_;
-  bynav_gps_msgs::InsstdevPtr latest_insstdev_;
+  FixSync fix_sync_;
+  ImuSync imu_sync_;
+  bool imu_interpolate_;
+  double imu_max_wait_s_;
+  AttitudeInterpolator attitude_;
+  GpsTimeRing<bynav_gps_msgs::BynavCorrectedImuDataPtr, MAX_BUFFER_SIZE>
+      imu_pending_;
+  uint64_t imu_held_samples_;
+  uint64_t imu_dropped_samples_;
+  bool imu_batching_;
+  ImuBatcher imu_batcher_;
+  boost::circular_buffer<std::unique_ptr<bynav_gps_msgs::ImuArray>>
+      imu_arrays_;
+  mutable boost::mutex ins_covariance_mutex_;
+  InsCovariance ins_covariance_;
+  bool event_poses_;
+  PoseInterpolator poses_;
+  GpsTimeRing<bynav_gps_msgs::EventPosePtr, EVENT_QUEUE_SIZE> pending_events_;
+  boost::circular_buffer<bynav_gps_msgs::EventPosePtr> event_pose_msgs_;
+  std::atomic<uint64_t> events_without_pose_;
   double imu_rate_;
+
+  boost::asio::io_service bulk_io_service_;
+  std::unique_ptr<boost::asio::io_service::work> bulk_work_;
+  // Where bulk jobs go: our own service, a shared one, or nowhere to parse
+  // them inline.
+  boost::asio::io_service *bulk_service_;
+  std::vector<boost::thread> bulk_workers_;
+  boost::mutex bulk_mutex_;
+  std::atomic<uint64_t> bulk_parse_failures_;
+  bool default_logs_;
 };
 } // namespace bynav_gps_driver
 
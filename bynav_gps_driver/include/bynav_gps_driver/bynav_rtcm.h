@@ -12,7 +12,8 @@
 #include <swri_serial_util/serial_port.h>
 
 #include <bynav_gps_driver/bynav_connection.h>
-#include <bynav_gps_driver/rtcm_sentence.h>
+#include <bynav_gps_driver/parsers/rtcm.h>
+#include <bynav_gps_driver/rtcm_filter.h>
 
 #include <bynav_gps_msgs/Rtcm.h>
 
@@ -32,12 +33,19 @@ public:
 
   ReadResult ProcessData();
 
+  // Restricts the republished stream to the allowed types; see RtcmFilter.
+  void AllowMessageType(uint16_t type, double min_interval_s = 0.0);
+
+  void ClearMessageFilter();
+
+  std::string BandwidthReport() const { return filter_.BandwidthReport(); }
+
 private:
-  bool ExtractRtcmMessages(const std::string &input,
-                           std::vector<RtcmSentence> &rtcm_sentences,
-                           std::string &remaining);
+  void OnFrame(uint8_t *buf, size_t size, uint16_t id);
 
-  std::string rtcm_buffer_;
+  Rtcm framer_;
+  RtcmFilter filter_;
+  ros::Time frame_stamp_;
 
   boost::circular_buffer<bynav_gps_msgs::RtcmPtr> rtcm_msgs_;
 };
@@ -0,0 +1,99 @@
+#ifndef BYNAV_CLOCK_MODEL_H_
+#define BYNAV_CLOCK_MODEL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/circular_buffer.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace bynav_gps_driver {
+
+// Maps the receiver's GPS time to host time. Every message that carries a
+// GPS time is a sample: it arrived at host(gps) plus some transport latency,
+// and latency is never negative. The model fits host - gps as a line over
+// the recent samples, drops samples that are far off the fit, and then
+// moves the line down to the earliest remaining one. Stamps taken from the
+// model follow the receiver's clock instead of the transport's jitter.
+// A step in either clock starts the fit over.
+class ClockModel {
+public:
+  // Samples are kept for at most this many GPS time slots.
+  static constexpr size_t WINDOW_SIZE = 256;
+  // Only the least delayed sample of each slot is kept, which spreads the
+  // window over enough time to see drift.
+  static constexpr double SLOT_S = 0.1;
+  // Logs of one epoch can arrive interleaved with the next ones, so this
+  // many of the latest slots are searched for a sample's epoch.
+  static constexpr size_t SLOT_SEARCH = 8;
+  static constexpr size_t MIN_SAMPLES = 16;
+  // Residuals up to this much are never treated as outliers.
+  static constexpr double MIN_OUTLIER_S = 0.002;
+  // Samples this far off the model are a clock step once STEP_SAMPLES of
+  // them arrived in a row.
+  static constexpr double STEP_S = 0.5;
+  static constexpr int32_t STEP_SAMPLES = 5;
+  static constexpr double MAX_DRIFT = 500e-6;
+
+  ClockModel();
+
+  void Reset();
+
+  // Returns false if the sample was rejected.
+  bool Update(double gps_time, double host_time);
+
+  // False until enough samples were seen.
+  bool ToHost(double gps_time, double &host_time) const;
+
+  bool Valid() const;
+
+  // host - gps at the latest sample, in seconds.
+  double Offset() const;
+
+  // Host clock rate relative to GPS, in parts per million.
+  double DriftPpm() const;
+
+  // RMS distance of the kept samples from the fit, in seconds.
+  double Jitter() const;
+
+  size_t Samples() const;
+
+  uint32_t Resets() const;
+
+  uint64_t Outliers() const;
+
+private:
+  struct Sample {
+    // GPS time and host - gps, relative to the first sample.
+    double gps;
+    double offset;
+  };
+
+  void Fit();
+
+  double Predict(double gps) const;
+
+  mutable boost::mutex mutex_;
+  boost::circular_buffer<Sample> samples_;
+  bool have_reference_;
+  double reference_gps_;
+  double reference_offset_;
+  double latest_gps_;
+
+  bool valid_;
+  double intercept_;
+  double slope_;
+  double jitter_;
+
+  int32_t step_samples_;
+  uint32_t resets_;
+  uint64_t outliers_;
+
+  // Scratch space for Fit(), kept to avoid allocating on every sample.
+  std::vector<bool> inlier_;
+  std::vector<double> residuals_;
+  std::vector<double> sorted_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_CLOCK_MODEL_H_
@@ -0,0 +1,120 @@
+#ifndef BYNAV_COMMAND_CHANNEL_H_
+#define BYNAV_COMMAND_CHANNEL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+namespace bynav_gps_driver {
+
+struct CommandResult {
+  enum Status {
+    PENDING,
+    OK,
+    ERROR,
+    TIMEOUT,
+    CANCELLED,
+    // Written, but responses are not being tracked.
+    SENT
+  };
+
+  CommandResult() : status(PENDING), attempts(0), latency_ns(0) {}
+
+  bool Ok() const { return status == OK || status == SENT; }
+
+  Status status;
+  std::string command;
+  // The response line without its leading '<', or why there is none.
+  std::string response;
+  int32_t attempts;
+  int64_t latency_ns;
+};
+
+// Pipelines abbreviated ASCII commands to the receiver and matches them with
+// the "<OK" / "<ERROR:..." lines it answers with. The receiver answers the
+// commands it gets on a port in order, so a response always belongs to the
+// oldest command in flight.
+//
+// Commands that time out are sent again together with everything that was
+// pipelined behind them, which keeps their order; only commands that are
+// safe to repeat should be retried.
+class CommandChannel {
+public:
+  typedef std::function<bool(const std::string &)> Sender;
+
+  explicit CommandChannel(const Sender &sender);
+
+  // A timeout of zero or less sends commands without tracking responses.
+  void SetTimeout(int32_t timeout_ms, int32_t retries);
+
+  int32_t Timeout() const { return timeout_ms_; }
+
+  // The command may be given with or without its line ending. A negative
+  // timeout uses the channel's.
+  std::shared_future<CommandResult> Submit(const std::string &command,
+                                           int64_t now_ns,
+                                           int32_t timeout_ms = -1);
+
+  // Scans bytes read from the receiver for responses. Returns how many were
+  // matched to a command.
+  size_t Feed(const uint8_t *data, size_t size, int64_t now_ns);
+
+  // Retries or fails commands whose response is overdue.
+  void Poll(int64_t now_ns);
+
+  // Fails everything not answered yet, e.g. on disconnect.
+  void Cancel(const std::string &reason);
+
+  size_t Pending() const;
+
+  uint64_t Errors() const { return errors_; }
+  uint64_t Timeouts() const { return timeouts_; }
+  // Responses that arrived with no command in flight.
+  uint64_t Unmatched() const { return unmatched_; }
+
+  static constexpr size_t MAX_IN_FLIGHT = 8;
+  static constexpr size_t MAX_RESPONSE_LENGTH = 256;
+
+private:
+  struct Entry {
+    std::string command;
+    int32_t timeout_ms;
+    int64_t submit_ns;
+    int64_t deadline_ns;
+    int32_t attempts;
+    std::shared_ptr<std::promise<CommandResult>> promise;
+  };
+
+  // All of these expect mutex_ to be held.
+  void Dispatch(int64_t now_ns);
+  bool Transmit(Entry &entry, int64_t now_ns);
+  void Resolve(Entry &entry, CommandResult::Status status,
+               const std::string &response, int64_t now_ns);
+  bool HandleResponse(const std::string &line, int64_t now_ns);
+
+  Sender sender_;
+  int32_t timeout_ms_;
+  int32_t retries_;
+
+  mutable boost::mutex mutex_;
+  std::deque<Entry> in_flight_;
+  std::deque<Entry> queued_;
+
+  // Response line framing across reads.
+  bool in_response_;
+  uint8_t last_byte_;
+  std::string line_;
+
+  std::atomic<uint64_t> errors_;
+  std::atomic<uint64_t> timeouts_;
+  std::atomic<uint64_t> unmatched_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_COMMAND_CHANNEL_H_
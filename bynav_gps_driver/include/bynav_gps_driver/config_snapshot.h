@@ -0,0 +1,52 @@
+#ifndef BYNAV_CONFIG_SNAPSHOT_H_
+#define BYNAV_CONFIG_SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bynav_gps_driver {
+
+// Remembers, per device, which set of commands was last applied and what
+// the receiver's log list looked like afterwards. If both still match on the
+// next connect the receiver doesn't need to be configured again.
+class ConfigSnapshot {
+public:
+  struct Entry {
+    Entry() : desired(0), receiver(0) {}
+
+    // Hash of the commands the driver wants applied.
+    uint64_t desired;
+    // Hash of the receiver's LOGLIST body once they were.
+    uint64_t receiver;
+  };
+
+  // An empty directory disables the cache.
+  void SetDirectory(const std::string &directory) { directory_ = directory; }
+
+  bool Enabled() const { return !directory_.empty(); }
+
+  bool Load(const std::string &device, Entry &entry) const;
+
+  // Creates the directory if needed.
+  bool Store(const std::string &device, const Entry &entry) const;
+
+  void Remove(const std::string &device) const;
+
+  std::string FileName(const std::string &device) const;
+
+  // 64-bit FNV-1a; unlike std::hash it is the same in every build, so it
+  // can be kept on disk.
+  static uint64_t Hash(const std::string &text);
+
+  static uint64_t HashCommands(const std::vector<std::string> &commands);
+
+  // $ROS_HOME/bynav_gps_driver, or ~/.ros/bynav_gps_driver.
+  static std::string DefaultDirectory();
+
+private:
+  std::string directory_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_CONFIG_SNAPSHOT_H_
@@ -0,0 +1,153 @@
+#ifndef BYNAV_GEODESY_H_
+#define BYNAV_GEODESY_H_
+
+#include <cmath>
+#include <cstddef>
+
+namespace bynav_gps_driver {
+
+constexpr double DEGREES_TO_RADIANS = M_PI / 180.0;
+
+struct Ellipsoid {
+  constexpr Ellipsoid(double semi_major, double inverse_flattening)
+      : a(semi_major), f(1.0 / inverse_flattening), b(a * (1.0 - f)),
+        e2(f * (2.0 - f)), n(f / (2.0 - f)) {}
+
+  double a;
+  double f;
+  double b;
+  // First eccentricity squared.
+  double e2;
+  // Third flattening.
+  double n;
+};
+
+constexpr Ellipsoid WGS84(6378137.0, 298.257223563);
+// Krassovsky, as used by Beijing 1954 grids.
+constexpr Ellipsoid KRASSOVSKY(6378245.0, 298.3);
+constexpr Ellipsoid CGCS2000(6378137.0, 298.257222101);
+
+// Latitude and longitude in radians, height above the ellipsoid in meters.
+void GeodeticToEcef(double lat, double lon, double height, double ecef[3],
+                    const Ellipsoid &ellipsoid = WGS84);
+
+// Closed form (Vermeille, 2004); sub-millimeter anywhere farther than
+// about 45 km from the earth's center.
+void EcefToGeodetic(const double ecef[3], double &lat, double &lon,
+                    double &height, const Ellipsoid &ellipsoid = WGS84);
+
+// The batch functions take one array per coordinate and work through them
+// in fixed-size blocks with Eigen array expressions, so the arithmetic is
+// vectorized and nothing is allocated. Output arrays may alias the inputs.
+void GeodeticToEcef(size_t count, const double *lat, const double *lon,
+                    const double *height, double *x, double *y, double *z,
+                    const Ellipsoid &ellipsoid = WGS84);
+
+void EcefToGeodetic(size_t count, const double *x, const double *y,
+                    const double *z, double *lat, double *lon, double *height,
+                    const Ellipsoid &ellipsoid = WGS84);
+
+// East-north-up tangent plane at a fixed origin. The origin's ECEF
+// position and the ECEF to ENU rotation are computed once in SetOrigin(),
+// so a conversion costs one sin/cos pair per angle and a 3x3 product.
+class EnuFrame {
+public:
+  explicit EnuFrame(const Ellipsoid &ellipsoid = WGS84);
+
+  // Radians and meters, as for GeodeticToEcef().
+  void SetOrigin(double lat, double lon, double height);
+
+  bool HasOrigin() const { return has_origin_; }
+
+  void Clear() { has_origin_ = false; }
+
+  double OriginLatitude() const { return origin_[0]; }
+
+  double OriginLongitude() const { return origin_[1]; }
+
+  double OriginHeight() const { return origin_[2]; }
+
+  void EcefToEnu(const double ecef[3], double enu[3]) const;
+
+  void EnuToEcef(const double enu[3], double ecef[3]) const;
+
+  void GeodeticToEnu(double lat, double lon, double height,
+                     double enu[3]) const;
+
+  void EnuToGeodetic(const double enu[3], double &lat, double &lon,
+                     double &height) const;
+
+  void GeodeticToEnu(size_t count, const double *lat, const double *lon,
+                     const double *height, double *east, double *north,
+                     double *up) const;
+
+private:
+  Ellipsoid ellipsoid_;
+  bool has_origin_;
+  double origin_[3];
+  double origin_ecef_[3];
+  // Rows are the east, north and up axes in ECEF.
+  double rotation_[3][3];
+};
+
+// Transverse Mercator on any ellipsoid, from Krüger's series to sixth
+// order in the third flattening (Karney, 2011): about 5 nm within 3900 km
+// of the central meridian. Angles are in radians; northing and easting
+// are the receiver's PTNL,PJK x and y.
+class TransverseMercator {
+public:
+  TransverseMercator(const Ellipsoid &ellipsoid, double central_meridian,
+                     double origin_latitude, double false_northing,
+                     double false_easting, double scale);
+
+  // The parameters of SET PJKPARA / BynavControl::SetPJK(): semi-major
+  // axis, inverse flattening, central meridian and origin latitude in
+  // radians, false northing, false easting and scale.
+  static TransverseMercator FromPjk(double a, double alpha, double L0,
+                                    double W0, double FN, double FE,
+                                    double k0 = 1.0);
+
+  // Zones 1 to 60 on WGS-84.
+  static TransverseMercator Utm(int zone, bool north);
+
+  // Standard zone for a longitude in radians, without the Norway and
+  // Svalbard exceptions.
+  static int UtmZone(double lon);
+
+  void Forward(double lat, double lon, double &northing,
+               double &easting) const;
+
+  void Inverse(double northing, double easting, double &lat,
+               double &lon) const;
+
+  // Batched as GeodeticToEcef().
+  void Forward(size_t count, const double *lat, const double *lon,
+               double *northing, double *easting) const;
+
+  void Inverse(size_t count, const double *northing, const double *easting,
+               double *lat, double *lon) const;
+
+private:
+  static constexpr int ORDER = 6;
+
+  template <typename T>
+  void ForwardImpl(const T &lat, const T &lon, T &northing, T &easting) const;
+
+  template <typename T>
+  void InverseImpl(const T &northing, const T &easting, T &lat, T &lon) const;
+
+  double e_;
+  double e2_;
+  double central_meridian_;
+  double false_northing_;
+  double false_easting_;
+  // Scale times the rectifying radius.
+  double k0_a_;
+  // Northing of the origin latitude on the central meridian, unscaled.
+  double xi0_;
+  double alpha_[ORDER];
+  double beta_[ORDER];
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_GEODESY_H_
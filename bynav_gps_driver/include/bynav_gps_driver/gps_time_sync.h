@@ -0,0 +1,233 @@
+#ifndef BYNAV_GPS_TIME_SYNC_H_
+#define BYNAV_GPS_TIME_SYNC_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+namespace bynav_gps_driver {
+
+namespace detail {
+
+// std::index_sequence is C++14; the package is built as C++11.
+template <size_t... Is> struct IndexSequence {};
+
+template <size_t N, size_t... Is>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Is...> {};
+
+template <size_t... Is> struct MakeIndexSequence<0, Is...> {
+  typedef IndexSequence<Is...> type;
+};
+
+} // namespace detail
+
+// Fixed-capacity FIFO of messages and their GPS times. Storage is part of
+// the object, so pushing and popping never allocate.
+template <typename T, size_t Capacity> class GpsTimeRing {
+public:
+  static_assert(Capacity > 0, "GpsTimeRing needs room for one message");
+
+  GpsTimeRing() : head_(0), size_(0) {}
+
+  bool Empty() const { return size_ == 0; }
+
+  bool Full() const { return size_ == Capacity; }
+
+  size_t Size() const { return size_; }
+
+  double FrontTime() const { return times_[head_]; }
+
+  const T &Front() const { return items_[head_]; }
+
+  // Oldest first.
+  double TimeAt(size_t i) const { return times_[(head_ + i) % Capacity]; }
+
+  const T &At(size_t i) const { return items_[(head_ + i) % Capacity]; }
+
+  double BackTime() const { return TimeAt(size_ - 1); }
+
+  // The caller makes room first.
+  void Push(double time, const T &item) {
+    size_t tail = (head_ + size_) % Capacity;
+    items_[tail] = item;
+    times_[tail] = time;
+    size_++;
+  }
+
+  void Pop() {
+    // Let go of the message now rather than when the slot is reused.
+    items_[head_] = T();
+    head_ = (head_ + 1) % Capacity;
+    size_--;
+  }
+
+  void Clear() {
+    while (!Empty()) {
+      Pop();
+    }
+  }
+
+private:
+  std::array<T, Capacity> items_;
+  std::array<double, Capacity> times_;
+  size_t head_;
+  size_t size_;
+};
+
+enum class GpsTimeSyncPolicy {
+  // Messages match when they carry the same GPS millisecond.
+  EXACT,
+  // Messages match when all of them are within the tolerance.
+  APPROXIMATE
+};
+
+// Matches messages from several logs by the GPS week/seconds in their
+// headers, e.g. BESTPOS with BESTVEL or CORRIMUDATA with INSPVA. Each log
+// goes into its own ring of Capacity messages; Pop() hands out the oldest
+// complete set. A message that is older than the newest head of the other
+// logs by more than the tolerance can never be matched and is dropped, as
+// is the oldest message of a full ring. Drops are counted per log.
+template <size_t Capacity, typename... Ts> class GpsTimeSync {
+public:
+  using Set = std::tuple<Ts...>;
+
+  template <size_t I> using Type = typename std::tuple_element<I, Set>::type;
+
+  static constexpr size_t SIZE = sizeof...(Ts);
+  static constexpr double EXACT_TOLERANCE_S = 0.0005;
+
+  static_assert(SIZE > 0, "GpsTimeSync needs at least one log");
+
+  explicit GpsTimeSync(GpsTimeSyncPolicy policy = GpsTimeSyncPolicy::EXACT,
+                       double tolerance_s = 0.0)
+      : matched_(0) {
+    SetPolicy(policy, tolerance_s);
+    drops_.fill(0);
+  }
+
+  void SetPolicy(GpsTimeSyncPolicy policy, double tolerance_s) {
+    tolerance_s_ = policy == GpsTimeSyncPolicy::EXACT
+                       ? EXACT_TOLERANCE_S
+                       : std::max(tolerance_s, 0.0);
+  }
+
+  double Tolerance() const { return tolerance_s_; }
+
+  // Returns false if the ring was full and its oldest message was dropped.
+  template <size_t I>
+  bool Push(uint32_t week, double seconds, const Type<I> &msg) {
+    auto &ring = std::get<I>(rings_);
+    bool room = !ring.Full();
+    if (!room) {
+      ring.Pop();
+      drops_[I]++;
+    }
+    ring.Push(static_cast<double>(week) * SECONDS_PER_WEEK + seconds, msg);
+    return room;
+  }
+
+  bool Pop(Set &set) {
+    while (AllReady(Indices())) {
+      if (!DropStale(NewestFront(Indices()) - tolerance_s_, Indices())) {
+        TakeFronts(set, Indices());
+        matched_++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Takes the oldest message of one log without waiting for the others,
+  // for callers that would rather publish it incomplete.
+  template <size_t I> bool PopUnmatched(Type<I> &msg) {
+    auto &ring = std::get<I>(rings_);
+    if (ring.Empty()) {
+      return false;
+    }
+    msg = ring.Front();
+    ring.Pop();
+    return true;
+  }
+
+  template <size_t I> size_t Pending() const {
+    return std::get<I>(rings_).Size();
+  }
+
+  uint64_t Matched() const { return matched_; }
+
+  uint64_t Drops(size_t log) const { return drops_[log]; }
+
+  uint64_t Drops() const {
+    uint64_t total = 0;
+    for (uint64_t drops : drops_) {
+      total += drops;
+    }
+    return total;
+  }
+
+  void Clear() { ClearRings(Indices()); }
+
+private:
+  typedef typename detail::MakeIndexSequence<sizeof...(Ts)>::type Indices;
+
+  static constexpr double SECONDS_PER_WEEK = 604800.0;
+
+  template <size_t... Is> bool AllReady(detail::IndexSequence<Is...>) const {
+    const bool ready[] = {!std::get<Is>(rings_).Empty()...};
+    return std::all_of(std::begin(ready), std::end(ready),
+                       [](bool r) { return r; });
+  }
+
+  template <size_t... Is>
+  double NewestFront(detail::IndexSequence<Is...>) const {
+    const double times[] = {std::get<Is>(rings_).FrontTime()...};
+    return *std::max_element(std::begin(times), std::end(times));
+  }
+
+  template <size_t I> bool DropStale(double oldest) {
+    auto &ring = std::get<I>(rings_);
+    if (ring.FrontTime() >= oldest) {
+      return false;
+    }
+    ring.Pop();
+    drops_[I]++;
+    return true;
+  }
+
+  template <size_t... Is>
+  bool DropStale(double oldest, detail::IndexSequence<Is...>) {
+    const bool dropped[] = {DropStale<Is>(oldest)...};
+    return std::any_of(std::begin(dropped), std::end(dropped),
+                       [](bool d) { return d; });
+  }
+
+  template <size_t... Is>
+  void TakeFronts(Set &set, detail::IndexSequence<Is...>) {
+    set = Set(std::get<Is>(rings_).Front()...);
+    const int popped[] = {(std::get<Is>(rings_).Pop(), 0)...};
+    (void)popped;
+  }
+
+  template <size_t... Is> void ClearRings(detail::IndexSequence<Is...>) {
+    const int cleared[] = {(std::get<Is>(rings_).Clear(), 0)...};
+    (void)cleared;
+  }
+
+  std::tuple<GpsTimeRing<Ts, Capacity>...> rings_;
+  double tolerance_s_;
+  uint64_t matched_;
+  std::array<uint64_t, sizeof...(Ts)> drops_;
+};
+
+template <size_t Capacity, typename... Ts>
+constexpr size_t GpsTimeSync<Capacity, Ts...>::SIZE;
+template <size_t Capacity, typename... Ts>
+constexpr double GpsTimeSync<Capacity, Ts...>::EXACT_TOLERANCE_S;
+template <size_t Capacity, typename... Ts>
+constexpr double GpsTimeSync<Capacity, Ts...>::SECONDS_PER_WEEK;
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_GPS_TIME_SYNC_H_
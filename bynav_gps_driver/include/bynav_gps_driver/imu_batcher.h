@@ -0,0 +1,42 @@
+#ifndef BYNAV_IMU_BATCHER_H_
+#define BYNAV_IMU_BATCHER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include <bynav_gps_msgs/ImuArray.h>
+
+namespace bynav_gps_driver {
+
+// Packs IMU samples into ImuArray messages. A batch is finished once it
+// holds max_samples samples or spans max_latency_s of GPS time, whichever
+// comes first. Room for a whole batch is reserved when it is started, so
+// adding samples doesn't allocate.
+class ImuBatcher {
+public:
+  explicit ImuBatcher(size_t max_samples = 10, double max_latency_s = 0.05);
+
+  // Drops the batch in progress.
+  void Configure(size_t max_samples, double max_latency_s);
+
+  // gyro and accel are x, y, z in rad/s and m/s^2. Returns the finished
+  // batch, if this sample finished one.
+  std::unique_ptr<bynav_gps_msgs::ImuArray>
+  Add(const ros::Time &stamp, uint32_t week, double seconds, uint32_t status,
+      const double gyro[3], const double accel[3]);
+
+  // Hands out the batch in progress, if it has any samples.
+  std::unique_ptr<bynav_gps_msgs::ImuArray> Flush();
+
+  size_t Pending() const;
+
+private:
+  static constexpr double SECONDS_PER_WEEK = 604800.0;
+
+  size_t max_samples_;
+  double max_latency_s_;
+  std::unique_ptr<bynav_gps_msgs::ImuArray> batch_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_IMU_BATCHER_H_
@@ -0,0 +1,52 @@
+#ifndef BYNAV_IMU_MODELS_H_
+#define BYNAV_IMU_MODELS_H_
+
+#include <cmath>
+
+#include <bynav_gps_msgs/RawIMU.h>
+
+namespace bynav_gps_driver {
+
+// RAWIMU/RAWIMUS scale factors, in SI units per count. Models with
+// INCREMENTS set report the change in angle and velocity over one sample
+// rather than a rate, so their counts are also divided by the sample period.
+struct ImuModelAdis16488 {
+  static constexpr double GYRO_SCALE = 720.0 / 2147483648.0 * M_PI / 180.0;
+  static constexpr double ACCEL_SCALE = 200.0 / 2147483648.0;
+  static constexpr bool INCREMENTS = false;
+};
+
+struct ImuModelEpsonG320 {
+  static constexpr double GYRO_SCALE = 0.008 / 65536.0 / 125.0 * M_PI / 180.0;
+  static constexpr double ACCEL_SCALE =
+      0.200 / 65536.0 * 9.80665 / 1000.0 / 125.0;
+  static constexpr bool INCREMENTS = true;
+};
+
+struct ImuModelHg1700Ag58 {
+  static constexpr double GYRO_SCALE = 1.0 / 8589934592.0;
+  static constexpr double ACCEL_SCALE = 0.3048 / 134217728.0;
+  static constexpr bool INCREMENTS = true;
+};
+
+// Build with -DBYNAV_IMU_MODEL=<one of the above> to match the receiver.
+#ifndef BYNAV_IMU_MODEL
+#define BYNAV_IMU_MODEL ImuModelAdis16488
+#endif
+typedef BYNAV_IMU_MODEL RawImuModel;
+
+// gyro and accel are x, y, z. sample_rate is only used by increment models.
+template <typename Model>
+void RawImuToSi(const bynav_gps_msgs::RawIMU &raw, double sample_rate,
+                double gyro[3], double accel[3]) {
+  double rate = Model::INCREMENTS ? sample_rate : 1.0;
+  gyro[0] = raw.x_gyro * Model::GYRO_SCALE * rate;
+  gyro[1] = raw.y_gyro * Model::GYRO_SCALE * rate;
+  gyro[2] = raw.z_gyro * Model::GYRO_SCALE * rate;
+  accel[0] = raw.x_accel * Model::ACCEL_SCALE * rate;
+  accel[1] = raw.y_accel * Model::ACCEL_SCALE * rate;
+  accel[2] = raw.z_accel * Model::ACCEL_SCALE * rate;
+}
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_IMU_MODELS_H_
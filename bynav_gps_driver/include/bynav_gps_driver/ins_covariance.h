@@ -0,0 +1,65 @@
+#ifndef BYNAV_INS_COVARIANCE_H_
+#define BYNAV_INS_COVARIANCE_H_
+
+#include <cstdint>
+
+#include <bynav_gps_msgs/InsCov.h>
+#include <bynav_gps_msgs/Inspvax.h>
+#include <bynav_gps_msgs/Insstdev.h>
+
+namespace bynav_gps_driver {
+
+// The latest INS position, attitude and velocity covariances. INSCOV gives
+// the full matrices; INSSTDEV and the INSPVAX std fields only give the
+// diagonal, so they are ignored while an INSCOV no more than max_age_s
+// older than them is cached.
+//
+// Matrices are row-major 3x3. Position in m^2 and velocity in (m/s)^2 are
+// in the local level frame (x east, y north, z up). Attitude is in rad^2
+// about the REP-103 body axes (x forward, y left, z up), i.e. roll, pitch
+// and yaw, like the odometry orientation.
+class InsCovariance {
+public:
+  enum Source { NONE, DIAGONAL, FULL };
+
+  explicit InsCovariance(double max_age_s = 2.0);
+
+  void Update(const bynav_gps_msgs::InsCov &inscov);
+
+  void Update(const bynav_gps_msgs::Insstdev &insstdev);
+
+  // Receivers that don't fill the std fields leave them zero; those
+  // messages are ignored.
+  void Update(const bynav_gps_msgs::Inspvax &inspvax);
+
+  Source GetSource() const { return source_; }
+
+  const double *Position() const { return position_; }
+
+  const double *Attitude() const { return attitude_; }
+
+  // Attitude about the receiver's IMU axes (x right, y forward, z up), the
+  // axes the imu topic's orientation is given in.
+  void ImuAttitude(double attitude[9]) const;
+
+  const double *Velocity() const { return velocity_; }
+
+  void Clear() { source_ = NONE; }
+
+private:
+  static constexpr double SECONDS_PER_WEEK = 604800.0;
+
+  // Standard deviations in INSSTDEV order: latitude, longitude, height,
+  // north, east and up velocity, roll, pitch and azimuth in degrees.
+  void SetDiagonal(uint32_t week, double seconds, const double sigma[9]);
+
+  double max_age_s_;
+  Source source_;
+  double gps_time_;
+  double position_[9];
+  double attitude_[9];
+  double velocity_[9];
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_INS_COVARIANCE_H_
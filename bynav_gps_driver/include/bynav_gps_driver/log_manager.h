@@ -0,0 +1,67 @@
+#ifndef BYNAV_LOG_MANAGER_H_
+#define BYNAV_LOG_MANAGER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <bynav_gps_driver/bynav_connection.h>
+
+namespace bynav_gps_driver {
+
+// Keeps the set of logs running on the receiver in step with what is
+// actually consumed downstream. A log is requested as soon as something
+// wants it, but only dropped once nothing has wanted it for the hold time,
+// so subscribers that come and go don't make the receiver churn.
+class LogManager {
+public:
+  explicit LogManager(double unlog_hold_s = 5.0);
+
+  void SetUnlogHold(double unlog_hold_s) { unlog_hold_s_ = unlog_hold_s; }
+
+  // A negative period logs the message onchanged. Always-on logs are
+  // requested on connect and never dropped.
+  void AddLog(const std::string &name, double period, bool always_on = false);
+
+  void Clear();
+
+  void SetWanted(const std::string &name, bool wanted);
+
+  // Marks everything that should currently be running as logged and returns
+  // it as the options to connect with. The receiver is expected to start
+  // from UNLOGALL.
+  BynavMessageOpts OnConnect(double now);
+
+  // Commands needed to bring the receiver in line with demand at time now
+  // (in seconds). The caller is expected to write every returned command.
+  std::vector<std::string> Update(double now);
+
+  bool IsLogged(const std::string &name) const;
+
+  size_t LoggedCount() const;
+
+  size_t LogCount() const { return logs_.size(); }
+
+  static std::string LogCommand(const std::string &name, double period);
+
+  static std::string UnlogCommand(const std::string &name);
+
+private:
+  struct LogState {
+    LogState()
+        : period(0.0), always_on(false), wanted(false), logged(false),
+          last_wanted(-1.0) {}
+
+    double period;
+    bool always_on;
+    bool wanted;
+    bool logged;
+    double last_wanted;
+  };
+
+  double unlog_hold_s_;
+  std::map<std::string, LogState> logs_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_LOG_MANAGER_H_
@@ -0,0 +1,94 @@
+#ifndef BYNAV_LOG_PLANNER_H_
+#define BYNAV_LOG_PLANNER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <bynav_gps_driver/bynav_connection.h>
+
+namespace bynav_gps_driver {
+
+// Checks a set of requested logs against what the receiver link can carry
+// and, where it doesn't fit, switches ASCII logs to binary and decimates the
+// less important ones, optionally dropping them, before giving up.
+class LogPlanner {
+public:
+  // Logs are only decimated down to their priority's limit; critical logs
+  // are never decimated.
+  enum Priority {
+    PRIORITY_CRITICAL = 0,
+    PRIORITY_NORMAL = 1,
+    PRIORITY_LOW = 2
+  };
+
+  struct Config {
+    Config()
+        : baud(115200), serial(true), max_utilization(0.8), satellites(30),
+          allow_binary_switch(true), allow_decimation(true),
+          allow_pruning(false) {}
+
+    int32_t baud;
+    // Network links are not budgeted.
+    bool serial;
+    double max_utilization;
+    // Used to size observation logs such as RANGECMPB.
+    int32_t satellites;
+    bool allow_binary_switch;
+    bool allow_decimation;
+    // Drop non-critical logs that still don't fit after decimation.
+    bool allow_pruning;
+  };
+
+  struct PlannedLog {
+    std::string requested_name;
+    double requested_period;
+    std::string name;
+    double period;
+    size_t message_bytes;
+    double bytes_per_s;
+  };
+
+  struct Plan {
+    Plan() : feasible(true), capacity_bytes_per_s(0.0), bytes_per_s(0.0) {}
+
+    double Utilization() const {
+      return capacity_bytes_per_s > 0.0 ? bytes_per_s / capacity_bytes_per_s
+                                        : 0.0;
+    }
+
+    std::string Report() const;
+
+    bool feasible;
+    double capacity_bytes_per_s;
+    double bytes_per_s;
+    BynavMessageOpts opts;
+    std::vector<PlannedLog> logs;
+    std::vector<PlannedLog> dropped;
+  };
+
+  explicit LogPlanner(const Config &config = Config());
+
+  Plan Build(const BynavMessageOpts &opts) const;
+
+  // Bytes on the wire for one message of the given log, including header
+  // and CRC or NMEA framing.
+  static size_t MessageSize(const std::string &name, int32_t satellites);
+
+  static Priority LogPriority(const std::string &name);
+
+  // Serial ports carry 10 bits per byte with 8N1 framing.
+  static double SerialCapacity(int32_t baud) { return baud / 10.0; }
+
+  // Assumed rate of logs requested onchanged.
+  static constexpr double ONCHANGED_RATE = 0.2;
+  // How far normal and low priority logs may be slowed down.
+  static constexpr double NORMAL_MAX_PERIOD = 1.0;
+  static constexpr double LOW_MAX_PERIOD = 10.0;
+
+private:
+  Config config_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_LOG_PLANNER_H_
@@ -0,0 +1,128 @@
+#ifndef BYNAV_NTRIP_CLIENT_H_
+#define BYNAV_NTRIP_CLIENT_H_
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+#include <boost/array.hpp>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+#include <bynav_gps_driver/bynav_connection.h>
+#include <bynav_gps_driver/parsers/rtcm.h>
+#include <bynav_gps_driver/rtcm_filter.h>
+
+namespace bynav_gps_driver {
+
+// Connection used only to push corrections into a receiver port. The port is
+// expected to already be in RTCM input mode, so no logs are requested on it.
+class CorrectionPort : public BynavConnection {
+public:
+  bool Configure(BynavMessageOpts const &opts) override { return true; }
+};
+
+// Host side NTRIP client. Pulls an RTCM3 stream from a caster on its own
+// io_service thread, frames it and hands every complete frame to the sink
+// as soon as its CRC has been checked, so the receiver read path is never
+// blocked by network I/O.
+class NtripClient {
+public:
+  typedef std::function<bool(const uint8_t *, size_t)> CorrectionSink;
+
+  struct Config {
+    Config()
+        : port(2101), version(1), gga_interval_s(10.0),
+          reconnect_delay_s(2.0) {}
+
+    std::string host;
+    uint16_t port;
+    std::string mountpoint;
+    std::string username;
+    std::string password;
+    int32_t version;
+    double gga_interval_s;
+    double reconnect_delay_s;
+  };
+
+  NtripClient();
+  ~NtripClient();
+
+  void SetSink(CorrectionSink sink);
+
+  // Only frames of the allowed types reach the sink; see RtcmFilter.
+  void AllowMessageType(uint16_t type, double min_interval_s = 0.0);
+
+  bool Start(const Config &config);
+
+  void Stop();
+
+  bool IsStreaming() const { return streaming_; }
+
+  void SetGgaSentence(const std::string &gga);
+
+  std::string ErrorMsg() const;
+
+  uint64_t BytesReceived() const { return bytes_received_; }
+  uint64_t FramesInjected() const { return frames_injected_; }
+  uint64_t InjectFailures() const { return inject_failures_; }
+  uint64_t FramesFiltered() const { return frames_filtered_; }
+
+  std::string BandwidthReport() const;
+
+  static std::string BuildRequest(const Config &config);
+
+  static std::string Base64Encode(const std::string &input);
+
+private:
+  void Connect();
+  void OnConnect(const boost::system::error_code &error);
+  void OnResponse(const boost::system::error_code &error, size_t bytes);
+  void OnStreamStart();
+  void StartRead();
+  void OnRead(const boost::system::error_code &error, size_t bytes);
+  void StartGgaTimer();
+  void OnGgaTimer(const boost::system::error_code &error);
+  void Fail(const std::string &msg);
+
+  void Feed(const uint8_t *data, size_t size);
+  void FeedChunked(const uint8_t *data, size_t size);
+  void OnFrame(uint8_t *buf, size_t size, uint16_t id);
+
+  Config config_;
+  CorrectionSink sink_;
+
+  boost::asio::io_service io_service_;
+  std::unique_ptr<boost::asio::io_service::work> work_;
+  boost::asio::ip::tcp::socket socket_;
+  boost::asio::deadline_timer gga_timer_;
+  boost::asio::deadline_timer reconnect_timer_;
+  boost::asio::streambuf response_;
+  boost::array<uint8_t, 4096> read_buffer_;
+  boost::thread thread_;
+
+  Rtcm framer_;
+
+  bool chunked_;
+  size_t chunk_remaining_;
+  std::string chunk_line_;
+
+  std::string request_;
+  std::string gga_write_;
+  bool gga_write_pending_;
+
+  mutable boost::mutex mutex_;
+  std::string gga_sentence_;
+  std::string error_msg_;
+  RtcmFilter filter_;
+
+  std::atomic<bool> running_;
+  std::atomic<bool> streaming_;
+  std::atomic<uint64_t> bytes_received_;
+  std::atomic<uint64_t> frames_injected_;
+  std::atomic<uint64_t> inject_failures_;
+  std::atomic<uint64_t> frames_filtered_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_NTRIP_CLIENT_H_
@@ -0,0 +1,26 @@
+#ifndef BYNAV_INSCOV_H
+#define BYNAV_INSCOV_H
+
+#include <bynav_gps_driver/parsers/message_parser.h>
+#include <bynav_gps_msgs/InsCov.h>
+
+namespace bynav_gps_driver {
+
+class InscovParser : public MessageParser<bynav_gps_msgs::InsCovPtr> {
+public:
+  uint32_t GetMessageId() const override;
+
+  const std::string GetMessageName() const override;
+
+  bynav_gps_msgs::InsCovPtr ParseBinary(const BinaryMessage &bin_msg) override;
+
+  bynav_gps_msgs::InsCovPtr ParseAscii(const BynavSentence &sentence) override;
+
+  static constexpr uint32_t MESSAGE_ID = 264;
+  static const std::string MESSAGE_NAME;
+  static constexpr size_t BINARY_LENGTH = 228;
+  static constexpr size_t ASCII_FIELDS = 29;
+};
+} // namespace bynav_gps_driver
+
+#endif // BYNAV_INSCOV_H
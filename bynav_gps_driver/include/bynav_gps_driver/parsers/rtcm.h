@@ -12,7 +12,7 @@ namespace bynav_gps_driver {
 class Rtcm {
 public:
   const static uint32_t CRC24_TABLE[];
-  static constexpr int BUFFER_SIZE = 1024;
+  static constexpr int BUFFER_SIZE = 1029;
 
   union Rtcm_message_t {
     uint8_t buf[BUFFER_SIZE];
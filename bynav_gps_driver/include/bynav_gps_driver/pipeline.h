@@ -0,0 +1,134 @@
+#ifndef BYNAV_PIPELINE_H_
+#define BYNAV_PIPELINE_H_
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/thread.hpp>
+
+namespace bynav_gps_driver {
+
+inline int64_t PipelineNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Queue depth and queueing latency seen by the consumer of one pipeline
+// queue. Updated by the consuming stage; Reset() is meant for diagnostics.
+struct StageMetrics {
+  StageMetrics()
+      : count(0), total_latency_ns(0), max_latency_ns(0), max_depth(0),
+        overflows(0) {}
+
+  void Record(int64_t latency_ns, size_t depth) {
+    count++;
+    total_latency_ns += latency_ns;
+    if (latency_ns > max_latency_ns) {
+      max_latency_ns = latency_ns;
+    }
+    if (depth > max_depth) {
+      max_depth = depth;
+    }
+  }
+
+  void Reset() {
+    count = 0;
+    total_latency_ns = 0;
+    max_latency_ns = 0;
+    max_depth = 0;
+    overflows = 0;
+  }
+
+  double MeanLatencyUs() const {
+    uint64_t n = count;
+    return n > 0 ? total_latency_ns / 1000.0 / n : 0.0;
+  }
+
+  std::atomic<uint64_t> count;
+  std::atomic<int64_t> total_latency_ns;
+  std::atomic<int64_t> max_latency_ns;
+  std::atomic<size_t> max_depth;
+  std::atomic<uint64_t> overflows;
+};
+
+// Bounded single-producer / single-consumer hand-off between two pipeline
+// stages. Items go through a lock-free ring; the mutex is only taken to park
+// an idle consumer and to wake it up again. T must have an int64_t
+// enqueue_ns member. The queue owns the items it holds.
+template <typename T> class PipelineQueue {
+public:
+  explicit PipelineQueue(size_t capacity) : queue_(capacity) {}
+
+  ~PipelineQueue() {
+    T *item;
+    while (queue_.pop(item)) {
+      delete item;
+    }
+  }
+
+  // Returns false without taking ownership if the queue is full.
+  bool Push(T *item) {
+    item->enqueue_ns = PipelineNowNs();
+    if (!queue_.push(item)) {
+      metrics_.overflows++;
+      return false;
+    }
+
+    { boost::lock_guard<boost::mutex> lock(mutex_); }
+    cond_.notify_one();
+    return true;
+  }
+
+  // Returns nullptr if nothing arrived within the timeout.
+  T *Pop(int32_t timeout_ms) {
+    T *item = nullptr;
+    if (!queue_.pop(item)) {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      if (queue_.read_available() == 0) {
+        cond_.wait_for(lock, boost::chrono::milliseconds(timeout_ms));
+      }
+      if (!queue_.pop(item)) {
+        return nullptr;
+      }
+    }
+
+    metrics_.Record(PipelineNowNs() - item->enqueue_ns,
+                    queue_.read_available() + 1);
+    return item;
+  }
+
+  void Wake() {
+    { boost::lock_guard<boost::mutex> lock(mutex_); }
+    cond_.notify_all();
+  }
+
+  StageMetrics &Metrics() { return metrics_; }
+
+private:
+  boost::lockfree::spsc_queue<T *> queue_;
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  StageMetrics metrics_;
+};
+
+// Pins a thread to one CPU. A negative cpu leaves the thread unpinned.
+inline bool SetThreadAffinity(boost::thread &thread, int32_t cpu) {
+  if (cpu < 0) {
+    return true;
+  }
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus),
+                                &cpus) == 0;
+}
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_PIPELINE_H_
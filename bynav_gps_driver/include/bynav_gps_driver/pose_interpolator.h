@@ -0,0 +1,61 @@
+#ifndef BYNAV_POSE_INTERPOLATOR_H_
+#define BYNAV_POSE_INTERPOLATOR_H_
+
+#include <cstdint>
+
+#include <bynav_gps_driver/gps_time_sync.h>
+
+namespace bynav_gps_driver {
+
+// INS position, velocity and attitude at any recent GPS time, interpolated
+// between the INSPVA/INSPVAX epochs on either side of it. Used to find the
+// pose at MARKTIME events, which fall between epochs.
+class PoseInterpolator {
+public:
+  // As in INSPVA: degrees, meters above the ellipsoid, m/s.
+  struct Pose {
+    double latitude;
+    double longitude;
+    double height;
+    double north_velocity;
+    double east_velocity;
+    double up_velocity;
+    double roll;
+    double pitch;
+    double azimuth;
+  };
+
+  enum Result {
+    INTERPOLATED,
+    // No epoch at or after the time yet.
+    PENDING,
+    // Older than every epoch that is still kept, or in a gap between
+    // epochs wider than the maximum.
+    UNAVAILABLE
+  };
+
+  static constexpr size_t CAPACITY = 64;
+
+  explicit PoseInterpolator(double max_gap_s = 0.1);
+
+  void SetMaxGap(double max_gap_s) { max_gap_s_ = max_gap_s; }
+
+  // Linear, except that angles take the short way round.
+  static Pose Interpolate(const Pose &a, const Pose &b, double t);
+
+  // Epochs must arrive in order; older or repeated ones are ignored.
+  void Add(double gps_time, const Pose &pose);
+
+  Result Lookup(double gps_time, Pose &pose) const;
+
+  bool Empty() const { return epochs_.Empty(); }
+
+  void Clear() { epochs_.Clear(); }
+
+private:
+  double max_gap_s_;
+  GpsTimeRing<Pose, CAPACITY> epochs_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_POSE_INTERPOLATOR_H_
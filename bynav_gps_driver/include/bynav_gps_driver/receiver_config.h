@@ -0,0 +1,52 @@
+#ifndef BYNAV_RECEIVER_CONFIG_H_
+#define BYNAV_RECEIVER_CONFIG_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bynav_gps_driver {
+
+// What we know of the receiver's configuration, as one command per setting.
+// Settings are keyed by the command and the arguments that select what it
+// configures, e.g. "SERIALCONFIG COM1" or "SET OBSFREQ", so a later command
+// for the same setting replaces the earlier one.
+class ReceiverConfig {
+public:
+  void Clear() { commands_.clear(); }
+
+  void Set(const std::string &command);
+
+  // Empty if nothing is known about the setting.
+  std::string Get(const std::string &key) const;
+
+  // True if the known setting already has the values the command would set.
+  // The receiver reports every argument while our commands often leave
+  // trailing ones at their defaults, so only the given arguments are
+  // compared, numbers numerically.
+  bool Covers(const std::string &command) const;
+
+  // Commands that would actually change something, in their original order.
+  std::vector<std::string> Diff(const std::vector<std::string> &commands) const;
+
+  // Reads the entries of an RXCONFIGA log, e.g.
+  // #RXCONFIGA,COM1,...;#SERIALCONFIGA,COM1,...;COM1,115200,N,8,1,N,OFF*...
+  // Returns the number of settings loaded.
+  size_t LoadRxConfig(const std::string &rxconfig);
+
+  const std::map<std::string, std::string> &Commands() const {
+    return commands_;
+  }
+
+  size_t Size() const { return commands_.size(); }
+
+  static std::string Key(const std::string &command);
+
+  static std::vector<std::string> Tokenize(const std::string &command);
+
+private:
+  std::map<std::string, std::string> commands_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_RECEIVER_CONFIG_H_
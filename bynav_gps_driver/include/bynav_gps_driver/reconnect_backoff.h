@@ -0,0 +1,41 @@
+#ifndef BYNAV_RECONNECT_BACKOFF_H_
+#define BYNAV_RECONNECT_BACKOFF_H_
+
+#include <cstdint>
+#include <random>
+
+namespace bynav_gps_driver {
+
+// Delays between reconnect attempts. Every failed attempt doubles the delay
+// up to a maximum, and each delay is randomly stretched or shrunk by up to
+// the jitter fraction so that several drivers that lost the same network
+// don't all retry in lockstep.
+class ReconnectBackoff {
+public:
+  explicit ReconnectBackoff(double initial_s = 0.5, double max_s = 30.0,
+                            double jitter = 0.25,
+                            uint32_t seed = std::random_device()());
+
+  void Configure(double initial_s, double max_s, double jitter);
+
+  // Delay before the next attempt, in seconds.
+  double NextDelay();
+
+  // Call once a connection has been up for a while, so the next drop is
+  // treated as transient again.
+  void Reset();
+
+  // Failed attempts since the last Reset().
+  int32_t Attempts() const { return attempts_; }
+
+private:
+  double initial_s_;
+  double max_s_;
+  double jitter_;
+  double base_s_;
+  int32_t attempts_;
+  std::mt19937 rng_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_RECONNECT_BACKOFF_H_
@@ -0,0 +1,53 @@
+#ifndef BYNAV_RTCM_FILTER_H_
+#define BYNAV_RTCM_FILTER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace bynav_gps_driver {
+
+// Decides per RTCM message type whether a frame is forwarded, and keeps
+// bandwidth accounting for both forwarded and rejected frames.
+class RtcmFilter {
+public:
+  struct TypeStats {
+    TypeStats()
+        : frames_passed(0), frames_dropped(0), bytes_passed(0),
+          bytes_dropped(0), first_stamp(-1.0), last_stamp(-1.0),
+          last_passed_stamp(-1.0) {}
+
+    uint64_t frames_passed;
+    uint64_t frames_dropped;
+    uint64_t bytes_passed;
+    uint64_t bytes_dropped;
+    double first_stamp;
+    double last_stamp;
+    double last_passed_stamp;
+  };
+
+  RtcmFilter();
+
+  // Once any type has been allowed, all other types are rejected.
+  // A non-zero interval limits the type to one frame per interval.
+  void AllowMessageType(uint16_t type, double min_interval_s = 0.0);
+
+  void Clear();
+
+  bool IsEnabled() const { return !allowed_.empty(); }
+
+  // Returns true if a frame of the given type and size should be forwarded
+  // at time stamp (in seconds).
+  bool Pass(uint16_t type, size_t size, double stamp);
+
+  const std::map<uint16_t, TypeStats> &GetStats() const { return stats_; }
+
+  std::string BandwidthReport() const;
+
+private:
+  std::map<uint16_t, double> allowed_;
+  std::map<uint16_t, TypeStats> stats_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_RTCM_FILTER_H_
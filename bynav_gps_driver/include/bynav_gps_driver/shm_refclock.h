@@ -0,0 +1,53 @@
+#ifndef BYNAV_SHM_REFCLOCK_H_
+#define BYNAV_SHM_REFCLOCK_H_
+
+#include <cstdint>
+#include <string>
+
+namespace bynav_gps_driver {
+
+// Writer for the NTP shared memory reference clock ("refclock SHM <unit>"
+// in chrony, driver 28 in ntpd). Each sample is the reference (UTC) time of
+// an event and the host system time at which it happened.
+class ShmRefclock {
+public:
+  static constexpr int32_t BASE_KEY = 0x4e545030;
+  // About 1 ms, as a power of two.
+  static constexpr int32_t PRECISION = -10;
+
+  ShmRefclock();
+
+  ~ShmRefclock();
+
+  // Units 0 and 1 are created readable by root only, as ntpd expects, so
+  // writing them needs the same privileges as the time daemon.
+  bool Open(int32_t unit);
+
+  void Close();
+
+  bool IsOpen() const { return shm_ != nullptr; }
+
+  int32_t Unit() const { return unit_; }
+
+  // Both times are seconds since the Unix epoch.
+  void Publish(double reference_time, double host_time);
+
+  // Reads the latest sample the way the time daemons do. Returns false if
+  // there is none or a write was in progress.
+  bool Read(double &reference_time, double &host_time) const;
+
+  uint64_t Samples() const { return samples_; }
+
+  std::string ErrorMsg() const { return error_msg_; }
+
+private:
+  struct ShmTime;
+
+  ShmTime *shm_;
+  int32_t unit_;
+  uint64_t samples_;
+  std::string error_msg_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_SHM_REFCLOCK_H_
@@ -0,0 +1,114 @@
+#ifndef BYNAV_TIME_ALIGNMENT_H_
+#define BYNAV_TIME_ALIGNMENT_H_
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace bynav_gps_driver {
+
+// Mean, variance, min and max of the last `window` values. Sums are kept
+// running and min/max come from monotonic queues, so Add() is O(1)
+// amortised and memory stays bounded however long it runs.
+class WindowedStats {
+public:
+  explicit WindowedStats(size_t window = 10);
+
+  // Clears the values.
+  void SetWindow(size_t window);
+
+  size_t Window() const { return window_; }
+
+  void Add(double value);
+
+  void Clear();
+
+  size_t Count() const { return values_.size(); }
+
+  double Mean() const;
+
+  double Variance() const;
+
+  double Min() const;
+
+  double Max() const;
+
+private:
+  size_t window_;
+  uint64_t added_;
+  std::deque<double> values_;
+  // (index, value) pairs that can still become the minimum or maximum.
+  std::deque<std::pair<uint64_t, double>> min_;
+  std::deque<std::pair<uint64_t, double>> max_;
+  double sum_;
+  double sum_squares_;
+};
+
+// Pairs two time streams that each arrive in order, e.g. external sync
+// pulses and the receiver's top-of-second stamps, and keeps windowed
+// statistics of reference - measurement. Each stream may be pushed from
+// its own thread without locking; Align() is called from one consumer
+// thread and merges whatever arrived in a single pass.
+class TimeAlignment {
+public:
+  struct Summary {
+    Summary()
+        : synced(false), last_reference(0.0), count(0), mean(0.0),
+          variance(0.0), min(0.0), max(0.0) {}
+
+    bool synced;
+    double last_reference;
+    size_t count;
+    double mean;
+    double variance;
+    double min;
+    double max;
+  };
+
+  static constexpr size_t QUEUE_SIZE = 128;
+
+  explicit TimeAlignment(size_t window = 10, double tolerance_s = 0.49);
+
+  // Consumer thread only.
+  void SetWindow(size_t window);
+
+  // Return false if the stream is full; the time is dropped.
+  bool PushReference(double time);
+
+  bool PushMeasurement(double time);
+
+  // Consumer thread only. Returns the number of new pairs.
+  size_t Align();
+
+  // Consumer thread only.
+  bool Synced() const { return synced_; }
+
+  // Mean offset over the window; consumer thread only.
+  double Offset() const { return stats_.Mean(); }
+
+  // Copy of the current state that any thread may take.
+  Summary GetSummary() const;
+
+private:
+  void Drain(boost::lockfree::spsc_queue<double> &in, std::deque<double> &out);
+
+  double tolerance_s_;
+  boost::lockfree::spsc_queue<double> references_in_;
+  boost::lockfree::spsc_queue<double> measurements_in_;
+  std::deque<double> references_;
+  std::deque<double> measurements_;
+
+  bool synced_;
+  double last_reference_;
+  WindowedStats stats_;
+
+  // Only guards summary_, which is refreshed when new pairs were made.
+  mutable boost::mutex summary_mutex_;
+  Summary summary_;
+};
+
+} // namespace bynav_gps_driver
+#endif // BYNAV_TIME_ALIGNMENT_H_
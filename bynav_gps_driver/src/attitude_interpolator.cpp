@@ -0,0 +1,106 @@
+#include <bynav_gps_driver/attitude_interpolator.h>
+
+#include <cmath>
+
+namespace bynav_gps_driver {
+
+constexpr size_t AttitudeInterpolator::CAPACITY;
+
+AttitudeInterpolator::Quaternion
+AttitudeInterpolator::FromRollPitchYaw(double roll, double pitch, double yaw) {
+  double cr = std::cos(roll / 2.0);
+  double sr = std::sin(roll / 2.0);
+  double cp = std::cos(pitch / 2.0);
+  double sp = std::sin(pitch / 2.0);
+  double cy = std::cos(yaw / 2.0);
+  double sy = std::sin(yaw / 2.0);
+
+  Quaternion q;
+  q.x = sr * cp * cy - cr * sp * sy;
+  q.y = cr * sp * cy + sr * cp * sy;
+  q.z = cr * cp * sy - sr * sp * cy;
+  q.w = cr * cp * cy + sr * sp * sy;
+  return q;
+}
+
+AttitudeInterpolator::Quaternion
+AttitudeInterpolator::Slerp(const Quaternion &a, const Quaternion &b,
+                            double t) {
+  // Take the short way round.
+  double dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+  double sign = dot < 0.0 ? -1.0 : 1.0;
+  dot *= sign;
+
+  double wa;
+  double wb;
+  if (dot > 0.9995) {
+    // Nearly parallel; a normalised lerp is accurate and avoids sin(0).
+    wa = 1.0 - t;
+    wb = t;
+  } else {
+    double theta = std::acos(dot);
+    double sin_theta = std::sin(theta);
+    wa = std::sin((1.0 - t) * theta) / sin_theta;
+    wb = std::sin(t * theta) / sin_theta;
+  }
+  wb *= sign;
+
+  Quaternion q;
+  q.x = wa * a.x + wb * b.x;
+  q.y = wa * a.y + wb * b.y;
+  q.z = wa * a.z + wb * b.z;
+  q.w = wa * a.w + wb * b.w;
+  double norm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+  q.x /= norm;
+  q.y /= norm;
+  q.z /= norm;
+  q.w /= norm;
+  return q;
+}
+
+void AttitudeInterpolator::Add(double gps_time, const Quaternion &q) {
+  if (!epochs_.Empty() && gps_time <= epochs_.BackTime()) {
+    return;
+  }
+  if (epochs_.Full()) {
+    epochs_.Pop();
+  }
+  epochs_.Push(gps_time, q);
+}
+
+AttitudeInterpolator::Result
+AttitudeInterpolator::Lookup(double gps_time, Quaternion &q) const {
+  if (epochs_.Empty() || gps_time > epochs_.BackTime()) {
+    return PENDING;
+  }
+  if (gps_time < epochs_.FrontTime()) {
+    return UNAVAILABLE;
+  }
+
+  // Samples are usually close to the newest epochs, so search backwards.
+  size_t i = epochs_.Size() - 1;
+  while (i > 0 && epochs_.TimeAt(i - 1) >= gps_time) {
+    i--;
+  }
+  if (i == 0 || epochs_.TimeAt(i) == gps_time) {
+    q = epochs_.At(i);
+    return INTERPOLATED;
+  }
+
+  double t0 = epochs_.TimeAt(i - 1);
+  double t1 = epochs_.TimeAt(i);
+  q = Slerp(epochs_.At(i - 1), epochs_.At(i), (gps_time - t0) / (t1 - t0));
+  return INTERPOLATED;
+}
+
+bool AttitudeInterpolator::Hold(double gps_time, Quaternion &q) const {
+  for (size_t i = epochs_.Size(); i > 0; i--) {
+    if (epochs_.TimeAt(i - 1) <= gps_time) {
+      q = epochs_.At(i - 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace bynav_gps_driver
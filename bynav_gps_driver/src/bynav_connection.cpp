@@ -1,39 +1,125 @@
 #include <bynav_gps_driver/bynav_connection.h>
+#include <bynav_gps_driver/bynav_message_extractor.h>
+#include <bynav_gps_driver/log_manager.h>
+#include <bynav_gps_driver/pipeline.h>
+#include <fcntl.h>
 #include <net/ethernet.h>
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 #include <boost/algorithm/string/join.hpp>
+#include <boost/chrono.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <rclcpp/rclcpp.hpp>
 
 namespace bynav_gps_driver {
 
+// The timeouts are bound to references by the chrono constructors, which
+// needs a definition before C++17.
+constexpr int32_t BynavConnection::COMMAND_POLL_MS;
+constexpr int32_t BynavConnection::LOGLIST_TIMEOUT_MS;
+
+namespace {
+
+speed_t BaudConstant(int32_t baud) {
+  switch (baud) {
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 921600:
+    return B921600;
+  default:
+    return B0;
+  }
+}
+
+} // namespace
+
 BynavConnection::BynavConnection()
-    : connection_(SERIAL), is_connected_(false), serial_baud_(115200),
-      tcp_socket_(io_service_) {}
+    : connection_(SERIAL), is_connected_(false), waiting_for_peer_(false),
+      serial_baud_(115200), active_baud_(0), auto_baud_(false),
+      receiver_port_("THISPORT"), read_timeout_ms_(1000),
+      monotonic_offset_ns_(0), serial_fd_(-1),
+      write_failed_(false),
+      commands_([this](const std::string &command) { return Write(command); }),
+      configuration_skipped_(false), tcp_socket_(io_service_) {}
 
 BynavConnection::~BynavConnection() { Disconnect(); }
 
 bool BynavConnection::Connect(const std::string &device,
                               ConnectionType connection,
                               BynavMessageOpts const &opts) {
+  if (!Open(device, connection, DEFAULT_CONNECT_TIMEOUT_MS)) {
+    return false;
+  }
+
+  if (Configure(opts)) {
+    ROS_INFO("Configured GPS.");
+  } else {
+    ROS_ERROR("Failed to configure GPS. This port may be read only, or the "
+              "device may not be functioning as expected; however, the "
+              "driver may still function correctly if the port has already "
+              "been pre-configured.");
+  }
+
+  return true;
+}
+
+bool BynavConnection::Open(const std::string &device,
+                           ConnectionType connection, int32_t timeout_ms) {
   Disconnect();
 
   connection_ = connection;
-
+  device_ = device;
+  io_thread_ = boost::this_thread::get_id();
+  configuration_skipped_ = false;
+  write_failed_ = false;
+  waiting_for_peer_ = false;
+
+  timespec monotonic;
+  ::clock_gettime(CLOCK_MONOTONIC, &monotonic);
+  monotonic_offset_ns_ = ros::Time::now().toNSec() -
+                         (monotonic.tv_sec * 1000000000LL + monotonic.tv_nsec);
+
+  // Write refuses to touch the device until it is marked connected, so only
+  // publishing the result needs the write lock.
+  bool connected = false;
   if (connection_ == SERIAL) {
-    return CreateSerialConnection(device, opts);
+    connected = CreateSerialConnection(device);
   } else if (connection_ == TCP || connection_ == UDP) {
-    return CreateIpConnection(device, opts);
+    connected = CreateIpConnection(device, timeout_ms);
+  } else {
+    error_msg_ = "Invalid connection type.";
   }
 
-  error_msg_ = "Invalid connection type.";
-
-  return false;
+  boost::unique_lock<boost::mutex> lock(write_mutex_);
+  is_connected_ = connected;
+  return connected;
 }
 
 BynavConnection::ConnectionType
@@ -50,8 +136,13 @@ BynavConnection::ParseConnection(const std::string &connection) {
 }
 
 void BynavConnection::Disconnect() {
+  // Corrections may be written from another thread. The command channel
+  // takes its own lock before writing, so it is cancelled after this one is
+  // released.
+  boost::unique_lock<boost::mutex> lock(write_mutex_);
+  is_connected_ = false;
   if (connection_ == SERIAL) {
-    serial_.Close();
+    CloseSerial();
   } else if (connection_ == TCP) {
     tcp_socket_.close();
   } else if (connection_ == UDP) {
@@ -63,7 +154,8 @@ void BynavConnection::Disconnect() {
       udp_endpoint_.reset();
     }
   }
-  is_connected_ = false;
+  lock.unlock();
+  commands_.Cancel("Disconnected.");
 }
 
 void BynavConnection::SetSerialBaud(int32_t serial_baud) {
@@ -71,34 +163,49 @@ void BynavConnection::SetSerialBaud(int32_t serial_baud) {
   serial_baud_ = serial_baud;
 }
 
+void BynavConnection::SetAutoBaud(bool enable,
+                                  const std::string &receiver_port) {
+  auto_baud_ = enable;
+  receiver_port_ = receiver_port;
+}
+
 bool BynavConnection::Write(const std::string &command) {
-  std::vector<uint8_t> bytes(command.begin(), command.end());
+  return Write(reinterpret_cast<const uint8_t *>(command.data()),
+               command.size());
+}
+
+bool BynavConnection::Write(const uint8_t *data, size_t size) {
+  // Commands and injected corrections may come from different threads.
+  boost::unique_lock<boost::mutex> lock(write_mutex_);
+  if (!is_connected_) {
+    return false;
+  }
 
   if (connection_ == SERIAL) {
-    int32_t written = serial_.Write(bytes);
-    if (written != (int32_t)command.length()) {
-      ROS_ERROR("Failed to send command: %s", command.c_str());
+    if (!WriteSerial(data, size)) {
+      ROS_ERROR("Failed to send %lu bytes to serial device.", size);
+      return false;
     }
-    return written == (int32_t)command.length();
+    return true;
   } else if (connection_ == TCP || connection_ == UDP) {
     boost::system::error_code error;
     try {
       size_t written;
       if (connection_ == TCP) {
-        written =
-            boost::asio::write(tcp_socket_, boost::asio::buffer(bytes), error);
+        written = boost::asio::write(tcp_socket_,
+                                     boost::asio::buffer(data, size), error);
       } else {
-        written = udp_socket_->send_to(boost::asio::buffer(bytes),
+        written = udp_socket_->send_to(boost::asio::buffer(data, size),
                                        *udp_endpoint_, 0, error);
       }
       if (error) {
         ROS_ERROR("Error writing TCP data: %s", error.message().c_str());
-        Disconnect();
+        write_failed_ = true;
       }
       ROS_DEBUG("Wrote %lu bytes.", written);
-      return written == (int32_t)command.length();
+      return written == size;
     } catch (std::exception &e) {
-      Disconnect();
+      write_failed_ = true;
       ROS_ERROR("Exception writing TCP data: %s", e.what());
     }
   }
@@ -106,36 +213,333 @@ bool BynavConnection::Write(const std::string &command) {
   return false;
 }
 
-bool BynavConnection::CreateSerialConnection(const std::string &device,
-                                             BynavMessageOpts const &opts) {
-  swri_serial_util::SerialConfig config;
-  config.baud = serial_baud_;
-  config.parity = swri_serial_util::SerialConfig::NO_PARITY;
-  config.flow_control = false;
-  config.data_bits = 8;
-  config.stop_bits = 1;
-  config.low_latency_mode = false;
-  config.writable = true;
+std::shared_future<CommandResult>
+BynavConnection::SendCommand(const std::string &command, int32_t timeout_ms) {
+  return commands_.Submit(command, PipelineNowNs(), timeout_ms);
+}
 
-  bool success = serial_.Open(device, config);
+bool BynavConnection::ExecuteCommands(const std::vector<std::string> &commands,
+                                      std::vector<CommandResult> *results,
+                                      int32_t timeout_ms) {
+  std::vector<std::shared_future<CommandResult>> futures;
+  for (const auto &command : commands) {
+    futures.push_back(SendCommand(command, timeout_ms));
+  }
 
-  if (success) {
-    is_connected_ = true;
-    if (!Configure(opts)) {
-      ROS_ERROR("Failed to configure GPS. This port may be read only, or the "
-                "device may not be functioning as expected; however, the "
-                "driver may still function correctly if the port has already "
-                "been pre-configured.");
+  bool success = WaitForCommands(futures);
+  if (results) {
+    results->clear();
+    for (auto &future : futures) {
+      results->push_back(future.get());
     }
-  } else {
-    error_msg_ = serial_.ErrorMsg();
   }
+  return success;
+}
+
+bool BynavConnection::ExecuteCommand(const std::string &command,
+                                     int32_t timeout_ms) {
+  return ExecuteCommands(std::vector<std::string>(1, command), nullptr,
+                         timeout_ms);
+}
 
+void BynavConnection::SetCommandTimeout(int32_t timeout_ms, int32_t retries) {
+  commands_.SetTimeout(timeout_ms, retries);
+}
+
+bool BynavConnection::WaitForCommands(
+    std::vector<std::shared_future<CommandResult>> &futures) {
+  bool owns_reads = boost::this_thread::get_id() == io_thread_;
+  bool success = true;
+  for (auto &future : futures) {
+    while (future.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready) {
+      if (owns_reads) {
+        // Nobody else reads the device while we are waiting here.
+        ReadResult result = ReadDevice(COMMAND_POLL_MS);
+        if (result == READ_ERROR) {
+          commands_.Cancel(error_msg_);
+        }
+      } else {
+        future.wait_for(std::chrono::milliseconds(COMMAND_POLL_MS));
+      }
+      commands_.Poll(PipelineNowNs());
+    }
+    success = future.get().Ok() && success;
+  }
   return success;
 }
 
+bool BynavConnection::CreateSerialConnection(const std::string &device) {
+  if (auto_baud_) {
+    return NegotiateBaud(device);
+  }
+  return OpenSerial(device, serial_baud_);
+}
+
+bool BynavConnection::OpenSerial(const std::string &device, int32_t baud) {
+  CloseSerial();
+
+  speed_t speed = BaudConstant(baud);
+  if (speed == B0) {
+    error_msg_ = "Unsupported baud rate: " + std::to_string(baud);
+    return false;
+  }
+
+  // Owning the descriptor lets it go straight into the caller's poll set.
+  int fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    error_msg_ = "Failed to open " + device + ": " + strerror(errno);
+    return false;
+  }
+
+  termios tio;
+  if (::tcgetattr(fd, &tio) != 0) {
+    error_msg_ = "Failed to read settings of " + device + ": " +
+                 strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  ::cfmakeraw(&tio);
+  tio.c_cflag &= ~(CSTOPB | CRTSCTS | CSIZE | PARENB);
+  tio.c_cflag |= CS8 | CLOCAL | CREAD;
+  tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  ::cfsetispeed(&tio, speed);
+  ::cfsetospeed(&tio, speed);
+  if (::tcsetattr(fd, TCSANOW, &tio) != 0) {
+    error_msg_ = "Failed to configure " + device + ": " + strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  // Anything buffered was sent at the previous rate.
+  ::tcflush(fd, TCIOFLUSH);
+
+  serial_fd_ = fd;
+  active_baud_ = baud;
+  return true;
+}
+
+void BynavConnection::CloseSerial() {
+  if (serial_fd_ >= 0) {
+    ::close(serial_fd_);
+    serial_fd_ = -1;
+  }
+}
+
+bool BynavConnection::WriteSerial(const uint8_t *data, size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t result = ::write(serial_fd_, data + written, size - written);
+    if (result > 0) {
+      written += static_cast<size_t>(result);
+      continue;
+    }
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The port is non-blocking; wait for the driver to drain.
+      pollfd fd;
+      fd.fd = serial_fd_;
+      fd.events = POLLOUT;
+      fd.revents = 0;
+      if (::poll(&fd, 1, SERIAL_WRITE_TIMEOUT_MS) > 0 &&
+          (fd.revents & POLLOUT)) {
+        continue;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+ros::Time BynavConnection::MonotonicStamp() const {
+  timespec monotonic;
+  ::clock_gettime(CLOCK_MONOTONIC, &monotonic);
+  return ros::Time().fromNSec(monotonic.tv_sec * 1000000000LL +
+                              monotonic.tv_nsec + monotonic_offset_ns_);
+}
+
+BynavConnection::ReadResult
+BynavConnection::ReadSerial(std::vector<uint8_t> &data, int32_t timeout_ms,
+                            ros::Time &stamp) {
+  if (serial_fd_ < 0) {
+    error_msg_ = "Serial device is not open.";
+    return READ_ERROR;
+  }
+
+  pollfd fd;
+  fd.fd = serial_fd_;
+  fd.events = POLLIN;
+  fd.revents = 0;
+  int ready = ::poll(&fd, 1, timeout_ms);
+  stamp = MonotonicStamp();
+  if (ready == 0) {
+    error_msg_ = "Timed out waiting for serial device.";
+    return READ_TIMEOUT;
+  } else if (ready < 0) {
+    if (errno == EINTR) {
+      error_msg_ = "Interrupted during read from serial device.";
+      return READ_INTERRUPTED;
+    }
+    error_msg_ = strerror(errno);
+    return READ_ERROR;
+  }
+  if (fd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+    error_msg_ = "Serial device hung up.";
+    return READ_ERROR;
+  }
+
+  size_t previous_size = data.size();
+  data.resize(previous_size + SERIAL_READ_SIZE);
+  ssize_t count = ::read(serial_fd_, data.data() + previous_size,
+                         SERIAL_READ_SIZE);
+  if (count <= 0) {
+    data.resize(previous_size);
+    if (count < 0 && errno == EINTR) {
+      error_msg_ = "Interrupted during read from serial device.";
+      return READ_INTERRUPTED;
+    }
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      error_msg_ = "Timed out waiting for serial device.";
+      return READ_TIMEOUT;
+    }
+    // Readable but empty means the adapter went away.
+    error_msg_ = count < 0 ? strerror(errno) : "Serial device hung up.";
+    return READ_ERROR;
+  }
+  data.resize(previous_size + static_cast<size_t>(count));
+  return READ_SUCCESS;
+}
+
+bool BynavConnection::ProbeSerial(int32_t timeout_ms) {
+  // A quiet receiver still answers this; one that is already logging
+  // usually doesn't need it.
+  std::string request = "log versiona once\r\n";
+  WriteSerial(reinterpret_cast<const uint8_t *>(request.data()),
+              request.size());
+
+  BynavMessageExtractor extractor;
+  std::string input;
+  std::vector<NmeaSentence> nmea_sentences;
+  std::vector<BynavSentence> bynav_sentences;
+  std::vector<BinaryMessage> binary_messages;
+  std::vector<BinaryMicroMessage> binary_micro_messages;
+  std::string remaining;
+
+  auto deadline = boost::chrono::steady_clock::now() +
+                  boost::chrono::milliseconds(timeout_ms);
+  while (boost::chrono::steady_clock::now() < deadline) {
+    int32_t left = static_cast<int32_t>(
+        boost::chrono::duration_cast<boost::chrono::milliseconds>(
+            deadline - boost::chrono::steady_clock::now())
+            .count());
+    std::vector<uint8_t> bytes;
+    ros::Time stamp;
+    ReadResult result = ReadSerial(bytes, std::max(left, 1), stamp);
+    if (result == READ_ERROR) {
+      return false;
+    } else if (result != READ_SUCCESS) {
+      continue;
+    }
+
+    input.insert(input.end(), bytes.begin(), bytes.end());
+    extractor.ExtractCompleteMessages(input, nmea_sentences, bynav_sentences,
+                                      binary_messages, binary_micro_messages,
+                                      remaining);
+    if (!nmea_sentences.empty() || !bynav_sentences.empty() ||
+        !binary_messages.empty() || !binary_micro_messages.empty()) {
+      return true;
+    }
+    input = remaining;
+  }
+
+  return false;
+}
+
+int32_t BynavConnection::DetectBaud(const std::string &device) {
+  static const int32_t COMMON_BAUD_RATES[] = {115200, 230400, 460800, 921600,
+                                              57600,  38400,  19200,  9600};
+
+  // The rate we last used and the configured one are the likely answers.
+  std::vector<int32_t> candidates;
+  if (active_baud_ > 0) {
+    candidates.push_back(active_baud_);
+  }
+  candidates.push_back(serial_baud_);
+  for (int32_t baud : COMMON_BAUD_RATES) {
+    if (std::find(candidates.begin(), candidates.end(), baud) ==
+        candidates.end()) {
+      candidates.push_back(baud);
+    }
+  }
+
+  for (int32_t baud : candidates) {
+    if (!OpenSerial(device, baud)) {
+      return -1;
+    }
+    if (ProbeSerial(BAUD_PROBE_TIMEOUT_MS)) {
+      ROS_INFO("Receiver found at %d baud.", baud);
+      return baud;
+    }
+  }
+
+  CloseSerial();
+  error_msg_ = "No response from the receiver at any common baud rate.";
+  return -1;
+}
+
+bool BynavConnection::NegotiateBaud(const std::string &device) {
+  int32_t current = DetectBaud(device);
+  if (current < 0) {
+    return false;
+  }
+
+  // Step down from the configured rate until one comes up cleanly.
+  static const int32_t UPGRADE_BAUD_RATES[] = {921600, 460800, 230400,
+                                               115200, 57600,  38400,
+                                               19200,  9600};
+  std::vector<int32_t> targets(1, serial_baud_);
+  for (int32_t baud : UPGRADE_BAUD_RATES) {
+    if (baud < serial_baud_) {
+      targets.push_back(baud);
+    }
+  }
+
+  for (int32_t target : targets) {
+    if (target <= current) {
+      break;
+    }
+
+    char command[64];
+    snprintf(command, sizeof(command), "SERIALCONFIG %s %d\r\n",
+             receiver_port_.c_str(), target);
+    WriteSerial(reinterpret_cast<const uint8_t *>(command), strlen(command));
+    boost::this_thread::sleep_for(
+        boost::chrono::milliseconds(BAUD_SWITCH_DELAY_MS));
+
+    if (OpenSerial(device, target) && ProbeSerial(BAUD_PROBE_TIMEOUT_MS)) {
+      ROS_INFO("Switched receiver from %d to %d baud.", current, target);
+      return true;
+    }
+
+    ROS_WARN("Receiver did not come up at %d baud.", target);
+    current = DetectBaud(device);
+    if (current < 0) {
+      return false;
+    }
+  }
+
+  if (current != serial_baud_) {
+    ROS_WARN("Using %d baud instead of the configured %d.", current,
+             serial_baud_);
+  }
+  return true;
+}
+
 bool BynavConnection::CreateIpConnection(const std::string &endpoint,
-                                         BynavMessageOpts const &opts) {
+                                         int32_t timeout_ms) {
   std::string ip;
   std::string port;
   uint16_t num_port;
@@ -165,8 +569,23 @@ bool BynavConnection::CreateIpConnection(const std::string &endpoint,
         boost::asio::ip::tcp::resolver::query query(ip, port);
         boost::asio::ip::tcp::resolver::iterator iter = resolver.resolve(query);
 
-        boost::asio::connect(tcp_socket_, iter);
         ROS_INFO("Connecting via TCP to %s:%s", ip.c_str(), port.c_str());
+        bool done = false;
+        boost::system::error_code error;
+        boost::asio::async_connect(
+            tcp_socket_, iter,
+            [&done, &error](const boost::system::error_code &result,
+                            boost::asio::ip::tcp::resolver::iterator) {
+              done = true;
+              error = result;
+            });
+        if (!RunIo(timeout_ms, done, [this]() { tcp_socket_.close(); })) {
+          error_msg_ = "Timed out connecting to " + endpoint + ".";
+          return false;
+        }
+        if (error) {
+          throw boost::system::system_error(error);
+        }
       } else {
         boost::asio::ip::udp::resolver resolver(io_service_);
         boost::asio::ip::udp::resolver::query query(ip, port);
@@ -179,24 +598,66 @@ bool BynavConnection::CreateIpConnection(const std::string &endpoint,
     } else {
       auto port_num = static_cast<uint16_t>(strtoll(port.c_str(), nullptr, 10));
       if (connection_ == TCP) {
-        boost::asio::ip::tcp::acceptor acceptor(
-            io_service_, boost::asio::ip::tcp::endpoint(
-                             boost::asio::ip::tcp::v4(), port_num));
-        ROS_INFO("Listening on TCP port %s", port.c_str());
-        acceptor.accept(tcp_socket_);
+        // Kept open between attempts so a client connecting in between
+        // waits in the backlog instead of being refused.
+        if (!tcp_acceptor_ ||
+            tcp_acceptor_->local_endpoint().port() != port_num) {
+          tcp_acceptor_.reset(new boost::asio::ip::tcp::acceptor(
+              io_service_, boost::asio::ip::tcp::endpoint(
+                               boost::asio::ip::tcp::v4(), port_num)));
+          ROS_INFO("Listening on TCP port %s", port.c_str());
+        }
+
+        bool done = false;
+        boost::system::error_code error;
+        tcp_acceptor_->async_accept(
+            tcp_socket_,
+            [&done, &error](const boost::system::error_code &result) {
+              done = true;
+              error = result;
+            });
+        if (!RunIo(timeout_ms, done, [this]() { tcp_acceptor_->cancel(); })) {
+          waiting_for_peer_ = true;
+          error_msg_ = "Waiting for a TCP client on port " + port + ".";
+          return false;
+        }
+        if (error) {
+          throw boost::system::system_error(error);
+        }
+        tcp_acceptor_.reset();
         ROS_INFO("Accepted TCP connection from client: %s",
                  tcp_socket_.remote_endpoint().address().to_string().c_str());
       } else {
         udp_socket_.reset(new boost::asio::ip::udp::socket(
             io_service_, boost::asio::ip::udp::endpoint(
                              boost::asio::ip::udp::v4(), port_num)));
+        // Lets reads use the time the kernel received each datagram rather
+        // than when the driver got around to it.
+        int enable = 1;
+        if (::setsockopt(udp_socket_->native_handle(), SOL_SOCKET,
+                         SO_TIMESTAMPNS, &enable, sizeof(enable)) != 0) {
+          ROS_WARN("Unable to enable UDP receive timestamps: %s",
+                   strerror(errno));
+        }
         boost::array<char, 1> recv_buf;
         udp_endpoint_ = boost::make_shared<boost::asio::ip::udp::endpoint>();
-        boost::system::error_code error;
 
-        ROS_INFO("Listening on UDP port %s", port.c_str());
-        udp_socket_->receive_from(boost::asio::buffer(recv_buf), *udp_endpoint_,
-                                  0, error);
+        ROS_INFO_THROTTLE(10.0, "Listening on UDP port %s", port.c_str());
+        bool done = false;
+        boost::system::error_code error;
+        udp_socket_->async_receive_from(
+            boost::asio::buffer(recv_buf), *udp_endpoint_,
+            [&done, &error](const boost::system::error_code &result, size_t) {
+              done = true;
+              error = result;
+            });
+        if (!RunIo(timeout_ms, done, [this]() { udp_socket_->cancel(); })) {
+          waiting_for_peer_ = true;
+          error_msg_ = "Waiting for a UDP datagram on port " + port + ".";
+          udp_socket_.reset();
+          udp_endpoint_.reset();
+          return false;
+        }
         if (error && error != boost::asio::error::message_size) {
           throw boost::system::system_error(error);
         }
@@ -211,72 +672,248 @@ bool BynavConnection::CreateIpConnection(const std::string &endpoint,
     return false;
   }
 
-  is_connected_ = true;
+  return true;
+}
 
-  if (Configure(opts)) {
-    ROS_INFO("Configured GPS.");
-  } else {
-    ROS_ERROR("Failed to configure GPS. This port may be read only, or the "
-              "device may not be functioning as expected; however, the "
-              "driver may still function correctly if the port has already "
-              "been pre-configured.");
+bool BynavConnection::RunIo(int32_t timeout_ms, const bool &done,
+                            const std::function<void()> &cancel) {
+  io_service_.restart();
+  io_service_.run_for(std::chrono::milliseconds(timeout_ms));
+  if (done) {
+    return true;
   }
 
-  return true;
+  // Drain the cancelled operation so its handler never outlives the
+  // caller's state.
+  cancel();
+  io_service_.restart();
+  io_service_.run();
+  return false;
 }
 
 bool BynavConnection::Configure(BynavMessageOpts const &opts) {
-  bool configured = true;
-  std::stringstream unlogport;
-  unlogport << "unlogall\r\n";
-  configured = configured && Write(unlogport.str());
+  // Whoever configures the device reads its responses, even if it
+  // wasn't the thread that opened it.
+  io_thread_ = boost::this_thread::get_id();
 
+  std::vector<std::string> commands(1, "unlogall");
   for (const auto &option : opts) {
-    std::stringstream command;
-    command << std::setprecision(3);
-    if (option.second < 0.0) {
-      command << "log " << option.first << " onchanged\r\n";
-    } else {
-      command << "log " << option.first << " ontime " << option.second
-              << "\r\n";
+    commands.push_back(LogManager::LogCommand(option.first, option.second));
+  }
+
+  ConfigSnapshot::Entry wanted;
+  wanted.desired = ConfigSnapshot::HashCommands(commands);
+  std::string loglist;
+  if (snapshot_.Enabled() && QueryLogList(loglist)) {
+    ConfigSnapshot::Entry cached;
+    if (snapshot_.Load(device_, cached) && cached.desired == wanted.desired &&
+        cached.receiver == ConfigSnapshot::Hash(loglist)) {
+      ROS_INFO("Receiver logs match the snapshot in %s; not reconfiguring.",
+               snapshot_.FileName(device_).c_str());
+      configuration_skipped_ = true;
+      return true;
+    }
+  }
+
+  if (!ExecuteCommands(commands)) {
+    return false;
+  }
+
+  if (snapshot_.Enabled() && QueryLogList(loglist)) {
+    wanted.receiver = ConfigSnapshot::Hash(loglist);
+    if (!snapshot_.Store(device_, wanted)) {
+      ROS_WARN("Unable to write the configuration snapshot %s.",
+               snapshot_.FileName(device_).c_str());
+    }
+  }
+  return true;
+}
+
+bool BynavConnection::QueryLogList(std::string &loglist) {
+  std::vector<std::string> lines;
+  if (!QueryLog("log loglista once", "#LOGLISTA", 0, lines)) {
+    ROS_WARN("The receiver did not send its LOGLIST.");
+    return false;
+  }
+
+  BynavMessageExtractor extractor;
+  std::vector<NmeaSentence> nmea_sentences;
+  std::vector<BynavSentence> bynav_sentences;
+  std::vector<BinaryMessage> binary_messages;
+  std::vector<BinaryMicroMessage> binary_micro_messages;
+  std::string remaining;
+  extractor.ExtractCompleteMessages(lines.front(), nmea_sentences,
+                                    bynav_sentences, binary_messages,
+                                    binary_micro_messages, remaining);
+  if (bynav_sentences.empty()) {
+    ROS_WARN("Received a corrupt LOGLIST.");
+    return false;
+  }
+  loglist = boost::algorithm::join(bynav_sentences.front().body, ",");
+  return true;
+}
+
+bool BynavConnection::QueryLog(const std::string &command,
+                               const std::string &flag, int32_t quiet_ms,
+                               std::vector<std::string> &lines) {
+  size_t search_start = data_buffer_.size();
+  if (!ExecuteCommand(command)) {
+    return false;
+  }
+
+  // Until the first line arrives the usual timeout applies; after that,
+  // only the gap between lines.
+  auto deadline = boost::chrono::steady_clock::now() +
+                  boost::chrono::milliseconds(LOGLIST_TIMEOUT_MS);
+  while (true) {
+    auto begin = std::search(data_buffer_.begin() + search_start,
+                             data_buffer_.end(), flag.begin(), flag.end());
+    auto end = data_buffer_.end();
+    if (begin != data_buffer_.end()) {
+      static const std::string ENDLINE = "\r\n";
+      end = std::search(begin, data_buffer_.end(), ENDLINE.begin(),
+                        ENDLINE.end());
+    }
+
+    if (end != data_buffer_.end()) {
+      lines.emplace_back(begin, end + 2);
+      search_start = begin - data_buffer_.begin();
+      EraseData(search_start, end + 2 - data_buffer_.begin());
+      if (quiet_ms <= 0) {
+        return true;
+      }
+      deadline = boost::chrono::steady_clock::now() +
+                 boost::chrono::milliseconds(quiet_ms);
+      continue;
+    }
+
+    if (boost::chrono::steady_clock::now() >= deadline) {
+      return !lines.empty();
+    }
+    if (ReadDevice(COMMAND_POLL_MS) == READ_ERROR) {
+      return false;
+    }
+  }
+}
+
+int BynavConnection::NativeHandle() {
+  if (!is_connected_) {
+    return -1;
+  }
+  if (connection_ == SERIAL) {
+    return serial_fd_;
+  } else if (connection_ == TCP) {
+    return tcp_socket_.native_handle();
+  } else if (connection_ == UDP && udp_socket_) {
+    return udp_socket_->native_handle();
+  }
+  return -1;
+}
+
+BynavConnection::ReadResult
+BynavConnection::ReadChunk(std::vector<uint8_t> &data,
+                           std::vector<ReadStamp> &stamps) {
+  ReadResult result = ReadData();
+  data.clear();
+  data.swap(data_buffer_);
+  stamps.clear();
+  stamps.swap(read_stamps_);
+  return result;
+}
+
+void BynavConnection::EraseData(size_t begin, size_t end) {
+  data_buffer_.erase(data_buffer_.begin() + begin, data_buffer_.begin() + end);
+  for (auto &read : read_stamps_) {
+    if (read.end >= end) {
+      read.end -= end - begin;
+    } else if (read.end > begin) {
+      read.end = begin;
     }
-    configured = configured && Write(command.str());
   }
+}
 
-  return configured;
+void BynavConnection::ClearData() {
+  data_buffer_.clear();
+  read_stamps_.clear();
 }
 
 BynavConnection::ReadResult BynavConnection::ReadData() {
+  ReadResult result = ReadDevice(read_timeout_ms_);
+  commands_.Poll(PipelineNowNs());
+  return result;
+}
+
+BynavConnection::ReadResult BynavConnection::ReadDevice(int32_t timeout_ms) {
+  size_t previous_size = data_buffer_.size();
   if (connection_ == SERIAL) {
-    swri_serial_util::SerialPort::Result result =
-        serial_.ReadBytes(data_buffer_, 0, 1000);
+    ros::Time stamp;
+    ReadResult result = ReadSerial(data_buffer_, timeout_ms, stamp);
 
-    if (result == swri_serial_util::SerialPort::ERROR) {
-      error_msg_ = serial_.ErrorMsg();
+    if (result == READ_ERROR) {
+      // Usually an unplugged adapter; reopening is the only way back.
+      Disconnect();
       return READ_ERROR;
-    } else if (result == swri_serial_util::SerialPort::TIMEOUT) {
-      error_msg_ = "Timed out waiting for serial device.";
-      return READ_TIMEOUT;
-    } else if (result == swri_serial_util::SerialPort::INTERRUPTED) {
-      error_msg_ = "Interrupted during read from serial device.";
-      return READ_INTERRUPTED;
+    } else if (result != READ_SUCCESS) {
+      return result;
     }
 
+    read_stamps_.push_back(ReadStamp{data_buffer_.size(), stamp});
+    commands_.Feed(data_buffer_.data() + previous_size,
+                   data_buffer_.size() - previous_size, PipelineNowNs());
     return READ_SUCCESS;
   } else if (connection_ == TCP || connection_ == UDP) {
+    if (write_failed_.exchange(false)) {
+      error_msg_ = "Failed to write to network device.";
+      Disconnect();
+      return READ_ERROR;
+    }
+
     try {
       boost::system::error_code error;
       size_t len;
 
+      // Block in poll() rather than in the read so an idle socket times out
+      // like the serial port does instead of stalling the caller forever.
+      pollfd fd;
+      fd.fd = connection_ == TCP ? tcp_socket_.native_handle()
+                                 : udp_socket_->native_handle();
+      fd.events = POLLIN;
+      fd.revents = 0;
+      int ready = ::poll(&fd, 1, timeout_ms);
+      ros::Time stamp = MonotonicStamp();
+      if (ready == 0) {
+        error_msg_ = "Timed out waiting for network device.";
+        return READ_TIMEOUT;
+      } else if (ready < 0) {
+        if (errno == EINTR) {
+          error_msg_ = "Interrupted during read from network device.";
+          return READ_INTERRUPTED;
+        }
+        error_msg_ = strerror(errno);
+        return READ_ERROR;
+      }
+
       if (connection_ == TCP) {
         len = tcp_socket_.read_some(boost::asio::buffer(socket_buffer_), error);
       } else {
-        boost::asio::ip::udp::endpoint remote_endpoint;
-        len = udp_socket_->receive_from(boost::asio::buffer(socket_buffer_),
-                                        remote_endpoint);
+        ssize_t received = ReceiveDatagram(stamp);
+        if (received < 0) {
+          if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            error_msg_ = "Timed out waiting for network device.";
+            return READ_TIMEOUT;
+          }
+          error = boost::system::error_code(errno,
+                                            boost::system::system_category());
+        }
+        len = std::max<ssize_t>(received, 0);
       }
       data_buffer_.insert(data_buffer_.end(), socket_buffer_.begin(),
                           socket_buffer_.begin() + len);
+      if (len > 0) {
+        read_stamps_.push_back(ReadStamp{data_buffer_.size(), stamp});
+      }
+      commands_.Feed(data_buffer_.data() + previous_size, len,
+                     PipelineNowNs());
       if (error) {
         error_msg_ = error.message();
         Disconnect();
@@ -293,4 +930,34 @@ BynavConnection::ReadResult BynavConnection::ReadData() {
   return READ_ERROR;
 }
 
+ssize_t BynavConnection::ReceiveDatagram(ros::Time &stamp) {
+  iovec buffer;
+  buffer.iov_base = socket_buffer_.data();
+  buffer.iov_len = socket_buffer_.size();
+  char control[CMSG_SPACE(sizeof(timespec))];
+
+  msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &buffer;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  ssize_t len = ::recvmsg(udp_socket_->native_handle(), &message, MSG_DONTWAIT);
+  if (len < 0) {
+    return len;
+  }
+
+  for (cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr;
+       header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level == SOL_SOCKET &&
+        header->cmsg_type == SCM_TIMESTAMPNS) {
+      timespec received;
+      std::memcpy(&received, CMSG_DATA(header), sizeof(received));
+      stamp = ros::Time(received.tv_sec, received.tv_nsec);
+    }
+  }
+  return len;
+}
+
 } // namespace bynav_gps_driver
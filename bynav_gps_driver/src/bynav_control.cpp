@@ -3,6 +3,7 @@
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
+#include <algorithm>
 #include <sstream>
 
 #include <boost/algorithm/string/join.hpp>
@@ -12,47 +13,44 @@
 
 namespace bynav_gps_driver {
 
-BynavControl::BynavControl() {}
+BynavControl::BynavControl() : config_batch_depth_(0), save_pending_(false) {}
 
 bool BynavControl::StartBase(double lat, double lon, float height) {
   std::string str;
   char tempStr[128];
 
-  Write("RTKTYPE BASE");
+  ExecuteCommand("RTKTYPE BASE");
 
   sprintf(tempStr, "FIX POSITION %.9lf %.9lf %.3f", lat, lon, height);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
   return true;
 }
 
 bool BynavControl::StartBase() {
-  Write("RTKTYPE BASE");
+  ExecuteCommand("RTKTYPE BASE");
 
-  if (!Write("FIX AUTO"))
+  if (!ExecuteCommand("FIX AUTO"))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::StopBase() {
-  if (!Write("FIX NONE"))
+  if (!ExecuteCommand("FIX NONE"))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::StartRover() {
-  Write("RTKTYPE ROVER");
+  ExecuteCommand("RTKTYPE ROVER");
   return true;
 }
 
 bool BynavControl::StopRover() {
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetPJK(double a, double alpha, double L0, double W0,
@@ -62,11 +60,10 @@ bool BynavControl::SetPJK(double a, double alpha, double L0, double W0,
   sprintf(tempStr, "SET PJKPARA %.3f %.3f %.9lf %.9lf %.9lf %.9lf [%.9lf %s]",
           a, alpha, L0, W0, FN, FE, k0, eht ? "EHT" : "GHT");
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetOBSFreq(int freq) {
@@ -74,11 +71,10 @@ bool BynavControl::SetOBSFreq(int freq) {
   char tempStr[128];
   sprintf(tempStr, "SET OBSFREQ %.d", freq);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetOutputSource(BYNAV_OUTPUT_SOURCE_TPYE type) {
@@ -95,11 +91,10 @@ bool BynavControl::SetOutputSource(BYNAV_OUTPUT_SOURCE_TPYE type) {
   }
 
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetShiftDatum(double x, double y, double z) {
@@ -107,20 +102,19 @@ bool BynavControl::SetShiftDatum(double x, double y, double z) {
   char tempStr[128];
   sprintf(tempStr, "SET SHIFTDATUM %.9lf %.9lf %.9lf", x, y, z);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::Reboot() {
-  Write("REBOOT");
+  ExecuteCommand("REBOOT");
   return true;
 }
 
 bool BynavControl::Reset() {
-  Write("RESET");
+  ExecuteCommand("RESET");
   return true;
 }
 
@@ -134,11 +128,10 @@ bool BynavControl::SetSerial(BYNAV_PORT port, int bps) {
 
   sprintf(tempStr, "SERIALCONFIG COM%d %d", port, bps);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetINSTranslation(BYNAV_INS_STRANSLATION tranm, double x,
@@ -166,11 +159,10 @@ bool BynavControl::SetINSTranslation(BYNAV_INS_STRANSLATION tranm, double x,
   sprintf(tempStr, "SETINSTRANSLATION %s %.9f %.9f %.9f %.9f %.9f %.9f %s",
           tranStr, x, y, z, xsd, ysd, zsd, frameStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetINSRotation(BYNAV_INS_ROTATION rotm, double x, double y,
@@ -189,11 +181,10 @@ bool BynavControl::SetINSRotation(BYNAV_INS_ROTATION rotm, double x, double y,
   sprintf(tempStr, "SETINSROTATION %s %.9f %.9f %.9f %.9f %.9f %.9f", rotStr, x,
           y, z, xsd, ysd, zsd);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetAlignmentVel(double v) {
@@ -202,11 +193,10 @@ bool BynavControl::SetAlignmentVel(double v) {
 
   sprintf(tempStr, "SETALIGNMENTVEL %.3f", v);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::INSCalibrate(BYNAV_TRIGGER tri) {
@@ -224,11 +214,10 @@ bool BynavControl::INSCalibrate(BYNAV_TRIGGER tri) {
 
   sprintf(tempStr, "INSCALIBRATE RBV %s", triStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetINSProfile(BYNAV_PROFILE tri) {
@@ -244,11 +233,10 @@ bool BynavControl::SetINSProfile(BYNAV_PROFILE tri) {
 
   sprintf(tempStr, "SETINSPROFILE %s", proStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::AddAuth(std::string auth) {
@@ -257,26 +245,39 @@ bool BynavControl::AddAuth(std::string auth) {
 
   sprintf(tempStr, "AUTH ADD %s", auth.data());
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::RemoveAuth() {
-  Write("AUTH REMOVE");
-  Write("SAVECONFIG");
-  return true;
+  ExecuteCommand("AUTH REMOVE");
+  return SaveConfig();
 }
 
 bool BynavControl::SaveConfig() {
-  Write("SAVECONFIG");
-  return true;
+  // Flash writes are slow; inside a batch only the last one is done.
+  if (config_batch_depth_ > 0) {
+    save_pending_ = true;
+    return true;
+  }
+  return ExecuteCommand("SAVECONFIG", SAVECONFIG_TIMEOUT_MS);
+}
+
+void BynavControl::BeginConfigBatch() { config_batch_depth_++; }
+
+bool BynavControl::EndConfigBatch() {
+  if (config_batch_depth_ == 0 || --config_batch_depth_ > 0 ||
+      !save_pending_) {
+    return true;
+  }
+  save_pending_ = false;
+  return SaveConfig();
 }
 
 bool BynavControl::SaveEPHData() {
-  Write("SAVEEPHDATA");
+  ExecuteCommand("SAVEEPHDATA");
   return true;
 }
 
@@ -286,11 +287,10 @@ bool BynavControl::RTKTimeout(int s) {
 
   sprintf(tempStr, "RTKTIMEOUT %d", s);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetECutOff(double angle) {
@@ -299,11 +299,10 @@ bool BynavControl::SetECutOff(double angle) {
 
   sprintf(tempStr, "ECUTOFF %.3f", angle);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetSNRCutOff(double snr) {
@@ -312,11 +311,10 @@ bool BynavControl::SetSNRCutOff(double snr) {
 
   sprintf(tempStr, "SNRCUTOFF %.3f", snr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetBaseLine(double length, double off) {
@@ -325,11 +323,10 @@ bool BynavControl::SetBaseLine(double length, double off) {
 
   sprintf(tempStr, "SETBASELINE ON %.3f %.3f", length, off);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::NetConfig(std::string ip, std::string netmask,
@@ -340,19 +337,17 @@ bool BynavControl::NetConfig(std::string ip, std::string netmask,
   sprintf(tempStr, "IPCONFIG ETHA STATIC %s %s %s", ip.data(), netmask.data(),
           gateway.data());
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::NetConfigDHCP() {
-  if (!Write("IPCONFIG ETHA DHCP"))
+  if (!ExecuteCommand("IPCONFIG ETHA DHCP"))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::ICOMConfig(BYNAV_PORT port, std::string host, int net_port,
@@ -367,11 +362,10 @@ bool BynavControl::ICOMConfig(BYNAV_PORT port, std::string host, int net_port,
   sprintf(tempStr, "ICOMCONFIG ICOM%d %s %s:%d", (port - 10),
           (proto == NP_TCP) ? "TCP" : "UDP", host.data(), net_port);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::ICOMDisable(BYNAV_PORT port) {
@@ -384,11 +378,10 @@ bool BynavControl::ICOMDisable(BYNAV_PORT port) {
 
   sprintf(tempStr, "ICOMCONFIG ICOM%d DISABLED", (port - 10));
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetFrequencyOut(int plusewidth, int period,
@@ -400,11 +393,10 @@ bool BynavControl::SetFrequencyOut(int plusewidth, int period,
   sprintf(tempStr, "FREQUENCYOUT ENABLE %d %d %s %d", plusewidth, period,
           (ttl == TTL_POSITIVE) ? "POSITIVE" : "NEGATIVE", instance);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::Freset(char *cmd) {
@@ -413,11 +405,12 @@ bool BynavControl::Freset(char *cmd) {
 
   sprintf(tempStr, "FRESET %s", cmd);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  ClearReceiverConfig();
+
+  return SaveConfig();
 }
 
 bool BynavControl::DualAntennaPower(bool flag) {
@@ -426,11 +419,10 @@ bool BynavControl::DualAntennaPower(bool flag) {
 
   sprintf(tempStr, "DUALANTENNAPOWER %s", flag ? "ON" : "OFF");
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::SetGPSRefWeek(int weeknum) {
@@ -439,11 +431,10 @@ bool BynavControl::SetGPSRefWeek(int weeknum) {
 
   sprintf(tempStr, "GPSREFWEEK %d", weeknum);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::LogRTCM3(BYNAV_PORT port) {
@@ -458,51 +449,50 @@ bool BynavControl::LogRTCM3(BYNAV_PORT port) {
 
   sprintf(tempStr, "UNLOGALL %s", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "INTERFACEMODE %s BYNAV RTCM ON", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s RTCM1074 ONTIME 1", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s RTCM1084 ONTIME 1", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s RTCM1094 ONTIME 1", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s RTCM1114 ONTIME 1", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s RTCM1124 ONTIME 1", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s RTCM1006 ONTIME 5", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s RTCM1033 ONTIME 10", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::LogRecord(BYNAV_PORT port, int interval) {
@@ -519,37 +509,35 @@ bool BynavControl::LogRecord(BYNAV_PORT port, int interval) {
 
   sprintf(tempStr, "LOG %s RANGECMPB ONTIME %d", portStr, interval);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s GPSEPHEMB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s BDSEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s GLOEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s GALEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s QZSSEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::StopRecord(BYNAV_PORT port) {
@@ -565,27 +553,27 @@ bool BynavControl::StopRecord(BYNAV_PORT port) {
 
   sprintf(tempStr, "LOG %s GPSEPHEMB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s BDSEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s GLOEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s GALEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "LOG %s QZSSEPHEMERISB ONCHANGED", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
   return true;
 }
@@ -603,22 +591,12 @@ bool BynavControl::StopDiff(BYNAV_PORT port) {
 
   sprintf(tempStr, "UNLOGALL %s", portStr);
   str.assign(tempStr);
-  if (!Write(str)) {
-    usleep(500 * 1000);
-    if (!Write(str)) {
-      usleep(500 * 1000);
-      if (!Write(str)) {
-        usleep(500 * 1000);
-        if (!Write(str)) {
-          return false;
-        }
-      }
-    }
-  }
+  if (!ExecuteCommand(str))
+    return false;
 
   sprintf(tempStr, "INTERFACEMODE %s BYNAV BYNAV on", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   return true;
@@ -645,12 +623,12 @@ bool BynavControl::RTKMode(BYNAV_PORT port) {
 
   sprintf(tempStr, "INTERFACEMODE %s AUTO BYNAV", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
   sprintf(tempStr, "UNLOGALL %s", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
   return true;
 }
@@ -694,7 +672,7 @@ bool BynavControl::InrerfaceMode(BYNAV_PORT port, BYNAV_PROTO in,
 
   sprintf(tempStr, "INTERFACEMODE %s %s %s", portStr, inStr, outStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
   return true;
 }
@@ -712,74 +690,58 @@ bool BynavControl::UnlogAll(BYNAV_PORT port) {
 
   sprintf(tempStr, "UNLOGALL %s", portStr);
   str.assign(tempStr);
-  if (!Write(str)) {
-    usleep(500 * 1000);
-    if (!Write(str)) {
-      usleep(500 * 1000);
-      if (!Write(str)) {
-        usleep(500 * 1000);
-        if (!Write(str)) {
-          return false;
-        }
-      }
-    }
-  }
+  if (!ExecuteCommand(str))
+    return false;
 
   sprintf(tempStr, "INTERFACEMODE %s BYNAV BYNAV on", portStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     ;
 
   return true;
 }
 
 bool BynavControl::UnlogAllPorts() {
-  if (!Write("UNLOGALL"))
+  if (!ExecuteCommand("UNLOGALL"))
     return false;
   return true;
 }
 
 bool BynavControl::Init() {
-  if (!Write("LOG VERSION")) {
-    sleep(1);
-    if (!Write("LOG VERSION")) {
-      return false;
-    }
-  }
+  if (!ExecuteCommand("LOG VERSION"))
+    return false;
 
-  Write("UNLOGALL");
-  if (!Write("LOG BESTPOSB ONTIME 1"))
+  ExecuteCommand("UNLOGALL");
+  if (!ExecuteCommand("LOG BESTPOSB ONTIME 1"))
     return false;
 
-  if (!Write("IPCONFIG DHCP"))
+  if (!ExecuteCommand("IPCONFIG DHCP"))
     ;
 
-  if (!Write("NMEATALKER AUTO"))
+  if (!ExecuteCommand("NMEATALKER AUTO"))
     ;
 
-  if (!Write("NETPORTCONFIG ICOM1 TCP 3001"))
+  if (!ExecuteCommand("NETPORTCONFIG ICOM1 TCP 3001"))
     ;
-  if (!Write("NETPORTCONFIG ICOM2 TCP 3002"))
+  if (!ExecuteCommand("NETPORTCONFIG ICOM2 TCP 3002"))
     ;
-  if (!Write("NETPORTCONFIG ICOM3 TCP 3003"))
+  if (!ExecuteCommand("NETPORTCONFIG ICOM3 TCP 3003"))
     ;
-  if (!Write("NETPORTCONFIG ICOM4 TCP 3004"))
+  if (!ExecuteCommand("NETPORTCONFIG ICOM4 TCP 3004"))
     ;
 
-  Write("INTERFACEMODE ICOM1 BYNAV BYNAV ON");
-  Write("INTERFACEMODE ICOM2 BYNAV BYNAV ON");
-  Write("INTERFACEMODE ICOM3 BYNAV BYNAV ON");
-  Write("INTERFACEMODE ICOM4 BYNAV BYNAV ON");
+  ExecuteCommand("INTERFACEMODE ICOM1 BYNAV BYNAV ON");
+  ExecuteCommand("INTERFACEMODE ICOM2 BYNAV BYNAV ON");
+  ExecuteCommand("INTERFACEMODE ICOM3 BYNAV BYNAV ON");
+  ExecuteCommand("INTERFACEMODE ICOM4 BYNAV BYNAV ON");
 
-  Write("FIX NONE");
+  ExecuteCommand("FIX NONE");
 
-  usleep(200 * 1000);
-  Write("INTERFACEMODE COM1 BYNAV BYNAV ON");
-  Write("INTERFACEMODE COM2 BYNAV BYNAV ON");
-  Write("INTERFACEMODE COM3 BYNAV BYNAV ON");
+  ExecuteCommand("INTERFACEMODE COM1 BYNAV BYNAV ON");
+  ExecuteCommand("INTERFACEMODE COM2 BYNAV BYNAV ON");
+  ExecuteCommand("INTERFACEMODE COM3 BYNAV BYNAV ON");
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::NtripServer(BYNAV_PORT port, BYNAV_NTRIP_VER proto,
@@ -802,11 +764,10 @@ bool BynavControl::NtripServer(BYNAV_PORT port, BYNAV_NTRIP_VER proto,
           (port - 20), proto, endpoint.data(), username.data(), password.data(),
           netPortStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::NtripClient(BYNAV_PORT port, BYNAV_NTRIP_VER proto,
@@ -829,11 +790,10 @@ bool BynavControl::NtripClient(BYNAV_PORT port, BYNAV_NTRIP_VER proto,
           (port - 20), proto, endpoint.data(), username.data(), password.data(),
           netPortStr);
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::NtripDisable(BYNAV_PORT port) {
@@ -845,25 +805,22 @@ bool BynavControl::NtripDisable(BYNAV_PORT port) {
 
   sprintf(tempStr, "NTRIPCONFIG NCOM%d DISABLED", (port - 20));
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
     return false;
 
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::QualityCheckEnable() {
-  if (!Write("QUALITYCHECK POS ON"))
+  if (!ExecuteCommand("QUALITYCHECK POS ON"))
     return false;
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::QualityCheckDisable() {
-  if (!Write("QUALITYCHECK POS OFF"))
+  if (!ExecuteCommand("QUALITYCHECK POS OFF"))
     return false;
-  Write("SAVECONFIG");
-  return true;
+  return SaveConfig();
 }
 
 bool BynavControl::DNSConfig(std::string dns) {
@@ -872,14 +829,114 @@ bool BynavControl::DNSConfig(std::string dns) {
 
   sprintf(tempStr, "DNSCONFIG 1 %s", dns.data());
   str.assign(tempStr);
-  if (!Write(str))
+  if (!ExecuteCommand(str))
+    return false;
+
+  return SaveConfig();
+}
+
+bool BynavControl::Configure(BynavMessageOpts const &opts) {
+  bool configured = BynavConnection::Configure(opts);
+  // A receiver that still matches its snapshot hasn't been touched, so the
+  // model from the previous connect still holds; querying it again would
+  // hold up the first data after a reconnect.
+  if (!ConfigurationSkipped()) {
+    RefreshReceiverConfig();
+  }
+  return configured;
+}
+
+bool BynavControl::RefreshReceiverConfig() {
+  std::string rxconfig;
+  if (!QueryRxConfig(rxconfig)) {
+    ROS_WARN("The receiver did not send its RXCONFIG; every setting will be "
+             "sent.");
+    ClearReceiverConfig();
     return false;
+  }
 
-  Write("SAVECONFIG");
+  ReceiverConfig config;
+  size_t loaded = config.LoadRxConfig(rxconfig);
+  {
+    boost::unique_lock<boost::mutex> lock(receiver_config_mutex_);
+    receiver_config_ = config;
+  }
+  ROS_INFO("Loaded %lu receiver settings from RXCONFIG.", loaded);
+  return true;
+}
+
+bool BynavControl::QueryRxConfig(std::string &rxconfig) {
+  std::vector<std::string> lines;
+  if (!QueryLog("log rxconfiga once", "#RXCONFIGA", RXCONFIG_QUIET_MS,
+                lines)) {
+    return false;
+  }
+  rxconfig = boost::algorithm::join(lines, "");
   return true;
 }
 
 bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
+  std::vector<std::string> changes;
+  {
+    boost::unique_lock<boost::mutex> lock(receiver_config_mutex_);
+    changes = receiver_config_.Diff(ConfigCommands(conf));
+  }
+  if (changes.empty()) {
+    ROS_INFO("Receiver configuration is already up to date.");
+    return true;
+  }
+
+  size_t applied = 0;
+  if (!SendCommands(changes, applied)) {
+    ROS_ERROR("Receiver configuration failed, rolling back %lu of %lu "
+              "changes.",
+              applied, changes.size());
+    RollbackCommands(changes, applied);
+    return false;
+  }
+
+  {
+    boost::unique_lock<boost::mutex> lock(receiver_config_mutex_);
+    for (const auto &command : changes) {
+      receiver_config_.Set(command);
+    }
+  }
+  ROS_INFO("Applied %lu receiver configuration changes.", changes.size());
+  return SaveConfig();
+}
+
+bool BynavControl::SendCommands(const std::vector<std::string> &commands,
+                                size_t &applied) {
+  // The receiver carries on after a rejected command, so anything in the
+  // batch may have taken effect.
+  applied = commands.size();
+  return ExecuteCommands(commands);
+}
+
+void BynavControl::RollbackCommands(const std::vector<std::string> &commands,
+                                    size_t applied) {
+  ReceiverConfig known = GetReceiverConfig();
+  std::vector<std::string> previous_values;
+  for (size_t i = std::min(applied, commands.size()); i-- > 0;) {
+    std::string key = ReceiverConfig::Key(commands[i]);
+    std::string previous = known.Get(key);
+    if (previous.empty()) {
+      ROS_WARN("Previous value of %s is unknown; it was not rolled back.",
+               key.c_str());
+      continue;
+    }
+    previous_values.push_back(previous);
+  }
+
+  if (!previous_values.empty() && !ExecuteCommands(previous_values)) {
+    ROS_ERROR("Rolling back the receiver configuration failed.");
+  }
+}
+
+std::vector<std::string>
+BynavControl::ConfigCommands(const bynav_gps_msgs::BynavConfig &conf) {
+  std::vector<std::string> commands;
+
   if (!conf.modes.empty()) {
     for (auto &mode : conf.modes) {
       std::string str;
@@ -888,8 +945,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
       sprintf(tempStr, "INTERFACEMODE %s %s %s ON", mode.port.data(),
               mode.formatin.data(), mode.formatout.data());
       str.assign(tempStr);
-      if (!Write(str))
-        return false;
+      commands.push_back(str);
     }
   }
 
@@ -900,8 +956,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
       sprintf(tempStr, "SERIALCONFIG COM%d %d", serial.port, serial.bps);
       str.assign(tempStr);
-      if (!Write(str))
-        return false;
+      commands.push_back(str);
     }
   }
 
@@ -913,8 +968,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
       sprintf(tempStr, "ICOMCONFIG ICOM%d %s %d", icom.port,
               icom.protocol.data(), icom.endpoint);
       str.assign(tempStr);
-      if (!Write(str))
-        return false;
+      commands.push_back(str);
     }
   }
 
@@ -928,16 +982,14 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
                 freq_out.pluse_width, freq_out.period, freq_out.edge.data(),
                 freq_out.instance);
         str.assign(tempStr);
-        if (!Write(str))
-          return false;
+        commands.push_back(str);
       } else {
         std::string str;
         char tempStr[128];
 
         sprintf(tempStr, "FREQUENCYOUT DISABLE %d", freq_out.instance);
         str.assign(tempStr);
-        if (!Write(str))
-          return false;
+        commands.push_back(str);
       }
     }
   }
@@ -952,8 +1004,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
               ntrip_port.endpoint.data(), ntrip_port.mountpoint.data(),
               ntrip_port.username.data(), ntrip_port.password.data());
       str.assign(tempStr);
-      if (!Write(str))
-        return false;
+      commands.push_back(str);
     }
   }
 
@@ -965,8 +1016,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
         sprintf(tempStr, "WORKFREQS %s", work_freq.freq.data());
         str.assign(tempStr);
-        if (!Write(str))
-          return false;
+        commands.push_back(str);
       } else {
         std::string str;
         char tempStr[128];
@@ -974,8 +1024,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
         sprintf(tempStr, "WORKFREQS %s %s", work_freq.freq.data(),
                 work_freq.system.data());
         str.assign(tempStr);
-        if (!Write(str))
-          return false;
+        commands.push_back(str);
       }
     }
   }
@@ -987,8 +1036,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
             conf.a, conf.alpha, conf.L0, conf.W0, conf.FN, conf.FE, conf.k0,
             conf.eht.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_alignment_vel) {
@@ -997,8 +1045,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "SETALIGNMENTVEL %.3f", conf.alignment_vel);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_ins_rot_flag) {
@@ -1008,8 +1055,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
             conf.rot_x, conf.rot_y, conf.rot_z, conf.rot_xsd, conf.rot_ysd,
             conf.rot_zsd);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_ins_tran_flag) {
@@ -1020,8 +1066,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
             conf.tran_xsd, conf.tran_ysd, conf.tran_zsd,
             conf.tran_input_frame.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_ins_calibrate_flag) {
@@ -1031,8 +1076,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "INSCALIBRATE %s %s %f", conf.offset.data(),
             conf.trigger.data(), conf.sd_threshold);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_dns_config_flag) {
@@ -1041,8 +1085,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "DNSCONFIG 1 %s", conf.dns.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_ip_config_flag) {
@@ -1052,8 +1095,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "IPCONFIG ETHA %s %s %s %s", conf.address_mode.data(),
             conf.ip_address.data(), conf.netmask.data(), conf.gateway.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_ins_profile_flag) {
@@ -1062,8 +1104,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "SETINSPROFILE %s", conf.ins_profile.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_auth_flag) {
@@ -1072,8 +1113,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "AUTH ADD %s", conf.auth.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_dualantenna_power_flag) {
@@ -1083,8 +1123,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "DUALANTENNAPOWER %s",
             (conf.dualantenna_power) ? "ON" : "OFF");
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_gps_ref_week_flag) {
@@ -1093,8 +1132,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "GPSREFWEEK %d", conf.gps_ref_week);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_rtk_type_flag) {
@@ -1103,8 +1141,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "RTKTYPE %s", conf.rtk_type.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_ecutoff_flag) {
@@ -1113,8 +1150,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "ECUTOFF %f", conf.ecutoff);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_base_line_flag) {
@@ -1124,8 +1160,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "SETBASELINE ON %f %f", conf.base_line_length,
             conf.base_line_offset);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_snrcutoff_flag) {
@@ -1134,8 +1169,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "SNRCUTOFF %f", conf.snrcutoff);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_shift_utm_flag) {
@@ -1145,8 +1179,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "SET SHIFTDATUM %f %f %f", conf.x_offset, conf.y_offset,
             conf.z_offset);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_obs_freq_flag) {
@@ -1155,8 +1188,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "SET OBSFREQ %d", conf.obs_freq);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_fpga_raw_freq_flag) {
@@ -1165,8 +1197,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "SET FPGARAWFREQ %d", conf.fpga_raw_freq);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_output_source_flag) {
@@ -1175,8 +1206,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "OUTPUTSOURCE %s", conf.output_source.data());
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_fix_pos_flag) {
@@ -1186,8 +1216,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "FIX POSITION %f %f %f", conf.fix_pos_lon,
             conf.fix_pos_lat, conf.fix_pos_alt);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_rtktimeout_flag) {
@@ -1196,8 +1225,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "RTKTIMEOUT %d", conf.rtktimeout);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_quality_check) {
@@ -1207,8 +1235,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "QUALITYCHECK %s %s", conf.quality_check_pos.data(),
             conf.quality_switch ? "ON" : "OFF");
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_heading_offset) {
@@ -1218,8 +1245,7 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
     sprintf(tempStr, "HEADINGOFFSET %f %f", conf.heading_offsetin_deg,
             conf.pitch_offsetin_deg);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
   if (conf.set_vel_period) {
@@ -1228,10 +1254,9 @@ bool BynavControl::SetupConfig(const bynav_gps_msgs::BynavConfig &conf) {
 
     sprintf(tempStr, "VELSMOOTH %f", conf.vel_period);
     str.assign(tempStr);
-    if (!Write(str))
-      return false;
+    commands.push_back(str);
   }
 
-  return Write("SAVECONFIG");
+  return commands;
 }
 } // namespace bynav_gps_driver
@@ -20,7 +20,8 @@ const std::string BynavMessageExtractor::HEADER_SEPARATOR = ";";
 const std::string BynavMessageExtractor::NMEA_SENTENCE_FLAG = "$";
 const std::string BynavMessageExtractor::BYNAV_SENTENCE_FLAG = "#";
 const std::string BynavMessageExtractor::BYNAV_MM_FLAG = "%";
-const std::string BynavMessageExtractor::BYNAV_ASCII_FLAGS = "$#%";
+const std::string BynavMessageExtractor::BYNAV_RESPONSE_FLAG = "<";
+const std::string BynavMessageExtractor::BYNAV_ASCII_FLAGS = "$#%<";
 const std::string BynavMessageExtractor::BYNAV_BINARY_SYNC_BYTES =
     "\xAA\x44\x12";
 const std::string BynavMessageExtractor::BYNAV_ENDLINE = "\r\n";
@@ -357,7 +358,11 @@ bool BynavMessageExtractor::ExtractCompleteMessages(
         BinaryMessage cur_msg;
         int32_t result = GetBinaryMessage(input, binary_start_idx, cur_msg);
         if (result > 0) {
-          binary_messages.push_back(cur_msg);
+          // Command responses are matched by the connection, not parsed.
+          if (!(static_cast<uint8_t>(cur_msg.header_.message_type_) &
+                BINARY_RESPONSE_BIT)) {
+            binary_messages.push_back(cur_msg);
+          }
           sentence_start += binary_start_idx + result;
           ROS_DEBUG("Parsed a binary message with %u bytes.", result);
         } else if (result == -1) {
@@ -399,7 +404,11 @@ bool BynavMessageExtractor::ExtractCompleteMessages(
       } else if (ascii_end_idx != std::string::npos) {
         ROS_DEBUG("ASCII sentence:\n[%s]",
                   input.substr(ascii_start_idx, ascii_len).c_str());
-        if (input[ascii_start_idx] == NMEA_SENTENCE_FLAG[0]) {
+        if (input[ascii_start_idx] == BYNAV_RESPONSE_FLAG[0]) {
+          // "<OK" and friends answer commands; abbreviated logs are not
+          // parsed either.
+          sentence_start = ascii_end_idx;
+        } else if (input[ascii_start_idx] == NMEA_SENTENCE_FLAG[0]) {
           std::string cur_sentence;
           int32_t result = GetNmeaSentence(input, ascii_start_idx, cur_sentence,
                                            keep_nmea_container);
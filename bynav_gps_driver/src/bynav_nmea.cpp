@@ -1,4 +1,9 @@
 #include <bynav_gps_driver/bynav_nmea.h>
+#include <bynav_gps_driver/imu_models.h>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <set>
 #include <net/ethernet.h>
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
@@ -9,30 +14,117 @@
 #include <boost/make_shared.hpp>
 
 #include <rclcpp/rclcpp.hpp>
-#include <tf/tf.h>
 
 namespace bynav_gps_driver {
 
+namespace {
+
+// Messages that feed IMU/INS output; parsed before anything else in a read.
+bool IsCriticalBinary(uint16_t id) {
+  switch (id) {
+  case CorrImuDataParser::MESSAGE_ID:
+  case InsattParser::MESSAGE_ID:
+  case InspvaParser::MESSAGE_ID:
+  case InspvaxParser::MESSAGE_ID:
+  case BestposParser::MESSAGE_ID:
+  case RawIMUParser::MESSAGE_ID:
+  case MarkTimeParser::MESSAGE_ID:
+  case Mark2TimeParser::MESSAGE_ID:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool IsCriticalAscii(const std::string &id) {
+  return id == "CORRIMUDATAA" || id == "INSATTA" || id == "INSPVAA" ||
+         id == "INSPVAXA" || id == "BESTPOSA" || id == "RAWIMUA" ||
+         id == "RAWIMUSA" || id == "MARKTIMEA" || id == "MARK2TIMEA";
+}
+
+// Large, low-rate messages that nothing time-critical depends on.
+bool IsBulkBinary(uint16_t id) {
+  switch (id) {
+  case BdsephemerisbParser::MESSAGE_ID:
+  case GaleephemerisbParser::MESSAGE_ID:
+  case GloephemerisbParser::MESSAGE_ID:
+  case GpsephembParser::MESSAGE_ID:
+  case QzssephemerisbParser::MESSAGE_ID:
+  case RangrcmpbParser::MESSAGE_ID:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool IsBulkNmea(const std::string &id) {
+  return id == GpgsvParser::MESSAGE_NAME;
+}
+
+} // namespace
+
 BynavNmea::BynavNmea()
     : gpsfix_sync_tol_(0.01), wait_for_sync_(true), imu_rate_forced_(false),
-      utc_offset_(0), corrimudata_msgs_(MAX_BUFFER_SIZE),
+      gps_time_stamps_(false), leap_seconds_(0), refclock_offset_s_(0.0),
+      refclock_second_(-1),
+      corrimudata_msgs_(MAX_BUFFER_SIZE),
       gpgga_msgs_(MAX_BUFFER_SIZE), gpgsv_msgs_(MAX_BUFFER_SIZE),
       gphdt_msgs_(MAX_BUFFER_SIZE), gprmc_msgs_(MAX_BUFFER_SIZE),
       imu_msgs_(MAX_BUFFER_SIZE), inspva_msgs_(MAX_BUFFER_SIZE),
       inspvax_msgs_(MAX_BUFFER_SIZE), insstdev_msgs_(MAX_BUFFER_SIZE),
+      inscov_msgs_(MAX_BUFFER_SIZE),
       bynav_positions_(MAX_BUFFER_SIZE), bynav_gnss_positions_(MAX_BUFFER_SIZE),
       bynav_pjk_positions_(MAX_BUFFER_SIZE), bynav_velocities_(MAX_BUFFER_SIZE),
-      bestpos_sync_buffer_(SYNC_BUFFER_SIZE),
-      bestvel_sync_buffer_(SYNC_BUFFER_SIZE), heading_msgs_(MAX_BUFFER_SIZE),
+      heading_msgs_(MAX_BUFFER_SIZE),
       gpdop_msgs_(MAX_BUFFER_SIZE), bdsephemerisb_msgs_(MAX_BUFFER_SIZE),
       galephemerisb_msgs_(MAX_BUFFER_SIZE),
       gloephemerisb_msgs_(MAX_BUFFER_SIZE), gpsephemb_msgs_(MAX_BUFFER_SIZE),
       qzssephemerisb_msgs_(MAX_BUFFER_SIZE), rangecmpb_msgs_(MAX_BUFFER_SIZE),
-      imu_rate_(-1.0), enable_imu_(false), use_micro_imu_msg_(false) {}
+      imu_sync_(GpsTimeSyncPolicy::APPROXIMATE, IMU_TOLERANCE_S),
+      imu_interpolate_(false), imu_max_wait_s_(0.1), imu_held_samples_(0),
+      imu_dropped_samples_(0), imu_batching_(false),
+      imu_arrays_(MAX_BUFFER_SIZE), event_poses_(false),
+      event_pose_msgs_(MAX_BUFFER_SIZE), events_without_pose_(0),
+      imu_rate_(-1.0), enable_imu_(false), use_micro_imu_msg_(false),
+      bulk_service_(nullptr), bulk_parse_failures_(0), default_logs_(true) {}
+
+BynavNmea::~BynavNmea() { SetBulkWorkers(0); }
+
+void BynavNmea::SetBulkWorkers(int32_t workers) {
+  bulk_service_ = nullptr;
+  if (bulk_work_) {
+    // Let queued jobs finish before the workers exit.
+    bulk_work_.reset();
+    for (auto &worker : bulk_workers_) {
+      worker.join();
+    }
+    bulk_workers_.clear();
+    bulk_io_service_.reset();
+  }
 
-bool BynavNmea::Connect(const std::string &device, ConnectionType connection,
-                        BynavMessageOpts const &oopts) {
+  if (workers > 0) {
+    bulk_work_.reset(new boost::asio::io_service::work(bulk_io_service_));
+    for (int32_t i = 0; i < workers; i++) {
+      bulk_workers_.emplace_back([this]() { bulk_io_service_.run(); });
+    }
+    bulk_service_ = &bulk_io_service_;
+  }
+}
+
+void BynavNmea::SetBulkService(boost::asio::io_service *service) {
+  SetBulkWorkers(0);
+  bulk_service_ = service;
+}
+
+bool BynavNmea::Configure(BynavMessageOpts const &oopts) {
   BynavMessageOpts opts = oopts;
+  if (default_logs_) {
+    AddDefaultLogs(opts);
+  }
+  return BynavControl::Configure(opts);
+}
+
+void BynavNmea::AddDefaultLogs(BynavMessageOpts &opts) {
   opts["gpgga"] = 0.05;
   opts["gprmc"] = 0.05;
   opts["bestposa"] = 0.05;
@@ -44,7 +136,6 @@ bool BynavNmea::Connect(const std::string &device, ConnectionType connection,
   opts["bdsephemerisb"] = -1;
   opts["qzssephemerisb"] = -1;
   opts["rangecmpb"] = 1;
-  return BynavControl::Connect(device, connection, opts);
 }
 
 BynavNmea::ReadResult BynavNmea::ProcessData() {
@@ -54,17 +145,53 @@ BynavNmea::ReadResult BynavNmea::ProcessData() {
     return read_result;
   }
 
-  ros::Time stamp = ros::Time::now();
+  read_result = ParseData(data_buffer_.data(), data_buffer_.size(),
+                          read_stamps_);
+  ClearData();
+
+  return read_result;
+}
+
+BynavNmea::ReadResult
+BynavNmea::ParseData(const uint8_t *data, size_t size,
+                     const std::vector<ReadStamp> &stamps) {
+  // Parsed read by read, so every frame carries the stamp of the read that
+  // completed it.
+  BynavNmea::ReadResult read_result = READ_SUCCESS;
+  size_t begin = 0;
+  for (const auto &read : stamps) {
+    size_t end = std::min(read.end, size);
+    if (end <= begin) {
+      continue;
+    }
+    BynavNmea::ReadResult result =
+        ParseData(data + begin, end - begin, read.stamp);
+    if (result != READ_SUCCESS) {
+      read_result = result;
+    }
+    begin = end;
+  }
+  if (begin < size) {
+    BynavNmea::ReadResult result = ParseData(
+        data + begin, size - begin,
+        stamps.empty() ? ros::Time::now() : stamps.back().stamp);
+    if (result != READ_SUCCESS) {
+      read_result = result;
+    }
+  }
+  return read_result;
+}
+
+BynavNmea::ReadResult BynavNmea::ParseData(const uint8_t *data, size_t size,
+                                           const ros::Time &stamp) {
+  BynavNmea::ReadResult read_result = READ_SUCCESS;
   std::vector<NmeaSentence> nmea_sentences;
   std::vector<BynavSentence> bynav_sentences;
   std::vector<BinaryMessage> binary_messages;
   std::vector<BinaryMicroMessage> binary_mirco_messages;
 
-  if (!data_buffer_.empty()) {
-    nmea_buffer_.insert(nmea_buffer_.end(), data_buffer_.begin(),
-                        data_buffer_.end());
-
-    data_buffer_.clear();
+  if (size > 0) {
+    nmea_buffer_.insert(nmea_buffer_.end(), data, data + size);
 
     std::string remaining_buffer;
 
@@ -85,27 +212,52 @@ BynavNmea::ReadResult BynavNmea::ProcessData() {
     }
   }
 
-  double most_recent_utc_time = extractor_.GetMostRecentUtcTime(nmea_sentences);
+  // Split off the bulk lane and move latency-critical messages to the front,
+  // so a large RANGECMPB or a burst of ephemerides in the same read cannot
+  // delay IMU and INS output.
+  std::vector<BinaryMessage> bulk_binary;
+  std::vector<NmeaSentence> bulk_nmea;
+  auto bulk_begin = std::stable_partition(
+      binary_messages.begin(), binary_messages.end(),
+      [](const BinaryMessage &msg) {
+        return !IsBulkBinary(msg.header_.message_id_);
+      });
+  std::move(bulk_begin, binary_messages.end(), std::back_inserter(bulk_binary));
+  binary_messages.erase(bulk_begin, binary_messages.end());
+  std::stable_partition(binary_messages.begin(), binary_messages.end(),
+                        [](const BinaryMessage &msg) {
+                          return IsCriticalBinary(msg.header_.message_id_);
+                        });
+
+  auto bulk_nmea_begin = std::stable_partition(
+      nmea_sentences.begin(), nmea_sentences.end(),
+      [](const NmeaSentence &sentence) { return !IsBulkNmea(sentence.id); });
+  std::move(bulk_nmea_begin, nmea_sentences.end(),
+            std::back_inserter(bulk_nmea));
+  nmea_sentences.erase(bulk_nmea_begin, nmea_sentences.end());
+
+  std::stable_partition(
+      bynav_sentences.begin(), bynav_sentences.end(),
+      [](const BynavSentence &sentence) { return IsCriticalAscii(sentence.id); });
 
-  for (const auto &sentence : nmea_sentences) {
+  for (const auto &msg : binary_mirco_messages) {
     try {
       BynavNmea::ReadResult result =
-          ParseNmeaSentence(sentence, stamp, most_recent_utc_time);
+          ParseBinaryMicroMessage(msg, MessageStamp(msg, stamp, true));
       if (result != READ_SUCCESS) {
         read_result = result;
       }
     } catch (const ParseException &p) {
       error_msg_ = p.what();
       ROS_WARN("%s", p.what());
-      ROS_WARN("For sentence: [%s]",
-               boost::algorithm::join(sentence.body, ",").c_str());
       read_result = READ_PARSE_FAILED;
     }
   }
 
-  for (const auto &sentence : bynav_sentences) {
+  for (const auto &msg : binary_messages) {
     try {
-      BynavNmea::ReadResult result = ParseBynavSentence(sentence, stamp);
+      BynavNmea::ReadResult result =
+          ParseBinaryMessage(msg, MessageStamp(msg, stamp, true));
       if (result != READ_SUCCESS) {
         read_result = result;
       }
@@ -116,9 +268,10 @@ BynavNmea::ReadResult BynavNmea::ProcessData() {
     }
   }
 
-  for (const auto &msg : binary_mirco_messages) {
+  for (const auto &sentence : bynav_sentences) {
     try {
-      BynavNmea::ReadResult result = ParseBinaryMicroMessage(msg, stamp);
+      BynavNmea::ReadResult result =
+          ParseBynavSentence(sentence, MessageStamp(sentence, stamp, true));
       if (result != READ_SUCCESS) {
         read_result = result;
       }
@@ -129,19 +282,39 @@ BynavNmea::ReadResult BynavNmea::ProcessData() {
     }
   }
 
-  for (const auto &msg : binary_messages) {
+  double most_recent_utc_time = extractor_.GetMostRecentUtcTime(nmea_sentences);
+
+  for (const auto &sentence : nmea_sentences) {
     try {
-      BynavNmea::ReadResult result = ParseBinaryMessage(msg, stamp);
+      BynavNmea::ReadResult result =
+          ParseNmeaSentence(sentence, stamp, most_recent_utc_time);
       if (result != READ_SUCCESS) {
         read_result = result;
       }
     } catch (const ParseException &p) {
       error_msg_ = p.what();
       ROS_WARN("%s", p.what());
+      ROS_WARN("For sentence: [%s]",
+               boost::algorithm::join(sentence.body, ",").c_str());
       read_result = READ_PARSE_FAILED;
     }
   }
 
+  if (!bulk_binary.empty() || !bulk_nmea.empty()) {
+    if (bulk_service_) {
+      // Moved into the job so the worker never touches the caller's vectors.
+      auto binary = boost::make_shared<std::vector<BinaryMessage>>();
+      auto nmea = boost::make_shared<std::vector<NmeaSentence>>();
+      binary->swap(bulk_binary);
+      nmea->swap(bulk_nmea);
+      bulk_service_->post([this, binary, nmea, stamp]() {
+        ParseBulkMessages(*binary, *nmea, stamp);
+      });
+    } else {
+      ParseBulkMessages(bulk_binary, bulk_nmea, stamp);
+    }
+  }
+
   return read_result;
 }
 
@@ -180,38 +353,24 @@ void BynavNmea::GetBynavVelocities(
 void BynavNmea::GetFixMessages(
     std::vector<gps_msgs::msg::GPSFixPtr> &fix_messages) {
   fix_messages.clear();
+  fix_sync_.SetPolicy(GpsTimeSyncPolicy::APPROXIMATE, gpsfix_sync_tol_);
 
-  while (!bestpos_sync_buffer_.empty()) {
-    auto &bestpos = bestpos_sync_buffer_.front();
-
-    bool synced = false;
-
+  while (true) {
+    bynav_gps_msgs::BynavPositionPtr bestpos;
     auto gpsFix = boost::make_shared<gps_msgs::msg::GPSFix>();
 
-    while (!bestvel_sync_buffer_.empty()) {
-      auto &bestvel = bestvel_sync_buffer_.front();
-
-      double time_diff = std::fabs(bestvel->bynav_msg_header.gps_seconds -
-                                   bestpos->bynav_msg_header.gps_seconds);
-      if (time_diff < gpsfix_sync_tol_) {
-        gpsFix->track = bestvel->track_gnd;
-        gpsFix->speed = std::sqrt(std::pow(bestvel->horizontal_speed, 2) +
-                                  std::pow(bestvel->vertical_speed, 2));
-        synced = true;
-        break;
-      } else if (bestvel->bynav_msg_header.gps_seconds <
-                 bestpos->bynav_msg_header.gps_seconds) {
-        bestvel_sync_buffer_.pop_front();
-      } else {
-        break;
-      }
-    }
-
-    if (!synced && wait_for_sync_) {
+    FixSync::Set fix;
+    if (fix_sync_.Pop(fix)) {
+      bestpos = std::get<0>(fix);
+      const auto &bestvel = std::get<1>(fix);
+      gpsFix->track = bestvel->track_gnd;
+      gpsFix->speed = std::sqrt(std::pow(bestvel->horizontal_speed, 2) +
+                                std::pow(bestvel->vertical_speed, 2));
+    } else if (wait_for_sync_ || !fix_sync_.PopUnmatched<0>(bestpos)) {
       break;
     }
 
-    gpsFix->header.stamp = ros::Time::now();
+    gpsFix->header.stamp = bestpos->header.stamp;
     gpsFix->altitude = bestpos->height;
     gpsFix->latitude = bestpos->lat;
     gpsFix->longitude = bestpos->lon;
@@ -239,15 +398,26 @@ void BynavNmea::GetFixMessages(
     double sigma_z = bestpos->height_sigma;
     gpsFix->position_covariance[8] = sigma_z * sigma_z;
 
+    gpsFix->position_covariance_type =
+        gps_msgs::msg::GPSFix::COVARIANCE_TYPE_DIAGONAL_KNOWN;
+
+    // BESTPOS reports the INS solution once it is the better one; INSCOV
+    // then has the cross terms as well.
+    InsCovariance covariance = GetInsCovariance();
+    if (bestpos->position_type.compare(0, 4, "INS_") == 0 &&
+        covariance.GetSource() == InsCovariance::FULL) {
+      std::copy(covariance.Position(), covariance.Position() + 9,
+                gpsFix->position_covariance.begin());
+      gpsFix->position_covariance_type =
+          gps_msgs::msg::GPSFix::COVARIANCE_TYPE_KNOWN;
+    }
+
     gpsFix->err_horz = 2.0 * std::sqrt(sigma_x_squared + sigma_y_squared);
 
     gpsFix->err = 0.833 * (sigma_x + sigma_y + sigma_z);
 
     gpsFix->err_vert = 2.0 * sigma_z;
 
-    gpsFix->position_covariance_type =
-        gps_msgs::msg::GPSFix::COVARIANCE_TYPE_DIAGONAL_KNOWN;
-
     if (latest_gpdop_) {
       gpsFix->gdop = latest_gpdop_->gdop;
       gpsFix->pdop = latest_gpdop_->pdop;
@@ -256,7 +426,6 @@ void BynavNmea::GetFixMessages(
     }
 
     fix_messages.push_back(gpsFix);
-    bestpos_sync_buffer_.pop_front();
   }
 }
 
@@ -283,6 +452,23 @@ void BynavNmea::GetRawImuData(
   rawimu_msgs_.clear();
 }
 
+void BynavNmea::GetImuArrays(
+    std::vector<std::unique_ptr<bynav_gps_msgs::ImuArray>> &imu_arrays) {
+  imu_arrays.clear();
+  imu_arrays.insert(imu_arrays.end(),
+                    std::make_move_iterator(imu_arrays_.begin()),
+                    std::make_move_iterator(imu_arrays_.end()));
+  imu_arrays_.clear();
+}
+
+void BynavNmea::GetEventPoses(
+    std::vector<bynav_gps_msgs::EventPosePtr> &event_poses) {
+  event_poses.clear();
+  event_poses.insert(event_poses.end(), event_pose_msgs_.begin(),
+                     event_pose_msgs_.end());
+  event_pose_msgs_.clear();
+}
+
 void BynavNmea::GetGpdopMessages(
     std::vector<bynav_gps_msgs::GpdopPtr> &gpdop_messages) {
   gpdop_messages.clear();
@@ -301,6 +487,7 @@ void BynavNmea::GetGpggaMessages(
 
 void BynavNmea::GetGpgsvMessages(
     std::vector<bynav_gps_msgs::GpgsvPtr> &gpgsv_messages) {
+  boost::lock_guard<boost::mutex> lock(bulk_mutex_);
   gpgsv_messages.resize(gpgsv_msgs_.size());
   std::copy(gpgsv_msgs_.begin(), gpgsv_msgs_.end(), gpgsv_messages.begin());
   gpgsv_msgs_.clear();
@@ -345,8 +532,17 @@ void BynavNmea::GetInsstdevMessages(
   insstdev_msgs_.clear();
 }
 
+void BynavNmea::GetInscovMessages(
+    std::vector<bynav_gps_msgs::InsCovPtr> &inscov_messages) {
+  inscov_messages.clear();
+  inscov_messages.insert(inscov_messages.end(), inscov_msgs_.begin(),
+                         inscov_msgs_.end());
+  inscov_msgs_.clear();
+}
+
 void BynavNmea::GetBdsephemerisbMessages(
     std::vector<bynav_gps_msgs::GnssEphemMsgPtr> &messages) {
+  boost::lock_guard<boost::mutex> lock(bulk_mutex_);
   messages.resize(bdsephemerisb_msgs_.size());
   std::copy(bdsephemerisb_msgs_.begin(), bdsephemerisb_msgs_.end(),
             messages.begin());
@@ -355,6 +551,7 @@ void BynavNmea::GetBdsephemerisbMessages(
 
 void BynavNmea::GetGaleephemerisbMessages(
     std::vector<bynav_gps_msgs::GnssEphemMsgPtr> &messages) {
+  boost::lock_guard<boost::mutex> lock(bulk_mutex_);
   messages.resize(galephemerisb_msgs_.size());
   std::copy(galephemerisb_msgs_.begin(), galephemerisb_msgs_.end(),
             messages.begin());
@@ -363,6 +560,7 @@ void BynavNmea::GetGaleephemerisbMessages(
 
 void BynavNmea::GetGloephemerisbMessages(
     std::vector<bynav_gps_msgs::GnssGloEphemMsgPtr> &messages) {
+  boost::lock_guard<boost::mutex> lock(bulk_mutex_);
   messages.resize(gloephemerisb_msgs_.size());
   std::copy(gloephemerisb_msgs_.begin(), gloephemerisb_msgs_.end(),
             messages.begin());
@@ -371,6 +569,7 @@ void BynavNmea::GetGloephemerisbMessages(
 
 void BynavNmea::GetGpsephembMessages(
     std::vector<bynav_gps_msgs::GnssEphemMsgPtr> &messages) {
+  boost::lock_guard<boost::mutex> lock(bulk_mutex_);
   messages.resize(gpsephemb_msgs_.size());
   std::copy(gpsephemb_msgs_.begin(), gpsephemb_msgs_.end(), messages.begin());
   gpsephemb_msgs_.clear();
@@ -378,6 +577,7 @@ void BynavNmea::GetGpsephembMessages(
 
 void BynavNmea::GetQzssephemerisbMessages(
     std::vector<bynav_gps_msgs::GnssEphemMsgPtr> &messages) {
+  boost::lock_guard<boost::mutex> lock(bulk_mutex_);
   messages.resize(qzssephemerisb_msgs_.size());
   std::copy(qzssephemerisb_msgs_.begin(), qzssephemerisb_msgs_.end(),
             messages.begin());
@@ -386,17 +586,157 @@ void BynavNmea::GetQzssephemerisbMessages(
 
 void BynavNmea::GetRangecmpbMessages(
     std::vector<bynav_gps_msgs::GnssMeasMsgPtr> &messages) {
+  boost::lock_guard<boost::mutex> lock(bulk_mutex_);
   messages.resize(rangecmpb_msgs_.size());
   std::copy(rangecmpb_msgs_.begin(), rangecmpb_msgs_.end(), messages.begin());
   rangecmpb_msgs_.clear();
 }
 
-void BynavNmea::GetImuMessages(std::vector<sensor_msgs::msg::ImuPtr> &imu_messages) {
+void BynavNmea::GetImuMessages(
+    std::vector<std::unique_ptr<sensor_msgs::msg::Imu>> &imu_messages) {
   imu_messages.clear();
-  imu_messages.insert(imu_messages.end(), imu_msgs_.begin(), imu_msgs_.end());
+  imu_messages.insert(imu_messages.end(),
+                      std::make_move_iterator(imu_msgs_.begin()),
+                      std::make_move_iterator(imu_msgs_.end()));
   imu_msgs_.clear();
 }
 
+void BynavNmea::QueueImuSample(
+    const bynav_gps_msgs::BynavCorrectedImuDataPtr &imu) {
+  if (imu_interpolate_) {
+    if (imu_pending_.Full()) {
+      ROS_WARN_THROTTLE(1.0, "CORRIMUDATA queue overflow.");
+      imu_pending_.Pop();
+      imu_dropped_samples_++;
+    }
+    imu_pending_.Push(imu->gps_week_num * SECONDS_PER_WEEK + imu->gps_seconds,
+                      imu);
+  } else if (!imu_sync_.Push<0>(imu->gps_week_num, imu->gps_seconds, imu)) {
+    ROS_WARN_THROTTLE(1.0, "CORRIMUDATA queue overflow.");
+  }
+  GenerateImuMessages();
+}
+
+void BynavNmea::QueueAttitude(const bynav_gps_msgs::InspvaPtr &inspva) {
+  if (imu_interpolate_) {
+    AddAttitude(inspva->bynav_msg_header.gps_week_num,
+                inspva->bynav_msg_header.gps_seconds, inspva->roll,
+                inspva->pitch, inspva->azimuth);
+  } else if (!imu_sync_.Push<1>(inspva->bynav_msg_header.gps_week_num,
+                                inspva->bynav_msg_header.gps_seconds,
+                                inspva)) {
+    ROS_WARN_THROTTLE(1.0, "INSPVA queue overflow.");
+  }
+  GenerateImuMessages();
+}
+
+void BynavNmea::AddAttitude(uint32_t week, double seconds, double roll,
+                            double pitch, double azimuth) {
+  attitude_.Add(static_cast<double>(week) * SECONDS_PER_WEEK + seconds,
+                AttitudeInterpolator::FromRollPitchYaw(
+                    roll * DEGREES_TO_RADIANS, -pitch * DEGREES_TO_RADIANS,
+                    -azimuth * DEGREES_TO_RADIANS));
+}
+
+void BynavNmea::AddRawImuSample(const bynav_gps_msgs::RawIMUPtr &imu) {
+  if (!imu_batching_) {
+    return;
+  }
+  if (RawImuModel::INCREMENTS && imu_rate_ <= 0.0) {
+    ROS_WARN_ONCE("IMU rate has not been configured; cannot scale RAWIMU "
+                  "increments.");
+    return;
+  }
+
+  double gyro[3];
+  double accel[3];
+  RawImuToSi<RawImuModel>(*imu, imu_rate_, gyro, accel);
+  std::unique_ptr<bynav_gps_msgs::ImuArray> batch =
+      imu_batcher_.Add(imu->header.stamp, imu->gps_week_num, imu->gps_seconds,
+                       imu->imu_status, gyro, accel);
+  if (batch) {
+    imu_arrays_.push_back(std::move(batch));
+  }
+}
+
+void BynavNmea::AddEventPose(uint32_t week, double seconds, double latitude,
+                             double longitude, double height,
+                             double north_velocity, double east_velocity,
+                             double up_velocity, double roll, double pitch,
+                             double azimuth) {
+  if (!event_poses_) {
+    return;
+  }
+  PoseInterpolator::Pose pose = {latitude,       longitude,     height,
+                                 north_velocity, east_velocity, up_velocity,
+                                 roll,           pitch,         azimuth};
+  poses_.Add(static_cast<double>(week) * SECONDS_PER_WEEK + seconds, pose);
+  ResolveEvents();
+}
+
+void BynavNmea::QueueEvent(const bynav_gps_msgs::MarkTimePtr &mark,
+                           const ros::Time &arrival) {
+  bynav_gps_msgs::EventPosePtr event =
+      boost::make_shared<bynav_gps_msgs::EventPose>();
+  event->bynav_msg_header = mark->bynav_msg_header;
+  // The mark is in receiver time, which is ahead of GPS time by the offset.
+  event->week = mark->week;
+  event->seconds = mark->seconds - mark->offset;
+  if (event->seconds < 0.0 && event->week > 0) {
+    event->seconds += SECONDS_PER_WEEK;
+    event->week--;
+  }
+  event->offset_std = mark->offset_std;
+
+  double gps_time =
+      static_cast<double>(event->week) * SECONDS_PER_WEEK + event->seconds;
+  double host_time;
+  if (clock_model_.ToHost(gps_time, host_time)) {
+    event->header.stamp = ros::Time(host_time);
+  } else {
+    event->header.stamp = arrival;
+  }
+
+  if (pending_events_.Full()) {
+    ROS_WARN_THROTTLE(1.0, "Event queue overflow; is INSPVA or INSPVAX "
+                           "logged?");
+    event_pose_msgs_.push_back(pending_events_.Front());
+    pending_events_.Pop();
+    events_without_pose_++;
+  }
+  pending_events_.Push(gps_time, event);
+  ResolveEvents();
+}
+
+void BynavNmea::ResolveEvents() {
+  while (!pending_events_.Empty()) {
+    PoseInterpolator::Pose pose;
+    PoseInterpolator::Result result =
+        poses_.Lookup(pending_events_.FrontTime(), pose);
+    if (result == PoseInterpolator::PENDING) {
+      break;
+    }
+
+    bynav_gps_msgs::EventPosePtr event = pending_events_.Front();
+    pending_events_.Pop();
+    if (result == PoseInterpolator::INTERPOLATED) {
+      event->pose_valid = true;
+      event->latitude = pose.latitude;
+      event->longitude = pose.longitude;
+      event->height = pose.height;
+      event->north_velocity = pose.north_velocity;
+      event->east_velocity = pose.east_velocity;
+      event->up_velocity = pose.up_velocity;
+      event->roll = pose.roll;
+      event->pitch = pose.pitch;
+      event->azimuth = pose.azimuth;
+    } else {
+      events_without_pose_++;
+    }
+    event_pose_msgs_.push_back(event);
+  }
+}
+
 void BynavNmea::GenerateImuMessages() {
   if (imu_rate_ <= 0.0) {
     ROS_WARN_ONCE("IMU rate has not been configured; cannot produce "
@@ -405,69 +745,107 @@ void BynavNmea::GenerateImuMessages() {
   }
 
   size_t previous_size = imu_msgs_.size();
-  while (!corrimudata_queue_.empty() && !inspva_queue_.empty()) {
-    bynav_gps_msgs::BynavCorrectedImuDataPtr corrimudata =
-        corrimudata_queue_.front();
-    bynav_gps_msgs::InspvaPtr inspva = inspva_queue_.front();
-
-    double corrimudata_time =
-        corrimudata->gps_week_num * SECONDS_PER_WEEK + corrimudata->gps_seconds;
-    double inspva_time =
-        inspva->bynav_msg_header.gps_week_num * SECONDS_PER_WEEK +
-        inspva->bynav_msg_header.gps_seconds;
-
-    if (std::fabs(corrimudata_time - inspva_time) > IMU_TOLERANCE_S) {
-      ROS_DEBUG("INSPVA and CORRIMUDATA were unacceptably far apart.");
-      if (corrimudata_time < inspva_time) {
-        ROS_DEBUG("Discarding oldest CORRIMUDATA.");
-        corrimudata_queue_.pop();
-        continue;
-      } else {
-        ROS_DEBUG("Discarding oldest INSPVA.");
-        inspva_queue_.pop();
-        continue;
-      }
+  if (imu_interpolate_) {
+    InterpolateImuMessages();
+  } else {
+    ImuSync::Set pair;
+    while (imu_sync_.Pop(pair)) {
+      const auto &inspva = std::get<1>(pair);
+      AddImuMessage(std::get<0>(pair),
+                    AttitudeInterpolator::FromRollPitchYaw(
+                        inspva->roll * DEGREES_TO_RADIANS,
+                        -(inspva->pitch) * DEGREES_TO_RADIANS,
+                        -(inspva->azimuth) * DEGREES_TO_RADIANS));
     }
-    inspva_queue_.pop();
-    corrimudata_queue_.pop();
+  }
 
-    sensor_msgs::msg::ImuPtr imu = boost::make_shared<sensor_msgs::msg::Imu>();
+  size_t new_size = imu_msgs_.size() - previous_size;
+  ROS_DEBUG("Created %lu new sensor_msgs/msg/imu messages.", new_size);
+}
 
-    imu->header.stamp = corrimudata->header.stamp;
-    imu->orientation = tf::createQuaternionMsgFromRollPitchYaw(
-        inspva->roll * DEGREES_TO_RADIANS,
-        -(inspva->pitch) * DEGREES_TO_RADIANS,
-        -(inspva->azimuth) * DEGREES_TO_RADIANS);
+void BynavNmea::InterpolateImuMessages() {
+  while (!imu_pending_.Empty()) {
+    double time = imu_pending_.FrontTime();
+    AttitudeInterpolator::Quaternion orientation;
+    AttitudeInterpolator::Result result = attitude_.Lookup(time, orientation);
+    if (result == AttitudeInterpolator::PENDING) {
+      if (imu_pending_.BackTime() - time < imu_max_wait_s_) {
+        break;
+      }
+      if (attitude_.Hold(time, orientation)) {
+        imu_held_samples_++;
+        result = AttitudeInterpolator::INTERPOLATED;
+      } else {
+        result = AttitudeInterpolator::UNAVAILABLE;
+      }
+    }
 
-    if (latest_insstdev_) {
-      imu->orientation_covariance[0] = std::pow(2, latest_insstdev_->pitch_dev);
-      imu->orientation_covariance[4] = std::pow(2, latest_insstdev_->roll_dev);
-      imu->orientation_covariance[8] =
-          std::pow(2, latest_insstdev_->azimuth_dev);
+    if (result == AttitudeInterpolator::INTERPOLATED) {
+      AddImuMessage(imu_pending_.Front(), orientation);
     } else {
-      imu->orientation_covariance[0] = imu->orientation_covariance[4] =
-          imu->orientation_covariance[8] = 1e-3;
+      imu_dropped_samples_++;
     }
+    imu_pending_.Pop();
+  }
+}
 
-    imu->angular_velocity.x = corrimudata->pitch_rate * imu_rate_;
-    imu->angular_velocity.y = corrimudata->roll_rate * imu_rate_;
-    imu->angular_velocity.z = corrimudata->yaw_rate * imu_rate_;
-    imu->angular_velocity_covariance[0] = imu->angular_velocity_covariance[4] =
-        imu->angular_velocity_covariance[8] = 1e-3;
+void BynavNmea::AddImuMessage(
+    const bynav_gps_msgs::BynavCorrectedImuDataPtr &corrimudata,
+    const AttitudeInterpolator::Quaternion &orientation) {
+  std::unique_ptr<sensor_msgs::msg::Imu> imu =
+      std::make_unique<sensor_msgs::msg::Imu>();
+
+  imu->header.stamp = corrimudata->header.stamp;
+  imu->orientation.x = orientation.x;
+  imu->orientation.y = orientation.y;
+  imu->orientation.z = orientation.z;
+  imu->orientation.w = orientation.w;
+
+  InsCovariance covariance = GetInsCovariance();
+  if (covariance.GetSource() != InsCovariance::NONE) {
+    covariance.ImuAttitude(imu->orientation_covariance.data());
+  } else {
+    imu->orientation_covariance[0] = imu->orientation_covariance[4] =
+        imu->orientation_covariance[8] = 1e-3;
+  }
 
-    imu->linear_acceleration.x = corrimudata->lateral_acceleration * imu_rate_;
-    imu->linear_acceleration.y =
-        corrimudata->longitudinal_acceleration * imu_rate_;
-    imu->linear_acceleration.z = corrimudata->vertical_acceleration * imu_rate_;
-    imu->linear_acceleration_covariance[0] =
-        imu->linear_acceleration_covariance[4] =
-            imu->linear_acceleration_covariance[8] = 1e-3;
+  imu->angular_velocity.x = corrimudata->pitch_rate * imu_rate_;
+  imu->angular_velocity.y = corrimudata->roll_rate * imu_rate_;
+  imu->angular_velocity.z = corrimudata->yaw_rate * imu_rate_;
+  imu->angular_velocity_covariance[0] = imu->angular_velocity_covariance[4] =
+      imu->angular_velocity_covariance[8] = 1e-3;
+
+  imu->linear_acceleration.x = corrimudata->lateral_acceleration * imu_rate_;
+  imu->linear_acceleration.y =
+      corrimudata->longitudinal_acceleration * imu_rate_;
+  imu->linear_acceleration.z = corrimudata->vertical_acceleration * imu_rate_;
+  imu->linear_acceleration_covariance[0] =
+      imu->linear_acceleration_covariance[4] =
+          imu->linear_acceleration_covariance[8] = 1e-3;
+
+  imu_msgs_.push_back(std::move(imu));
+}
 
-    imu_msgs_.push_back(imu);
-  }
+void BynavNmea::SetImuInterpolation(bool enable, double max_wait_s) {
+  imu_interpolate_ = enable;
+  imu_max_wait_s_ = std::max(max_wait_s, 0.0);
+  attitude_.Clear();
+  imu_pending_.Clear();
+  imu_sync_.Clear();
+}
 
-  size_t new_size = imu_msgs_.size() - previous_size;
-  ROS_DEBUG("Created %lu new sensor_msgs/msg/imu messages.", new_size);
+void BynavNmea::SetImuBatching(size_t max_samples, double max_latency_s) {
+  imu_batching_ = max_samples > 0;
+  imu_batcher_.Configure(max_samples, max_latency_s);
+  imu_arrays_.clear();
+}
+
+void BynavNmea::SetEventPoses(bool enable, double max_gap_s) {
+  event_poses_ = enable;
+  poses_.SetMaxGap(max_gap_s);
+  poses_.Clear();
+  pending_events_.Clear();
+  event_pose_msgs_.clear();
 }
 
 void BynavNmea::SetImuRate(double imu_rate, bool imu_rate_forced) {
@@ -479,6 +857,114 @@ void BynavNmea::SetImuRate(double imu_rate, bool imu_rate_forced) {
   enable_imu_ = true;
 }
 
+bool BynavNmea::SetShmRefclock(int32_t unit, int32_t leap_seconds,
+                               double offset_s) {
+  leap_seconds_ = leap_seconds;
+  refclock_offset_s_ = offset_s;
+  refclock_second_ = -1;
+  if (unit < 0) {
+    shm_refclock_.Close();
+    return true;
+  }
+  return shm_refclock_.Open(unit);
+}
+
+ros::Time BynavNmea::MessageStamp(uint32_t week, double seconds,
+                                  TimeQuality quality, const ros::Time &arrival,
+                                  bool learn) {
+  bool refclock = shm_refclock_.IsOpen();
+  if ((!gps_time_stamps_ && !refclock && !event_poses_) ||
+      quality == TIME_UNKNOWN ||
+      week == 0) {
+    return arrival;
+  }
+
+  double gps_time = static_cast<double>(week) * SECONDS_PER_WEEK + seconds;
+  if (learn) {
+    clock_model_.Update(gps_time, arrival.toSec());
+  }
+  double host_time;
+  if (!clock_model_.ToHost(gps_time, host_time)) {
+    return arrival;
+  }
+
+  // Only the parse thread learns, so only it publishes.
+  int64_t second = static_cast<int64_t>(std::floor(gps_time));
+  if (learn && refclock && quality == TIME_FINE &&
+      second != refclock_second_) {
+    refclock_second_ = second;
+    shm_refclock_.Publish(gps_time + GPS_EPOCH_UNIX - leap_seconds_,
+                          host_time - refclock_offset_s_);
+  }
+  return gps_time_stamps_ ? ros::Time(host_time) : arrival;
+}
+
+ros::Time BynavNmea::MessageStamp(const BinaryMessage &msg,
+                                  const ros::Time &arrival, bool learn) {
+  TimeQuality quality = TIME_UNKNOWN;
+  if (msg.header_.time_status_ >= TIME_STATUS_FINE) {
+    quality = TIME_FINE;
+  } else if (msg.header_.time_status_ >= TIME_STATUS_COARSE) {
+    quality = TIME_COARSE;
+  }
+  return MessageStamp(msg.header_.week_, msg.header_.gps_ms_ / 1000.0, quality,
+                      arrival, learn);
+}
+
+ros::Time BynavNmea::MessageStamp(const BinaryMicroMessage &msg,
+                                  const ros::Time &arrival, bool learn) {
+  // The short header has no time status; a week number is the best hint,
+  // but not good enough to discipline a clock with.
+  return MessageStamp(msg.header_.week_, msg.header_.gps_ms_ / 1000.0,
+                      TIME_COARSE, arrival, learn);
+}
+
+ros::Time BynavNmea::MessageStamp(const BynavSentence &sentence,
+                                  const ros::Time &arrival, bool learn) {
+  static const std::set<std::string> COARSE_TIME = {
+      "COARSE", "COARSESTEERING", "FREEWHEELING", "FINEADJUSTING"};
+  static const std::set<std::string> FINE_TIME = {
+      "FINE", "FINEBACKUPSTEERING", "FINESTEERING", "SATTIME"};
+  uint32_t week = 0;
+  double seconds = 0.0;
+  if (sentence.header.size() != BYNAV_MESSAGE_HEADER_LENGTH ||
+      !ParseUInt32(sentence.header[5], week) ||
+      !ParseDouble(sentence.header[6], seconds)) {
+    return arrival;
+  }
+  TimeQuality quality = TIME_UNKNOWN;
+  if (FINE_TIME.count(sentence.header[4]) > 0) {
+    quality = TIME_FINE;
+  } else if (COARSE_TIME.count(sentence.header[4]) > 0) {
+    quality = TIME_COARSE;
+  }
+  return MessageStamp(week, seconds, quality, arrival, learn);
+}
+
+void BynavNmea::ParseBulkMessages(const std::vector<BinaryMessage> &binary,
+                                  const std::vector<NmeaSentence> &nmea,
+                                  const ros::Time &stamp) {
+  // Bulk parsers are stateless and their outputs are guarded by bulk_mutex_,
+  // so this may run on any worker.
+  for (const auto &msg : binary) {
+    try {
+      ParseBinaryMessage(msg, MessageStamp(msg, stamp, false));
+    } catch (const ParseException &p) {
+      bulk_parse_failures_++;
+      ROS_WARN("%s", p.what());
+    }
+  }
+
+  for (const auto &sentence : nmea) {
+    try {
+      ParseNmeaSentence(sentence, stamp, 0.0);
+    } catch (const ParseException &p) {
+      bulk_parse_failures_++;
+      ROS_WARN("%s", p.what());
+    }
+  }
+}
+
 BynavNmea::ReadResult
 BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
                               const ros::Time &stamp) noexcept(false) {
@@ -488,7 +974,8 @@ BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
         bestpos_parser_.ParseBinary(msg);
     position->header.stamp = stamp;
     bynav_positions_.push_back(position);
-    bestpos_sync_buffer_.push_back(position);
+    fix_sync_.Push<0>(position->bynav_msg_header.gps_week_num,
+                      position->bynav_msg_header.gps_seconds, position);
     break;
   }
   case BestGNSSposParser::MESSAGE_ID: {
@@ -503,7 +990,8 @@ BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
         bestvel_parser_.ParseBinary(msg);
     velocity->header.stamp = stamp;
     bynav_velocities_.push_back(velocity);
-    bestvel_sync_buffer_.push_back(velocity);
+    fix_sync_.Push<1>(velocity->bynav_msg_header.gps_week_num,
+                      velocity->bynav_msg_header.gps_seconds, velocity);
     break;
   }
   case HeadingParser::MESSAGE_ID: {
@@ -517,43 +1005,83 @@ BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
         corrimudata_parser_.ParseBinary(msg);
     imu->header.stamp = stamp;
     corrimudata_msgs_.push_back(imu);
-    corrimudata_queue_.push(imu);
-    if (corrimudata_queue_.size() > MAX_BUFFER_SIZE) {
-      ROS_WARN_THROTTLE(1.0, "CORRIMUDATA queue overflow.");
-      corrimudata_queue_.pop();
-    }
-    GenerateImuMessages();
+    QueueImuSample(imu);
     break;
   }
   case InspvaParser::MESSAGE_ID: {
     bynav_gps_msgs::InspvaPtr inspva = inspva_parser_.ParseBinary(msg);
     inspva->header.stamp = stamp;
     inspva_msgs_.push_back(inspva);
-    inspva_queue_.push(inspva);
-    if (inspva_queue_.size() > MAX_BUFFER_SIZE) {
-      ROS_WARN_THROTTLE(1.0, "INSPVA queue overflow.");
-      inspva_queue_.pop();
+    QueueAttitude(inspva);
+    AddEventPose(inspva->bynav_msg_header.gps_week_num,
+                 inspva->bynav_msg_header.gps_seconds, inspva->latitude,
+                 inspva->longitude, inspva->height, inspva->north_velocity,
+                 inspva->east_velocity, inspva->up_velocity, inspva->roll,
+                 inspva->pitch, inspva->azimuth);
+    break;
+  }
+  case InsattParser::MESSAGE_ID: {
+    bynav_gps_msgs::InsattPtr insatt = insatt_parser_.ParseBinary(msg);
+    if (imu_interpolate_) {
+      AddAttitude(insatt->week, insatt->seconds, insatt->roll, insatt->pitch,
+                  insatt->azimuth);
+      GenerateImuMessages();
     }
-    GenerateImuMessages();
     break;
   }
   case InspvaxParser::MESSAGE_ID: {
     bynav_gps_msgs::InspvaxPtr inspvax = inspvax_parser_.ParseBinary(msg);
     inspvax->header.stamp = stamp;
     inspvax_msgs_.push_back(inspvax);
+    {
+      boost::unique_lock<boost::mutex> lock(ins_covariance_mutex_);
+      ins_covariance_.Update(*inspvax);
+    }
+    AddEventPose(inspvax->bynav_msg_header.gps_week_num,
+                 inspvax->bynav_msg_header.gps_seconds, inspvax->latitude,
+                 inspvax->longitude, inspvax->altitude + inspvax->undulation,
+                 inspvax->north_velocity, inspvax->east_velocity,
+                 inspvax->up_velocity, inspvax->roll, inspvax->pitch,
+                 inspvax->azimuth);
+    break;
+  }
+  case MarkTimeParser::MESSAGE_ID: {
+    if (event_poses_) {
+      QueueEvent(marktime_parser_.ParseBinary(msg), stamp);
+    }
+    break;
+  }
+  case Mark2TimeParser::MESSAGE_ID: {
+    if (event_poses_) {
+      QueueEvent(mark2time_parser_.ParseBinary(msg), stamp);
+    }
     break;
   }
   case InsstdevParser::MESSAGE_ID: {
     bynav_gps_msgs::InsstdevPtr insstdev = insstdev_parser_.ParseBinary(msg);
     insstdev->header.stamp = stamp;
     insstdev_msgs_.push_back(insstdev);
-    latest_insstdev_ = insstdev;
+    {
+      boost::unique_lock<boost::mutex> lock(ins_covariance_mutex_);
+      ins_covariance_.Update(*insstdev);
+    }
+    break;
+  }
+  case InscovParser::MESSAGE_ID: {
+    bynav_gps_msgs::InsCovPtr inscov = inscov_parser_.ParseBinary(msg);
+    inscov->header.stamp = stamp;
+    inscov_msgs_.push_back(inscov);
+    {
+      boost::unique_lock<boost::mutex> lock(ins_covariance_mutex_);
+      ins_covariance_.Update(*inscov);
+    }
     break;
   }
   case BdsephemerisbParser::MESSAGE_ID: {
     bynav_gps_msgs::GnssEphemMsgPtr eph =
         bdsephemerisb_parser_.ParseBinary(msg);
     eph->header.stamp = stamp;
+    boost::lock_guard<boost::mutex> lock(bulk_mutex_);
     bdsephemerisb_msgs_.push_back(eph);
     break;
   }
@@ -561,6 +1089,7 @@ BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
     bynav_gps_msgs::GnssEphemMsgPtr eph =
         galephemerisb_parser_.ParseBinary(msg);
     eph->header.stamp = stamp;
+    boost::lock_guard<boost::mutex> lock(bulk_mutex_);
     galephemerisb_msgs_.push_back(eph);
     break;
   }
@@ -568,12 +1097,14 @@ BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
     bynav_gps_msgs::GnssGloEphemMsgPtr geph =
         gloephemerisb_parser_.ParseBinary(msg);
     geph->header.stamp = stamp;
+    boost::lock_guard<boost::mutex> lock(bulk_mutex_);
     gloephemerisb_msgs_.push_back(geph);
     break;
   }
   case GpsephembParser::MESSAGE_ID: {
     bynav_gps_msgs::GnssEphemMsgPtr eph = gpsephemb_parser_.ParseBinary(msg);
     eph->header.stamp = stamp;
+    boost::lock_guard<boost::mutex> lock(bulk_mutex_);
     gpsephemb_msgs_.push_back(eph);
     break;
   }
@@ -581,12 +1112,14 @@ BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
     bynav_gps_msgs::GnssEphemMsgPtr eph =
         qzssephemerisb_parser_.ParseBinary(msg);
     eph->header.stamp = stamp;
+    boost::lock_guard<boost::mutex> lock(bulk_mutex_);
     qzssephemerisb_msgs_.push_back(eph);
     break;
   }
   case RangrcmpbParser::MESSAGE_ID: {
     bynav_gps_msgs::GnssMeasMsgPtr meas = rangecmpb_parser_.ParseBinary(msg);
     meas->header.stamp = stamp;
+    boost::lock_guard<boost::mutex> lock(bulk_mutex_);
     rangecmpb_msgs_.push_back(meas);
     break;
   }
@@ -594,6 +1127,7 @@ BynavNmea::ParseBinaryMessage(const BinaryMessage &msg,
     bynav_gps_msgs::RawIMUPtr imu = rawimu_parser_.ParseBinary(msg);
     imu->header.stamp = stamp;
     rawimu_msgs_.push_back(imu);
+    AddRawImuSample(imu);
     break;
   }
   default:
@@ -613,18 +1147,14 @@ BynavNmea::ParseBinaryMicroMessage(const BinaryMicroMessage &msg,
         corrimudatas_parser_.ParseBinary(msg);
     imu->header.stamp = stamp;
     corrimudata_msgs_.push_back(imu);
-    corrimudata_queue_.push(imu);
-    if (corrimudata_queue_.size() > MAX_BUFFER_SIZE) {
-      ROS_WARN_THROTTLE(1.0, "CORRIMUDATA queue overflow.");
-      corrimudata_queue_.pop();
-    }
-    GenerateImuMessages();
+    QueueImuSample(imu);
     break;
   }
   case RawIMUSParser::MESSAGE_ID: {
     bynav_gps_msgs::RawIMUPtr imu = rawimus_parser_.ParseBinary(msg);
     imu->header.stamp = stamp;
     rawimu_msgs_.push_back(imu);
+    AddRawImuSample(imu);
     break;
   }
   default:
@@ -651,6 +1181,18 @@ BynavNmea::ParseNmeaSentence(const NmeaSentence &sentence,
     gpgga->header.stamp =
         stamp - ros::Duration(most_recent_utc_time - gpgga_time);
 
+    if (gpgga->gps_qual != bynav_gps_msgs::Gpgga::GPS_QUAL_INVALID) {
+      // Kept verbatim for upstream NTRIP casters that need our position.
+      std::string body = boost::algorithm::join(sentence.body, ",");
+      uint8_t checksum = 0;
+      for (char c : body) {
+        checksum ^= static_cast<uint8_t>(c);
+      }
+      char checksum_str[4];
+      snprintf(checksum_str, sizeof(checksum_str), "*%02X", checksum);
+      latest_gga_sentence_ = "$" + body + checksum_str;
+    }
+
     gpgga_msgs_.push_back(std::move(gpgga));
   } else if (sentence.id == GprmcParser::MESSAGE_NAME) {
     bynav_gps_msgs::GprmcPtr gprmc = gprmc_parser_.ParseAscii(sentence);
@@ -667,6 +1209,7 @@ BynavNmea::ParseNmeaSentence(const NmeaSentence &sentence,
     gprmc_msgs_.push_back(std::move(gprmc));
   } else if (sentence.id == GpgsvParser::MESSAGE_NAME) {
     bynav_gps_msgs::GpgsvPtr gpgsv = gpgsv_parser_.ParseAscii(sentence);
+    boost::lock_guard<boost::mutex> lock(bulk_mutex_);
     gpgsv_msgs_.push_back(gpgsv);
   } else if (sentence.id == GphdtParser::MESSAGE_NAME) {
     bynav_gps_msgs::GphdtPtr gphdt = gphdt_parser_.ParseAscii(sentence);
@@ -698,13 +1241,15 @@ BynavNmea::ParseBynavSentence(const BynavSentence &sentence,
         bestpos_parser_.ParseAscii(sentence);
     position->header.stamp = stamp;
     bynav_positions_.push_back(position);
-    bestpos_sync_buffer_.push_back(position);
+    fix_sync_.Push<0>(position->bynav_msg_header.gps_week_num,
+                      position->bynav_msg_header.gps_seconds, position);
   } else if (sentence.id == "BESTVELA") {
     bynav_gps_msgs::BynavVelocityPtr velocity =
         bestvel_parser_.ParseAscii(sentence);
     velocity->header.stamp = stamp;
     bynav_velocities_.push_back(velocity);
-    bestvel_sync_buffer_.push_back(velocity);
+    fix_sync_.Push<1>(velocity->bynav_msg_header.gps_week_num,
+                      velocity->bynav_msg_header.gps_seconds, velocity);
   } else if (sentence.id == "HEADINGA") {
     bynav_gps_msgs::HeadingPtr heading = heading_parser_.ParseAscii(sentence);
     heading->header.stamp = stamp;
@@ -714,32 +1259,70 @@ BynavNmea::ParseBynavSentence(const BynavSentence &sentence,
         corrimudata_parser_.ParseAscii(sentence);
     imu->header.stamp = stamp;
     corrimudata_msgs_.push_back(imu);
-    corrimudata_queue_.push(imu);
-    if (corrimudata_queue_.size() > MAX_BUFFER_SIZE) {
-      ROS_WARN_THROTTLE(1.0, "CORRIMUDATA queue overflow.");
-      corrimudata_queue_.pop();
-    }
-    GenerateImuMessages();
+    QueueImuSample(imu);
+  } else if (sentence.id == "RAWIMUA" || sentence.id == "RAWIMUSA") {
+    bynav_gps_msgs::RawIMUPtr imu = sentence.id == "RAWIMUA"
+                                        ? rawimu_parser_.ParseAscii(sentence)
+                                        : rawimus_parser_.ParseAscii(sentence);
+    imu->header.stamp = stamp;
+    rawimu_msgs_.push_back(imu);
+    AddRawImuSample(imu);
   } else if (sentence.id == "INSPVAA") {
     bynav_gps_msgs::InspvaPtr inspva = inspva_parser_.ParseAscii(sentence);
     inspva->header.stamp = stamp;
     inspva_msgs_.push_back(inspva);
-    inspva_queue_.push(inspva);
-    if (inspva_queue_.size() > MAX_BUFFER_SIZE) {
-      ROS_WARN_THROTTLE(1.0, "INSPVA queue overflow.");
-      inspva_queue_.pop();
+    QueueAttitude(inspva);
+    AddEventPose(inspva->bynav_msg_header.gps_week_num,
+                 inspva->bynav_msg_header.gps_seconds, inspva->latitude,
+                 inspva->longitude, inspva->height, inspva->north_velocity,
+                 inspva->east_velocity, inspva->up_velocity, inspva->roll,
+                 inspva->pitch, inspva->azimuth);
+  } else if (sentence.id == "INSATTA") {
+    bynav_gps_msgs::InsattPtr insatt = insatt_parser_.ParseAscii(sentence);
+    if (imu_interpolate_) {
+      AddAttitude(insatt->week, insatt->seconds, insatt->roll, insatt->pitch,
+                  insatt->azimuth);
+      GenerateImuMessages();
     }
-    GenerateImuMessages();
   } else if (sentence.id == "INSPVAXA") {
     bynav_gps_msgs::InspvaxPtr inspvax = inspvax_parser_.ParseAscii(sentence);
     inspvax->header.stamp = stamp;
     inspvax_msgs_.push_back(inspvax);
+    {
+      boost::unique_lock<boost::mutex> lock(ins_covariance_mutex_);
+      ins_covariance_.Update(*inspvax);
+    }
+    AddEventPose(inspvax->bynav_msg_header.gps_week_num,
+                 inspvax->bynav_msg_header.gps_seconds, inspvax->latitude,
+                 inspvax->longitude, inspvax->altitude + inspvax->undulation,
+                 inspvax->north_velocity, inspvax->east_velocity,
+                 inspvax->up_velocity, inspvax->roll, inspvax->pitch,
+                 inspvax->azimuth);
+  } else if (sentence.id == "MARKTIMEA") {
+    if (event_poses_) {
+      QueueEvent(marktime_parser_.ParseAscii(sentence), stamp);
+    }
+  } else if (sentence.id == "MARK2TIMEA") {
+    if (event_poses_) {
+      QueueEvent(mark2time_parser_.ParseAscii(sentence), stamp);
+    }
   } else if (sentence.id == "INSSTDEVA") {
     bynav_gps_msgs::InsstdevPtr insstdev =
         insstdev_parser_.ParseAscii(sentence);
     insstdev->header.stamp = stamp;
     insstdev_msgs_.push_back(insstdev);
-    latest_insstdev_ = insstdev;
+    {
+      boost::unique_lock<boost::mutex> lock(ins_covariance_mutex_);
+      ins_covariance_.Update(*insstdev);
+    }
+  } else if (sentence.id == "INSCOVA") {
+    bynav_gps_msgs::InsCovPtr inscov = inscov_parser_.ParseAscii(sentence);
+    inscov->header.stamp = stamp;
+    inscov_msgs_.push_back(inscov);
+    {
+      boost::unique_lock<boost::mutex> lock(ins_covariance_mutex_);
+      ins_covariance_.Update(*inscov);
+    }
   }
   return READ_SUCCESS;
 }
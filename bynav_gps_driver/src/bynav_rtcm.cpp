@@ -13,7 +13,12 @@
 
 namespace bynav_gps_driver {
 
-BynavRtcm::BynavRtcm() {}
+BynavRtcm::BynavRtcm() : rtcm_msgs_(MAX_BUFFER_SIZE) {
+  framer_.RegisterBufferCallback(
+      [this](uint8_t *buf, size_t size, uint16_t id, uint32_t crc) {
+        OnFrame(buf, size, id);
+      });
+}
 
 bool BynavRtcm::Connect(const std::string &device, ConnectionType connection) {
   BynavMessageOpts opts;
@@ -42,62 +47,36 @@ BynavRtcm::ReadResult BynavRtcm::ProcessData() {
     return read_result;
   }
 
-  ros::Time stamp = ros::Time::now();
-  std::vector<RtcmSentence> rtcm_messages;
-
-  if (!data_buffer_.empty()) {
-    rtcm_buffer_.insert(rtcm_buffer_.end(), data_buffer_.begin(),
-                        data_buffer_.end());
-    data_buffer_.clear();
-
-    std::string remaining_buffer;
-
-    if (!ExtractRtcmMessages(rtcm_buffer_, rtcm_messages, remaining_buffer)) {
-      read_result = READ_PARSE_FAILED;
-      error_msg_ = "Parse failure extracting sentences.";
-    }
-
-    rtcm_buffer_ = remaining_buffer;
-
-    if (!rtcm_buffer_.empty()) {
-      ROS_DEBUG("%lu unparsed bytes left over.", rtcm_buffer_.size());
+  // Frames are stamped with the read that completed them.
+  size_t begin = 0;
+  for (const auto &read : read_stamps_) {
+    frame_stamp_ = read.stamp;
+    for (size_t i = begin; i < read.end; i++) {
+      framer_.ReadCB(data_buffer_[i]);
     }
+    begin = read.end;
   }
-
-  for (auto &msg : rtcm_messages) {
-    bynav_gps_msgs::RtcmPtr ros_msg =
-        boost::make_shared<bynav_gps_msgs::Rtcm>();
-    ros_msg->header.stamp = stamp;
-    ros_msg->data.insert(ros_msg->data.end(), msg.data.begin(), msg.data.end());
-    rtcm_msgs_.push_back(std::move(ros_msg));
-  }
+  ClearData();
 
   return READ_SUCCESS;
 }
 
-bool BynavRtcm::ExtractRtcmMessages(const std::string &input,
-                                    std::vector<RtcmSentence> &rtcm_sentences,
-                                    std::string &remaining) {
-  Rtcm rtcm_;
-  size_t remaining_count = 0;
+void BynavRtcm::AllowMessageType(uint16_t type, double min_interval_s) {
+  filter_.AllowMessageType(type, min_interval_s);
+}
 
-  rtcm_.RegisterBufferCallback(
-      [this, &remaining_count, &rtcm_sentences](uint8_t *buf, size_t size,
-                                                uint16_t id, uint32_t crc) {
-        RtcmSentence sent;
-        sent.id = id;
-        sent.data = std::vector<uint8_t>(buf, buf + size);
-        sent.crc = crc;
-        rtcm_sentences.push_back(sent);
-        remaining_count += size;
-      });
-  for (int i = 0; i < input.size(); i++) {
-    rtcm_.ReadCB(uint8_t(input[i]));
-  }
-  if (rtcm_.ParsingMessage() && remaining_count < input.size()) {
-    remaining = input.substr(remaining_count);
+void BynavRtcm::ClearMessageFilter() { filter_.Clear(); }
+
+void BynavRtcm::OnFrame(uint8_t *buf, size_t size, uint16_t id) {
+  // Rejected frames never leave the framer's buffer.
+  if (!filter_.Pass(id, size, frame_stamp_.toSec())) {
+    return;
   }
-  return true;
+
+  bynav_gps_msgs::RtcmPtr ros_msg = boost::make_shared<bynav_gps_msgs::Rtcm>();
+  ros_msg->header.stamp = frame_stamp_;
+  ros_msg->data.assign(buf, buf + size);
+  rtcm_msgs_.push_back(std::move(ros_msg));
 }
 
 } // namespace bynav_gps_driver
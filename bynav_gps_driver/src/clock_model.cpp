@@ -0,0 +1,220 @@
+#include <bynav_gps_driver/clock_model.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace bynav_gps_driver {
+
+constexpr size_t ClockModel::WINDOW_SIZE;
+constexpr double ClockModel::SLOT_S;
+constexpr size_t ClockModel::SLOT_SEARCH;
+constexpr size_t ClockModel::MIN_SAMPLES;
+constexpr double ClockModel::MIN_OUTLIER_S;
+constexpr double ClockModel::STEP_S;
+constexpr int32_t ClockModel::STEP_SAMPLES;
+constexpr double ClockModel::MAX_DRIFT;
+
+ClockModel::ClockModel()
+    : samples_(WINDOW_SIZE), resets_(0), outliers_(0) {
+  inlier_.reserve(WINDOW_SIZE);
+  residuals_.reserve(WINDOW_SIZE);
+  sorted_.reserve(WINDOW_SIZE);
+  Reset();
+}
+
+void ClockModel::Reset() {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  samples_.clear();
+  have_reference_ = false;
+  reference_gps_ = 0.0;
+  reference_offset_ = 0.0;
+  latest_gps_ = 0.0;
+  valid_ = false;
+  intercept_ = 0.0;
+  slope_ = 0.0;
+  jitter_ = 0.0;
+  step_samples_ = 0;
+}
+
+bool ClockModel::Update(double gps_time, double host_time) {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  if (!have_reference_) {
+    have_reference_ = true;
+    reference_gps_ = gps_time;
+    reference_offset_ = host_time - gps_time;
+  }
+
+  Sample sample;
+  sample.gps = gps_time - reference_gps_;
+  sample.offset = host_time - gps_time - reference_offset_;
+
+  if (!samples_.empty()) {
+    double expected = valid_ ? Predict(sample.gps) : samples_.back().offset;
+    if (std::fabs(sample.offset - expected) > STEP_S) {
+      // A single late or garbled message shouldn't throw the fit away.
+      if (++step_samples_ < STEP_SAMPLES) {
+        outliers_++;
+        return false;
+      }
+      resets_++;
+      samples_.clear();
+      valid_ = false;
+      reference_gps_ = gps_time;
+      reference_offset_ = host_time - gps_time;
+      sample.gps = 0.0;
+      sample.offset = 0.0;
+    }
+  }
+  step_samples_ = 0;
+  latest_gps_ = std::max(latest_gps_, sample.gps);
+
+  double slot = std::floor(sample.gps / SLOT_S);
+  size_t same = samples_.size();
+  for (size_t i = samples_.size();
+       i > 0 && samples_.size() - i < SLOT_SEARCH; i--) {
+    if (std::floor(samples_[i - 1].gps / SLOT_S) == slot) {
+      same = i - 1;
+      break;
+    }
+  }
+  if (same < samples_.size()) {
+    if (sample.offset >= samples_[same].offset) {
+      return true;
+    }
+    samples_[same] = sample;
+  } else {
+    samples_.push_back(sample);
+  }
+
+  Fit();
+  return true;
+}
+
+bool ClockModel::ToHost(double gps_time, double &host_time) const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  if (!valid_) {
+    return false;
+  }
+  host_time = gps_time + reference_offset_ + Predict(gps_time - reference_gps_);
+  return true;
+}
+
+bool ClockModel::Valid() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return valid_;
+}
+
+double ClockModel::Offset() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return reference_offset_ + Predict(latest_gps_);
+}
+
+double ClockModel::DriftPpm() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return slope_ * 1e6;
+}
+
+double ClockModel::Jitter() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return jitter_;
+}
+
+size_t ClockModel::Samples() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return samples_.size();
+}
+
+uint32_t ClockModel::Resets() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return resets_;
+}
+
+uint64_t ClockModel::Outliers() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return outliers_;
+}
+
+void ClockModel::Fit() {
+  size_t count = samples_.size();
+  std::vector<bool> &inlier = inlier_;
+  inlier.assign(count, true);
+
+  auto fit_line = [&](double &intercept, double &slope) {
+    double n = 0.0;
+    double mean_x = 0.0;
+    double mean_y = 0.0;
+    for (size_t i = 0; i < count; i++) {
+      if (inlier[i]) {
+        n += 1.0;
+        mean_x += samples_[i].gps;
+        mean_y += samples_[i].offset;
+      }
+    }
+    mean_x /= n;
+    mean_y /= n;
+
+    double sxx = 0.0;
+    double sxy = 0.0;
+    for (size_t i = 0; i < count; i++) {
+      if (inlier[i]) {
+        double dx = samples_[i].gps - mean_x;
+        sxx += dx * dx;
+        sxy += dx * (samples_[i].offset - mean_y);
+      }
+    }
+    slope = sxx > 1e-9 ? sxy / sxx : 0.0;
+    slope = std::min(std::max(slope, -MAX_DRIFT), MAX_DRIFT);
+    intercept = mean_y - slope * mean_x;
+  };
+
+  double intercept;
+  double slope;
+  fit_line(intercept, slope);
+
+  // Reject samples further from the fit than the bulk of them, measured
+  // with the median absolute deviation so the outliers don't widen it.
+  std::vector<double> &residuals = residuals_;
+  residuals.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    residuals[i] = samples_[i].offset - (intercept + slope * samples_[i].gps);
+  }
+  std::vector<double> &sorted = sorted_;
+  sorted.assign(residuals.begin(), residuals.end());
+  std::nth_element(sorted.begin(), sorted.begin() + count / 2, sorted.end());
+  double median = sorted[count / 2];
+  for (auto &residual : sorted) {
+    residual = std::fabs(residual - median);
+  }
+  std::nth_element(sorted.begin(), sorted.begin() + count / 2, sorted.end());
+  double threshold = std::max(3.0 * 1.4826 * sorted[count / 2], MIN_OUTLIER_S);
+  for (size_t i = 0; i < count; i++) {
+    inlier[i] = std::fabs(residuals[i] - median) <= threshold;
+  }
+  fit_line(intercept, slope);
+
+  double lowest = 0.0;
+  double sum_squares = 0.0;
+  size_t inliers = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (inlier[i]) {
+      double residual =
+          samples_[i].offset - (intercept + slope * samples_[i].gps);
+      lowest = inliers == 0 ? residual : std::min(lowest, residual);
+      sum_squares += residual * residual;
+      inliers++;
+    }
+  }
+
+  // Latency only ever delays a sample, so the least delayed ones are the
+  // closest to the true offset.
+  intercept_ = intercept + lowest;
+  slope_ = slope;
+  jitter_ = std::sqrt(sum_squares / inliers);
+  valid_ = count >= MIN_SAMPLES;
+}
+
+double ClockModel::Predict(double gps) const {
+  return intercept_ + slope_ * gps;
+}
+
+} // namespace bynav_gps_driver
@@ -0,0 +1,203 @@
+#include <bynav_gps_driver/command_channel.h>
+
+#include <algorithm>
+
+#include <rclcpp/rclcpp.hpp>
+
+namespace bynav_gps_driver {
+
+CommandChannel::CommandChannel(const Sender &sender)
+    : sender_(sender), timeout_ms_(1000), retries_(2), in_response_(false),
+      last_byte_('\n'), errors_(0), timeouts_(0), unmatched_(0) {}
+
+void CommandChannel::SetTimeout(int32_t timeout_ms, int32_t retries) {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  timeout_ms_ = timeout_ms;
+  retries_ = std::max(retries, 0);
+}
+
+std::shared_future<CommandResult>
+CommandChannel::Submit(const std::string &command, int64_t now_ns,
+                       int32_t timeout_ms) {
+  Entry entry;
+  entry.command = command;
+  while (!entry.command.empty() &&
+         (entry.command.back() == '\r' || entry.command.back() == '\n')) {
+    entry.command.pop_back();
+  }
+  entry.submit_ns = now_ns;
+  entry.deadline_ns = now_ns;
+  entry.attempts = 0;
+  entry.promise = std::make_shared<std::promise<CommandResult>>();
+  std::shared_future<CommandResult> future = entry.promise->get_future();
+
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  entry.timeout_ms = timeout_ms < 0 ? timeout_ms_ : timeout_ms;
+  if (entry.timeout_ms <= 0) {
+    if (Transmit(entry, now_ns)) {
+      Resolve(entry, CommandResult::SENT, "", now_ns);
+    }
+    return future;
+  }
+
+  queued_.push_back(entry);
+  Dispatch(now_ns);
+  return future;
+}
+
+size_t CommandChannel::Feed(const uint8_t *data, size_t size,
+                            int64_t now_ns) {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  size_t matched = 0;
+  const uint8_t *end = data + size;
+  const uint8_t *iter = data;
+  while (iter != end) {
+    if (!in_response_) {
+      // Responses start a line or follow the "[COM1]" prompt.
+      const uint8_t *start = std::find(iter, end, '<');
+      if (start == end) {
+        break;
+      }
+      uint8_t previous = start == data ? last_byte_ : *(start - 1);
+      iter = start + 1;
+      if (previous == '\n' || previous == ']') {
+        in_response_ = true;
+        line_.clear();
+      }
+      continue;
+    }
+
+    uint8_t c = *iter++;
+    if (c == '\r' || c == '\n') {
+      in_response_ = false;
+      if (HandleResponse(line_, now_ns)) {
+        matched++;
+      }
+    } else if (c < 32 || c > 126 || line_.size() >= MAX_RESPONSE_LENGTH) {
+      // Not a response after all, probably binary data.
+      in_response_ = false;
+    } else {
+      line_.push_back(static_cast<char>(c));
+    }
+  }
+
+  if (size > 0) {
+    last_byte_ = data[size - 1];
+  }
+  if (matched > 0) {
+    Dispatch(now_ns);
+  }
+  return matched;
+}
+
+void CommandChannel::Poll(int64_t now_ns) {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  if (in_flight_.empty() || now_ns < in_flight_.front().deadline_ns) {
+    return;
+  }
+
+  Entry &head = in_flight_.front();
+  if (head.attempts > retries_) {
+    timeouts_++;
+    ROS_WARN("No response to \"%s\" after %d attempts.", head.command.c_str(),
+             head.attempts);
+    Resolve(head, CommandResult::TIMEOUT, "No response.", now_ns);
+    in_flight_.pop_front();
+
+    // Whatever follows was sent after the lost command and is still
+    // answered in order.
+    Dispatch(now_ns);
+    return;
+  }
+
+  ROS_DEBUG("No response to \"%s\", sending it again.", head.command.c_str());
+  std::deque<Entry> resend;
+  resend.swap(in_flight_);
+  for (auto &entry : resend) {
+    if (Transmit(entry, now_ns)) {
+      in_flight_.push_back(entry);
+    }
+  }
+}
+
+void CommandChannel::Cancel(const std::string &reason) {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  for (auto &entry : in_flight_) {
+    Resolve(entry, CommandResult::CANCELLED, reason, entry.deadline_ns);
+  }
+  for (auto &entry : queued_) {
+    Resolve(entry, CommandResult::CANCELLED, reason, entry.submit_ns);
+  }
+  in_flight_.clear();
+  queued_.clear();
+  in_response_ = false;
+  last_byte_ = '\n';
+}
+
+size_t CommandChannel::Pending() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return in_flight_.size() + queued_.size();
+}
+
+void CommandChannel::Dispatch(int64_t now_ns) {
+  while (!queued_.empty() && in_flight_.size() < MAX_IN_FLIGHT) {
+    Entry entry = queued_.front();
+    queued_.pop_front();
+    if (Transmit(entry, now_ns)) {
+      in_flight_.push_back(entry);
+    }
+  }
+}
+
+bool CommandChannel::Transmit(Entry &entry, int64_t now_ns) {
+  entry.attempts++;
+  entry.deadline_ns = now_ns + static_cast<int64_t>(entry.timeout_ms) * 1000000;
+  if (!sender_(entry.command + "\r\n")) {
+    errors_++;
+    Resolve(entry, CommandResult::ERROR, "Write failed.", now_ns);
+    return false;
+  }
+  return true;
+}
+
+void CommandChannel::Resolve(Entry &entry, CommandResult::Status status,
+                             const std::string &response, int64_t now_ns) {
+  CommandResult result;
+  result.status = status;
+  result.command = entry.command;
+  result.response = response;
+  result.attempts = entry.attempts;
+  result.latency_ns = now_ns - entry.submit_ns;
+  entry.promise->set_value(result);
+}
+
+bool CommandChannel::HandleResponse(const std::string &line, int64_t now_ns) {
+  // Abbreviated ASCII logs also start with '<'; only these two answer a
+  // command.
+  CommandResult::Status status;
+  if (line.compare(0, 2, "OK") == 0) {
+    status = CommandResult::OK;
+  } else if (line.compare(0, 5, "ERROR") == 0) {
+    status = CommandResult::ERROR;
+  } else {
+    return false;
+  }
+
+  if (in_flight_.empty()) {
+    unmatched_++;
+    ROS_DEBUG("Response without a command: <%s", line.c_str());
+    return false;
+  }
+
+  Entry &head = in_flight_.front();
+  if (status == CommandResult::ERROR) {
+    errors_++;
+    ROS_WARN("Receiver rejected \"%s\": %s", head.command.c_str(),
+             line.c_str());
+  }
+  Resolve(head, status, line, now_ns);
+  in_flight_.pop_front();
+  return true;
+}
+
+} // namespace bynav_gps_driver
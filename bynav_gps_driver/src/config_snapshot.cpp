@@ -0,0 +1,119 @@
+#include <bynav_gps_driver/config_snapshot.h>
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace bynav_gps_driver {
+
+namespace {
+
+bool MakeDirectories(const std::string &path) {
+  for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+    std::string parent = path.substr(0, pos);
+    if (::mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+    if (pos == std::string::npos) {
+      return true;
+    }
+  }
+}
+
+} // namespace
+
+bool ConfigSnapshot::Load(const std::string &device, Entry &entry) const {
+  if (!Enabled()) {
+    return false;
+  }
+
+  std::ifstream file(FileName(device).c_str());
+  std::string desired;
+  std::string receiver;
+  if (!(file >> desired >> receiver)) {
+    return false;
+  }
+
+  char *end = nullptr;
+  entry.desired = std::strtoull(desired.c_str(), &end, 16);
+  if (*end != '\0') {
+    return false;
+  }
+  entry.receiver = std::strtoull(receiver.c_str(), &end, 16);
+  return *end == '\0';
+}
+
+bool ConfigSnapshot::Store(const std::string &device,
+                           const Entry &entry) const {
+  if (!Enabled() || !MakeDirectories(directory_)) {
+    return false;
+  }
+
+  // Written next to the old one and renamed, so a crash never leaves a
+  // truncated snapshot behind.
+  std::string name = FileName(device);
+  std::string temp = name + ".tmp";
+  {
+    std::ofstream file(temp.c_str(), std::ios::trunc);
+    char line[64];
+    snprintf(line, sizeof(line), "%016llx %016llx\n",
+             static_cast<unsigned long long>(entry.desired),
+             static_cast<unsigned long long>(entry.receiver));
+    file << line;
+    if (!file.flush()) {
+      return false;
+    }
+  }
+  return std::rename(temp.c_str(), name.c_str()) == 0;
+}
+
+void ConfigSnapshot::Remove(const std::string &device) const {
+  if (Enabled()) {
+    std::remove(FileName(device).c_str());
+  }
+}
+
+std::string ConfigSnapshot::FileName(const std::string &device) const {
+  std::string name;
+  for (char c : device) {
+    bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                (c >= '0' && c <= '9') || c == '-' || c == '.';
+    name.push_back(safe ? c : '_');
+  }
+  return directory_ + "/" + name + ".snapshot";
+}
+
+uint64_t ConfigSnapshot::Hash(const std::string &text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : text) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t
+ConfigSnapshot::HashCommands(const std::vector<std::string> &commands) {
+  std::string text;
+  for (const auto &command : commands) {
+    text += command;
+    text += '\n';
+  }
+  return Hash(text);
+}
+
+std::string ConfigSnapshot::DefaultDirectory() {
+  const char *ros_home = std::getenv("ROS_HOME");
+  if (ros_home && *ros_home) {
+    return std::string(ros_home) + "/bynav_gps_driver";
+  }
+  const char *home = std::getenv("HOME");
+  if (home && *home) {
+    return std::string(home) + "/.ros/bynav_gps_driver";
+  }
+  return "";
+}
+
+} // namespace bynav_gps_driver
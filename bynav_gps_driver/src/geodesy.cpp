@@ -0,0 +1,389 @@
+#include <bynav_gps_driver/geodesy.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Core>
+
+namespace bynav_gps_driver {
+
+namespace {
+
+// Block size for the batch functions; the storage lives on the stack.
+constexpr int BLOCK = 256;
+
+typedef Eigen::Array<double, Eigen::Dynamic, 1, Eigen::ColMajor, BLOCK, 1>
+    Block;
+
+Block Load(const double *values, size_t count) {
+  return Eigen::Map<const Eigen::ArrayXd>(values, count);
+}
+
+void Store(const Block &block, double *values) {
+  Eigen::Map<Eigen::ArrayXd>(values, block.size()) = block;
+}
+
+// Calls f(offset, size) for each block of the range.
+template <typename F> void ForEachBlock(size_t count, F f) {
+  for (size_t offset = 0; offset < count; offset += BLOCK) {
+    f(offset, std::min<size_t>(BLOCK, count - offset));
+  }
+}
+
+// The formulas below are written once for double and for Block; these
+// fill the gaps in Eigen's element-wise functions.
+double Atan2(double y, double x) { return std::atan2(y, x); }
+
+Block Atan2(const Block &y, const Block &x) {
+  return y.binaryExpr(x, [](double a, double b) { return std::atan2(a, b); });
+}
+
+double Cbrt(double x) { return std::cbrt(x); }
+
+Block Cbrt(const Block &x) { return x.pow(1.0 / 3.0); }
+
+double Square(double x) { return x * x; }
+
+Block Square(const Block &x) { return x.square(); }
+
+template <typename T>
+void GeodeticToEcefImpl(const T &lat, const T &lon, const T &height, T &x,
+                        T &y, T &z, const Ellipsoid &ellipsoid) {
+  using std::cos;
+  using std::sin;
+  using std::sqrt;
+  T sin_lat = sin(lat);
+  T cos_lat = cos(lat);
+  // Prime vertical radius of curvature.
+  T n = ellipsoid.a / sqrt(1.0 - ellipsoid.e2 * Square(sin_lat));
+  T r = (n + height) * cos_lat;
+  x = r * cos(lon);
+  y = r * sin(lon);
+  z = (n * (1.0 - ellipsoid.e2) + height) * sin_lat;
+}
+
+template <typename T>
+void EcefToGeodeticImpl(const T &x, const T &y, const T &z, T &lat, T &lon,
+                        T &height, const Ellipsoid &ellipsoid) {
+  using std::sqrt;
+  const double e2 = ellipsoid.e2;
+  const double e4 = e2 * e2;
+  T rho2 = Square(x) + Square(y);
+  T p = rho2 / (ellipsoid.a * ellipsoid.a);
+  T q = (1.0 - e2) / (ellipsoid.a * ellipsoid.a) * Square(z);
+  T r = (p + q - e4) / 6.0;
+  T s = e4 * p * q / (4.0 * r * r * r);
+  T t = Cbrt(1.0 + s + sqrt(s * (2.0 + s)));
+  T u = r * (1.0 + t + 1.0 / t);
+  T v = sqrt(Square(u) + e4 * q);
+  T w = e2 * (u + v - q) / (2.0 * v);
+  T k = sqrt(u + v + Square(w)) - w;
+  T d = k * sqrt(rho2) / (k + e2);
+  T dz = sqrt(Square(d) + Square(z));
+  lat = 2.0 * Atan2(z, d + dz);
+  lon = Atan2(y, x);
+  height = (k + e2 - 1.0) / k * dz;
+}
+
+// Sums c[j-1] sin(2j xi) cosh(2j eta) and c[j-1] cos(2j xi) sinh(2j eta)
+// for j = 1..order. The multiple angles come from the addition formulas,
+// so there are only four transcendental calls however long the series.
+template <typename T>
+void KruegerSeries(const double *c, int order, const T &xi, const T &eta,
+                   T &xi_sum, T &eta_sum) {
+  using std::cos;
+  using std::cosh;
+  using std::sin;
+  using std::sinh;
+  T sin2 = sin(2.0 * xi);
+  T cos2 = cos(2.0 * xi);
+  T sinh2 = sinh(2.0 * eta);
+  T cosh2 = cosh(2.0 * eta);
+  T sin_j = sin2;
+  T cos_j = cos2;
+  T sinh_j = sinh2;
+  T cosh_j = cosh2;
+  xi_sum = c[0] * sin_j * cosh_j;
+  eta_sum = c[0] * cos_j * sinh_j;
+  for (int j = 1; j < order; j++) {
+    T sin_next = sin_j * cos2 + cos_j * sin2;
+    cos_j = cos_j * cos2 - sin_j * sin2;
+    sin_j = sin_next;
+    T sinh_next = sinh_j * cosh2 + cosh_j * sinh2;
+    cosh_j = cosh_j * cosh2 + sinh_j * sinh2;
+    sinh_j = sinh_next;
+    xi_sum += c[j] * sin_j * cosh_j;
+    eta_sum += c[j] * cos_j * sinh_j;
+  }
+}
+
+} // namespace
+
+void GeodeticToEcef(double lat, double lon, double height, double ecef[3],
+                    const Ellipsoid &ellipsoid) {
+  GeodeticToEcefImpl(lat, lon, height, ecef[0], ecef[1], ecef[2], ellipsoid);
+}
+
+void EcefToGeodetic(const double ecef[3], double &lat, double &lon,
+                    double &height, const Ellipsoid &ellipsoid) {
+  EcefToGeodeticImpl(ecef[0], ecef[1], ecef[2], lat, lon, height, ellipsoid);
+}
+
+void GeodeticToEcef(size_t count, const double *lat, const double *lon,
+                    const double *height, double *x, double *y, double *z,
+                    const Ellipsoid &ellipsoid) {
+  ForEachBlock(count, [&](size_t i, size_t n) {
+    Block bx, by, bz;
+    GeodeticToEcefImpl(Load(lat + i, n), Load(lon + i, n), Load(height + i, n),
+                       bx, by, bz, ellipsoid);
+    Store(bx, x + i);
+    Store(by, y + i);
+    Store(bz, z + i);
+  });
+}
+
+void EcefToGeodetic(size_t count, const double *x, const double *y,
+                    const double *z, double *lat, double *lon, double *height,
+                    const Ellipsoid &ellipsoid) {
+  ForEachBlock(count, [&](size_t i, size_t n) {
+    Block blat, blon, bheight;
+    EcefToGeodeticImpl(Load(x + i, n), Load(y + i, n), Load(z + i, n), blat,
+                       blon, bheight, ellipsoid);
+    Store(blat, lat + i);
+    Store(blon, lon + i);
+    Store(bheight, height + i);
+  });
+}
+
+EnuFrame::EnuFrame(const Ellipsoid &ellipsoid)
+    : ellipsoid_(ellipsoid), has_origin_(false), origin_(), origin_ecef_(),
+      rotation_() {}
+
+void EnuFrame::SetOrigin(double lat, double lon, double height) {
+  origin_[0] = lat;
+  origin_[1] = lon;
+  origin_[2] = height;
+  GeodeticToEcef(lat, lon, height, origin_ecef_, ellipsoid_);
+
+  double sin_lat = std::sin(lat);
+  double cos_lat = std::cos(lat);
+  double sin_lon = std::sin(lon);
+  double cos_lon = std::cos(lon);
+  rotation_[0][0] = -sin_lon;
+  rotation_[0][1] = cos_lon;
+  rotation_[0][2] = 0.0;
+  rotation_[1][0] = -sin_lat * cos_lon;
+  rotation_[1][1] = -sin_lat * sin_lon;
+  rotation_[1][2] = cos_lat;
+  rotation_[2][0] = cos_lat * cos_lon;
+  rotation_[2][1] = cos_lat * sin_lon;
+  rotation_[2][2] = sin_lat;
+  has_origin_ = true;
+}
+
+void EnuFrame::EcefToEnu(const double ecef[3], double enu[3]) const {
+  double d[3] = {ecef[0] - origin_ecef_[0], ecef[1] - origin_ecef_[1],
+                 ecef[2] - origin_ecef_[2]};
+  for (int i = 0; i < 3; i++) {
+    enu[i] = rotation_[i][0] * d[0] + rotation_[i][1] * d[1] +
+             rotation_[i][2] * d[2];
+  }
+}
+
+void EnuFrame::EnuToEcef(const double enu[3], double ecef[3]) const {
+  for (int i = 0; i < 3; i++) {
+    ecef[i] = origin_ecef_[i] + rotation_[0][i] * enu[0] +
+              rotation_[1][i] * enu[1] + rotation_[2][i] * enu[2];
+  }
+}
+
+void EnuFrame::GeodeticToEnu(double lat, double lon, double height,
+                             double enu[3]) const {
+  double ecef[3];
+  GeodeticToEcef(lat, lon, height, ecef, ellipsoid_);
+  EcefToEnu(ecef, enu);
+}
+
+void EnuFrame::EnuToGeodetic(const double enu[3], double &lat, double &lon,
+                             double &height) const {
+  double ecef[3];
+  EnuToEcef(enu, ecef);
+  EcefToGeodetic(ecef, lat, lon, height, ellipsoid_);
+}
+
+void EnuFrame::GeodeticToEnu(size_t count, const double *lat,
+                             const double *lon, const double *height,
+                             double *east, double *north, double *up) const {
+  ForEachBlock(count, [&](size_t i, size_t n) {
+    Block x, y, z;
+    GeodeticToEcefImpl(Load(lat + i, n), Load(lon + i, n), Load(height + i, n),
+                       x, y, z, ellipsoid_);
+    x -= origin_ecef_[0];
+    y -= origin_ecef_[1];
+    z -= origin_ecef_[2];
+    Store(rotation_[0][0] * x + rotation_[0][1] * y, east + i);
+    Store(rotation_[1][0] * x + rotation_[1][1] * y + rotation_[1][2] * z,
+          north + i);
+    Store(rotation_[2][0] * x + rotation_[2][1] * y + rotation_[2][2] * z,
+          up + i);
+  });
+}
+
+constexpr int TransverseMercator::ORDER;
+
+TransverseMercator::TransverseMercator(const Ellipsoid &ellipsoid,
+                                       double central_meridian,
+                                       double origin_latitude,
+                                       double false_northing,
+                                       double false_easting, double scale)
+    : e_(std::sqrt(ellipsoid.e2)), e2_(ellipsoid.e2),
+      central_meridian_(central_meridian), false_northing_(false_northing),
+      false_easting_(false_easting), xi0_(0.0) {
+  const double n = ellipsoid.n;
+  const double n2 = n * n;
+  const double n3 = n2 * n;
+  const double n4 = n3 * n;
+  const double n5 = n4 * n;
+  const double n6 = n5 * n;
+  k0_a_ = scale * ellipsoid.a / (1.0 + n) *
+          (1.0 + n2 / 4.0 + n4 / 64.0 + n6 / 256.0);
+
+  alpha_[0] = n / 2.0 - 2.0 / 3.0 * n2 + 5.0 / 16.0 * n3 +
+              41.0 / 180.0 * n4 - 127.0 / 288.0 * n5 +
+              7891.0 / 37800.0 * n6;
+  alpha_[1] = 13.0 / 48.0 * n2 - 3.0 / 5.0 * n3 + 557.0 / 1440.0 * n4 +
+              281.0 / 630.0 * n5 - 1983433.0 / 1935360.0 * n6;
+  alpha_[2] = 61.0 / 240.0 * n3 - 103.0 / 140.0 * n4 +
+              15061.0 / 26880.0 * n5 + 167603.0 / 181440.0 * n6;
+  alpha_[3] = 49561.0 / 161280.0 * n4 - 179.0 / 168.0 * n5 +
+              6601661.0 / 7257600.0 * n6;
+  alpha_[4] = 34729.0 / 80640.0 * n5 - 3418889.0 / 1995840.0 * n6;
+  alpha_[5] = 212378941.0 / 319334400.0 * n6;
+
+  beta_[0] = n / 2.0 - 2.0 / 3.0 * n2 + 37.0 / 96.0 * n3 - 1.0 / 360.0 * n4 -
+             81.0 / 512.0 * n5 + 96199.0 / 604800.0 * n6;
+  beta_[1] = 1.0 / 48.0 * n2 + 1.0 / 15.0 * n3 - 437.0 / 1440.0 * n4 +
+             46.0 / 105.0 * n5 - 1118711.0 / 3870720.0 * n6;
+  beta_[2] = 17.0 / 480.0 * n3 - 37.0 / 840.0 * n4 - 209.0 / 4480.0 * n5 +
+             5569.0 / 90720.0 * n6;
+  beta_[3] = 4397.0 / 161280.0 * n4 - 11.0 / 504.0 * n5 -
+             830251.0 / 7257600.0 * n6;
+  beta_[4] = 4583.0 / 161280.0 * n5 - 108847.0 / 3991680.0 * n6;
+  beta_[5] = 20648693.0 / 638668800.0 * n6;
+
+  double northing;
+  double easting;
+  ForwardImpl(origin_latitude, central_meridian, northing, easting);
+  xi0_ = (northing - false_northing_) / k0_a_;
+}
+
+TransverseMercator TransverseMercator::FromPjk(double a, double alpha,
+                                               double L0, double W0,
+                                               double FN, double FE,
+                                               double k0) {
+  return TransverseMercator(Ellipsoid(a, alpha), L0, W0, FN, FE, k0);
+}
+
+TransverseMercator TransverseMercator::Utm(int zone, bool north) {
+  return TransverseMercator(WGS84, (zone * 6.0 - 183.0) * DEGREES_TO_RADIANS,
+                            0.0, north ? 0.0 : 10000000.0, 500000.0, 0.9996);
+}
+
+int TransverseMercator::UtmZone(double lon) {
+  int zone = static_cast<int>(std::floor((lon / DEGREES_TO_RADIANS + 180.0) /
+                                         6.0)) % 60;
+  return (zone < 0 ? zone + 60 : zone) + 1;
+}
+
+void TransverseMercator::Forward(double lat, double lon, double &northing,
+                                 double &easting) const {
+  ForwardImpl(lat, lon, northing, easting);
+}
+
+void TransverseMercator::Inverse(double northing, double easting, double &lat,
+                                 double &lon) const {
+  InverseImpl(northing, easting, lat, lon);
+}
+
+void TransverseMercator::Forward(size_t count, const double *lat,
+                                 const double *lon, double *northing,
+                                 double *easting) const {
+  ForEachBlock(count, [&](size_t i, size_t n) {
+    Block bnorthing, beasting;
+    ForwardImpl<Block>(Load(lat + i, n), Load(lon + i, n), bnorthing,
+                       beasting);
+    Store(bnorthing, northing + i);
+    Store(beasting, easting + i);
+  });
+}
+
+void TransverseMercator::Inverse(size_t count, const double *northing,
+                                 const double *easting, double *lat,
+                                 double *lon) const {
+  ForEachBlock(count, [&](size_t i, size_t n) {
+    Block blat, blon;
+    InverseImpl<Block>(Load(northing + i, n), Load(easting + i, n), blat,
+                       blon);
+    Store(blat, lat + i);
+    Store(blon, lon + i);
+  });
+}
+
+template <typename T>
+void TransverseMercator::ForwardImpl(const T &lat, const T &lon, T &northing,
+                                     T &easting) const {
+  using std::atanh;
+  using std::cos;
+  using std::sin;
+  using std::sinh;
+  using std::sqrt;
+  // Conformal latitude, as its tangent.
+  T sin_lat = sin(lat);
+  T tau = sinh(atanh(sin_lat) - e_ * atanh(e_ * sin_lat));
+  T dlon = lon - central_meridian_;
+  T xi_p = Atan2(tau, cos(dlon));
+  T eta_p = atanh(sin(dlon) / sqrt(1.0 + Square(tau)));
+
+  T xi;
+  T eta;
+  KruegerSeries(alpha_, ORDER, xi_p, eta_p, xi, eta);
+  northing = false_northing_ + k0_a_ * (xi_p + xi - xi0_);
+  easting = false_easting_ + k0_a_ * (eta_p + eta);
+}
+
+template <typename T>
+void TransverseMercator::InverseImpl(const T &northing, const T &easting,
+                                     T &lat, T &lon) const {
+  using std::atan;
+  using std::atanh;
+  using std::cos;
+  using std::sin;
+  using std::sinh;
+  using std::sqrt;
+  T xi = (northing - false_northing_) / k0_a_ + xi0_;
+  T eta = (easting - false_easting_) / k0_a_;
+
+  T xi_p;
+  T eta_p;
+  KruegerSeries(beta_, ORDER, xi, eta, xi_p, eta_p);
+  xi_p = xi - xi_p;
+  eta_p = eta - eta_p;
+
+  // Tangent of the conformal latitude, then of the geodetic one by
+  // Newton's method; three steps reach full double precision.
+  T sinh_eta = sinh(eta_p);
+  T cos_xi = cos(xi_p);
+  T tau_p = sin(xi_p) / sqrt(Square(sinh_eta) + Square(cos_xi));
+  T tau = tau_p;
+  for (int i = 0; i < 3; i++) {
+    T tau1 = sqrt(1.0 + Square(tau));
+    T sigma = sinh(e_ * atanh(e_ * tau / tau1));
+    T tau_i = tau * sqrt(1.0 + Square(sigma)) - sigma * tau1;
+    tau += (tau_p - tau_i) / sqrt(1.0 + Square(tau_i)) *
+           (1.0 + (1.0 - e2_) * Square(tau)) / ((1.0 - e2_) * tau1);
+  }
+  lat = atan(tau);
+  lon = central_meridian_ + Atan2(sinh_eta, cos_xi);
+}
+
+} // namespace bynav_gps_driver
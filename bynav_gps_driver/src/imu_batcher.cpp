@@ -0,0 +1,58 @@
+#include <bynav_gps_driver/imu_batcher.h>
+
+#include <algorithm>
+
+namespace bynav_gps_driver {
+
+constexpr double ImuBatcher::SECONDS_PER_WEEK;
+
+ImuBatcher::ImuBatcher(size_t max_samples, double max_latency_s) {
+  Configure(max_samples, max_latency_s);
+}
+
+void ImuBatcher::Configure(size_t max_samples, double max_latency_s) {
+  max_samples_ = std::max<size_t>(max_samples, 1);
+  max_latency_s_ = std::max(max_latency_s, 0.0);
+  batch_.reset();
+}
+
+std::unique_ptr<bynav_gps_msgs::ImuArray>
+ImuBatcher::Add(const ros::Time &stamp, uint32_t week, double seconds,
+                uint32_t status, const double gyro[3], const double accel[3]) {
+  if (!batch_) {
+    batch_ = std::make_unique<bynav_gps_msgs::ImuArray>();
+    batch_->time_offsets.reserve(max_samples_);
+    batch_->imu_status.reserve(max_samples_);
+    batch_->angular_velocity.reserve(3 * max_samples_);
+    batch_->linear_acceleration.reserve(3 * max_samples_);
+    batch_->header.stamp = stamp;
+    batch_->gps_week_num = week;
+    batch_->gps_seconds = seconds;
+  }
+
+  // Relative to the first sample, so the week doesn't eat the precision.
+  double offset =
+      (static_cast<double>(week) - batch_->gps_week_num) * SECONDS_PER_WEEK +
+      (seconds - batch_->gps_seconds);
+  batch_->time_offsets.push_back(offset);
+  batch_->imu_status.push_back(status);
+  batch_->angular_velocity.insert(batch_->angular_velocity.end(), gyro,
+                                  gyro + 3);
+  batch_->linear_acceleration.insert(batch_->linear_acceleration.end(), accel,
+                                     accel + 3);
+
+  if (batch_->time_offsets.size() >= max_samples_ || offset >= max_latency_s_) {
+    return Flush();
+  }
+  return nullptr;
+}
+
+std::unique_ptr<bynav_gps_msgs::ImuArray> ImuBatcher::Flush() {
+  return std::move(batch_);
+}
+
+size_t ImuBatcher::Pending() const {
+  return batch_ ? batch_->time_offsets.size() : 0;
+}
+
+} // namespace bynav_gps_driver
@@ -0,0 +1,107 @@
+#include <bynav_gps_driver/ins_covariance.h>
+
+#include <algorithm>
+
+#include <bynav_gps_driver/geodesy.h>
+
+namespace bynav_gps_driver {
+
+namespace {
+
+void SetDiagonalMatrix(double x, double y, double z, double matrix[9]) {
+  std::fill(matrix, matrix + 9, 0.0);
+  matrix[0] = x * x;
+  matrix[4] = y * y;
+  matrix[8] = z * z;
+}
+
+// out = r * in * r^T
+void Rotate(const double r[9], const double in[9], double out[9]) {
+  double tmp[9];
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      tmp[i * 3 + j] = 0.0;
+      for (int k = 0; k < 3; k++) {
+        tmp[i * 3 + j] += r[i * 3 + k] * in[k * 3 + j];
+      }
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      out[i * 3 + j] = 0.0;
+      for (int k = 0; k < 3; k++) {
+        out[i * 3 + j] += tmp[i * 3 + k] * r[j * 3 + k];
+      }
+    }
+  }
+}
+
+// The IMU's y axis is the body's x, and its x is the body's -y.
+const double IMU_TO_BODY[9] = {0.0, 1.0, 0.0, -1.0, 0.0, 0.0, 0.0, 0.0, 1.0};
+const double BODY_TO_IMU[9] = {0.0, -1.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0};
+
+} // namespace
+
+constexpr double InsCovariance::SECONDS_PER_WEEK;
+
+InsCovariance::InsCovariance(double max_age_s)
+    : max_age_s_(max_age_s), source_(NONE), gps_time_(0.0) {}
+
+void InsCovariance::Update(const bynav_gps_msgs::InsCov &inscov) {
+  constexpr double DEG2_TO_RAD2 = DEGREES_TO_RADIANS * DEGREES_TO_RADIANS;
+  // INSCOV gives the attitude about the IMU axes.
+  double attitude[9];
+  for (size_t i = 0; i < 9; i++) {
+    position_[i] = inscov.position_covariance[i];
+    attitude[i] = inscov.attitude_covariance[i] * DEG2_TO_RAD2;
+    velocity_[i] = inscov.velocity_covariance[i];
+  }
+  Rotate(IMU_TO_BODY, attitude, attitude_);
+  source_ = FULL;
+  gps_time_ = static_cast<double>(inscov.week) * SECONDS_PER_WEEK +
+              inscov.seconds;
+}
+
+void InsCovariance::Update(const bynav_gps_msgs::Insstdev &insstdev) {
+  double sigma[9] = {insstdev.latitude_dev,      insstdev.longitude_dev,
+                     insstdev.height_dev,        insstdev.north_velocity_dev,
+                     insstdev.east_velocity_dev, insstdev.up_velocity_dev,
+                     insstdev.roll_dev,          insstdev.pitch_dev,
+                     insstdev.azimuth_dev};
+  SetDiagonal(insstdev.bynav_msg_header.gps_week_num,
+              insstdev.bynav_msg_header.gps_seconds, sigma);
+}
+
+void InsCovariance::Update(const bynav_gps_msgs::Inspvax &inspvax) {
+  if (inspvax.latitude_std <= 0.0f) {
+    return;
+  }
+  double sigma[9] = {inspvax.latitude_std,      inspvax.longitude_std,
+                     inspvax.altitude_std,      inspvax.north_velocity_std,
+                     inspvax.east_velocity_std, inspvax.up_velocity_std,
+                     inspvax.roll_std,          inspvax.pitch_std,
+                     inspvax.azimuth_std};
+  SetDiagonal(inspvax.bynav_msg_header.gps_week_num,
+              inspvax.bynav_msg_header.gps_seconds, sigma);
+}
+
+void InsCovariance::SetDiagonal(uint32_t week, double seconds,
+                                const double sigma[9]) {
+  double gps_time = static_cast<double>(week) * SECONDS_PER_WEEK + seconds;
+  if (source_ == FULL && gps_time - gps_time_ <= max_age_s_) {
+    return;
+  }
+  SetDiagonalMatrix(sigma[1], sigma[0], sigma[2], position_);
+  SetDiagonalMatrix(sigma[6] * DEGREES_TO_RADIANS,
+                    sigma[7] * DEGREES_TO_RADIANS,
+                    sigma[8] * DEGREES_TO_RADIANS, attitude_);
+  SetDiagonalMatrix(sigma[4], sigma[3], sigma[5], velocity_);
+  source_ = DIAGONAL;
+  gps_time_ = gps_time;
+}
+
+void InsCovariance::ImuAttitude(double attitude[9]) const {
+  Rotate(BODY_TO_IMU, attitude_, attitude);
+}
+
+} // namespace bynav_gps_driver
@@ -0,0 +1,87 @@
+#include <bynav_gps_driver/log_manager.h>
+
+#include <iomanip>
+#include <sstream>
+
+namespace bynav_gps_driver {
+
+LogManager::LogManager(double unlog_hold_s) : unlog_hold_s_(unlog_hold_s) {}
+
+void LogManager::AddLog(const std::string &name, double period,
+                        bool always_on) {
+  LogState &state = logs_[name];
+  state.period = period;
+  state.always_on = always_on;
+}
+
+void LogManager::Clear() { logs_.clear(); }
+
+void LogManager::SetWanted(const std::string &name, bool wanted) {
+  auto iter = logs_.find(name);
+  if (iter != logs_.end()) {
+    iter->second.wanted = wanted;
+  }
+}
+
+BynavMessageOpts LogManager::OnConnect(double now) {
+  BynavMessageOpts opts;
+  for (auto &log : logs_) {
+    LogState &state = log.second;
+    state.logged = state.always_on || state.wanted;
+    if (state.logged) {
+      state.last_wanted = now;
+      opts[log.first] = state.period;
+    }
+  }
+  return opts;
+}
+
+std::vector<std::string> LogManager::Update(double now) {
+  std::vector<std::string> commands;
+  for (auto &log : logs_) {
+    LogState &state = log.second;
+    if (state.always_on || state.wanted) {
+      state.last_wanted = now;
+      if (!state.logged) {
+        commands.push_back(LogCommand(log.first, state.period));
+        state.logged = true;
+      }
+    } else if (state.logged && now - state.last_wanted >= unlog_hold_s_) {
+      commands.push_back(UnlogCommand(log.first));
+      state.logged = false;
+    }
+  }
+  return commands;
+}
+
+bool LogManager::IsLogged(const std::string &name) const {
+  auto iter = logs_.find(name);
+  return iter != logs_.end() && iter->second.logged;
+}
+
+size_t LogManager::LoggedCount() const {
+  size_t count = 0;
+  for (const auto &log : logs_) {
+    if (log.second.logged) {
+      count++;
+    }
+  }
+  return count;
+}
+
+std::string LogManager::LogCommand(const std::string &name, double period) {
+  std::stringstream command;
+  command << std::setprecision(3);
+  if (period < 0.0) {
+    command << "log " << name << " onchanged\r\n";
+  } else {
+    command << "log " << name << " ontime " << period << "\r\n";
+  }
+  return command.str();
+}
+
+std::string LogManager::UnlogCommand(const std::string &name) {
+  return "unlog " + name + "\r\n";
+}
+
+} // namespace bynav_gps_driver
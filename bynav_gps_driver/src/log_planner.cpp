@@ -0,0 +1,333 @@
+#include <bynav_gps_driver/log_planner.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+#include <bynav_gps_driver/parsers/bdsephemerisb.h>
+#include <bynav_gps_driver/parsers/bestgnsspos.h>
+#include <bynav_gps_driver/parsers/bestpos.h>
+#include <bynav_gps_driver/parsers/bestvel.h>
+#include <bynav_gps_driver/parsers/corrimudata.h>
+#include <bynav_gps_driver/parsers/corrimudatas.h>
+#include <bynav_gps_driver/parsers/galephemerisb.h>
+#include <bynav_gps_driver/parsers/gloephemerisb.h>
+#include <bynav_gps_driver/parsers/gpsphemb.h>
+#include <bynav_gps_driver/parsers/header.h>
+#include <bynav_gps_driver/parsers/heading.h>
+#include <bynav_gps_driver/parsers/insatt.h>
+#include <bynav_gps_driver/parsers/inspos.h>
+#include <bynav_gps_driver/parsers/inspva.h>
+#include <bynav_gps_driver/parsers/inspvax.h>
+#include <bynav_gps_driver/parsers/insspd.h>
+#include <bynav_gps_driver/parsers/insstdev.h>
+#include <bynav_gps_driver/parsers/insvel.h>
+#include <bynav_gps_driver/parsers/mark2time.h>
+#include <bynav_gps_driver/parsers/marktime.h>
+#include <bynav_gps_driver/parsers/qzssephemerisb.h>
+#include <bynav_gps_driver/parsers/rawimu.h>
+#include <bynav_gps_driver/parsers/rawimus.h>
+
+namespace bynav_gps_driver {
+
+namespace {
+
+const size_t BINARY_CRC_LENGTH = 4;
+const size_t UNKNOWN_MESSAGE_SIZE = 200;
+// RANGECMP carries one 24 byte record per tracked signal.
+const size_t RANGECMP_RECORD_LENGTH = 24;
+const int32_t SIGNALS_PER_SATELLITE = 2;
+// INSCOV: week, seconds and three 3x3 matrices of doubles.
+const size_t INSCOV_BINARY_LENGTH = 12 + 3 * 9 * 8;
+
+// Lengths are copied out of the parsers so they aren't odr-used here.
+const std::map<std::string, size_t> &BinaryLengths() {
+  static const std::map<std::string, size_t> lengths = {
+      {"bestpos", static_cast<size_t>(BestposParser::BINARY_LENGTH)},
+      {"bestgnsspos", static_cast<size_t>(BestGNSSposParser::BINARY_LENGTH)},
+      {"bestvel", static_cast<size_t>(BynavVelocityParser::BINARY_LENGTH)},
+      {"heading2", static_cast<size_t>(HeadingParser::BINARY_LENGTH)},
+      {"corrimudata", static_cast<size_t>(CorrImuDataParser::BINARY_LENGTH)},
+      {"corrimudatas", static_cast<size_t>(CorrImuDataSParser::BINARY_LENGTH)},
+      {"inspva", static_cast<size_t>(InspvaParser::BINARY_LENGTH)},
+      {"inspvax", static_cast<size_t>(InspvaxParser::BINARY_LENGTH)},
+      {"insstdev", static_cast<size_t>(InsstdevParser::BINARY_LENGTH)},
+      {"insatt", static_cast<size_t>(InsattParser::BINARY_LENGTH)},
+      {"inspos", static_cast<size_t>(InsposParser::BINARY_LENGTH)},
+      {"insvel", static_cast<size_t>(InsvelParser::BINARY_LENGTH)},
+      {"insspd", static_cast<size_t>(InsspdParser::BINARY_LENGTH)},
+      {"inscov", INSCOV_BINARY_LENGTH},
+      {"rawimu", static_cast<size_t>(RawIMUParser::BINARY_LENGTH)},
+      {"rawimus", static_cast<size_t>(RawIMUSParser::BINARY_LENGTH)},
+      {"marktime", static_cast<size_t>(MarkTimeParser::BINARY_LENGTH)},
+      {"mark2time", static_cast<size_t>(Mark2TimeParser::BINARY_LENGTH)},
+      {"gpdop", 28},
+      {"gpsephem", static_cast<size_t>(GpsephembParser::BINARY_LENGTH)},
+      {"galephemeris",
+       static_cast<size_t>(GaleephemerisbParser::BINARY_LENGTH)},
+      {"gloephemeris", static_cast<size_t>(GloephemerisbParser::BINARY_LENGTH)},
+      {"bdsephemeris", static_cast<size_t>(BdsephemerisbParser::BINARY_LENGTH)},
+      {"qzssephemeris",
+       static_cast<size_t>(QzssephemerisbParser::BINARY_LENGTH)}};
+  return lengths;
+}
+
+// Typical sizes of ASCII logs, header and CRC included.
+const std::map<std::string, size_t> &AsciiLengths() {
+  static const std::map<std::string, size_t> lengths = {
+      {"bestpos", 230},     {"bestgnsspos", 230}, {"bestvel", 160},
+      {"heading2", 190},    {"corrimudata", 210}, {"corrimudatas", 200},
+      {"inspva", 240},      {"inspvax", 380},     {"insstdev", 260},
+      {"insatt", 170},      {"inspos", 170},      {"insvel", 170},
+      {"insspd", 160},      {"inscov", 600},      {"rawimu", 170},
+      {"rawimus", 170},     {"marktime", 150},    {"mark2time", 150},
+      {"gpdop", 130},       {"ptnlpjk", 110}};
+  return lengths;
+}
+
+const std::map<std::string, size_t> &NmeaLengths() {
+  static const std::map<std::string, size_t> lengths = {
+      {"gpgga", 85}, {"gprmc", 75}, {"gphdt", 30},
+      {"gpzda", 40}, {"gpgst", 75}, {"gpvtg", 50}};
+  return lengths;
+}
+
+bool IsNmea(const std::string &name) {
+  return name == "gpgsv" || NmeaLengths().count(name) > 0;
+}
+
+std::string BaseName(const std::string &name) {
+  if (IsNmea(name) || name.empty()) {
+    return name;
+  }
+  char format = name.back();
+  if (format == 'a' || format == 'b') {
+    return name.substr(0, name.size() - 1);
+  }
+  return name;
+}
+
+bool IsAscii(const std::string &name) {
+  return !IsNmea(name) && !name.empty() && name.back() == 'a';
+}
+
+double Rate(double period) {
+  if (period < 0.0) {
+    return LogPlanner::ONCHANGED_RATE;
+  }
+  return period > 0.0 ? 1.0 / period : 0.0;
+}
+
+void UpdateLoad(LogPlanner::PlannedLog &log, int32_t satellites) {
+  log.message_bytes = LogPlanner::MessageSize(log.name, satellites);
+  log.bytes_per_s = log.message_bytes * Rate(log.period);
+}
+
+double TotalLoad(const std::vector<LogPlanner::PlannedLog> &logs) {
+  double total = 0.0;
+  for (const auto &log : logs) {
+    total += log.bytes_per_s;
+  }
+  return total;
+}
+
+// Switching formats can produce two entries for the same log; keep the
+// faster one.
+void MergeDuplicates(std::vector<LogPlanner::PlannedLog> &logs) {
+  for (size_t i = 0; i < logs.size(); i++) {
+    for (size_t j = i + 1; j < logs.size();) {
+      if (logs[i].name != logs[j].name) {
+        j++;
+        continue;
+      }
+      if (logs[j].bytes_per_s > logs[i].bytes_per_s) {
+        std::swap(logs[i], logs[j]);
+      }
+      logs.erase(logs.begin() + j);
+    }
+  }
+}
+
+} // namespace
+
+constexpr double LogPlanner::ONCHANGED_RATE;
+constexpr double LogPlanner::NORMAL_MAX_PERIOD;
+constexpr double LogPlanner::LOW_MAX_PERIOD;
+
+LogPlanner::LogPlanner(const Config &config) : config_(config) {}
+
+size_t LogPlanner::MessageSize(const std::string &name, int32_t satellites) {
+  satellites = std::max(satellites, 0);
+
+  if (name == "gpgsv") {
+    return 70 * static_cast<size_t>((satellites + 3) / 4);
+  }
+  auto nmea = NmeaLengths().find(name);
+  if (nmea != NmeaLengths().end()) {
+    return nmea->second;
+  }
+
+  std::string base = BaseName(name);
+  if (IsAscii(name)) {
+    auto ascii = AsciiLengths().find(base);
+    return ascii != AsciiLengths().end() ? ascii->second
+                                         : UNKNOWN_MESSAGE_SIZE;
+  }
+
+  size_t body = UNKNOWN_MESSAGE_SIZE;
+  if (base == "rangecmp") {
+    body = 4 + RANGECMP_RECORD_LENGTH * satellites * SIGNALS_PER_SATELLITE;
+  } else {
+    auto binary = BinaryLengths().find(base);
+    if (binary != BinaryLengths().end()) {
+      body = binary->second;
+    }
+  }
+  return HeaderParser::BINARY_HEADER_LENGTH + body + BINARY_CRC_LENGTH;
+}
+
+LogPlanner::Priority LogPlanner::LogPriority(const std::string &name) {
+  std::string base = BaseName(name);
+  if (base.compare(0, 11, "corrimudata") == 0 ||
+      base.compare(0, 6, "rawimu") == 0 || base == "inspva" ||
+      base == "insatt" || base == "inspos" || base == "insvel" ||
+      base == "insspd" || base == "marktime" || base == "mark2time") {
+    return PRIORITY_CRITICAL;
+  }
+  if (base == "rangecmp" || base == "gpgsv" || base == "gpdop" ||
+      base == "gpzda" || base == "insstdev" || base == "inscov" ||
+      base.find("ephem") != std::string::npos) {
+    return PRIORITY_LOW;
+  }
+  return PRIORITY_NORMAL;
+}
+
+LogPlanner::Plan LogPlanner::Build(const BynavMessageOpts &opts) const {
+  Plan plan;
+  for (const auto &option : opts) {
+    PlannedLog log;
+    log.requested_name = option.first;
+    log.requested_period = option.second;
+    log.name = option.first;
+    log.period = option.second;
+    UpdateLoad(log, config_.satellites);
+    plan.logs.push_back(log);
+  }
+
+  if (config_.serial) {
+    plan.capacity_bytes_per_s = SerialCapacity(config_.baud);
+    double budget = plan.capacity_bytes_per_s * config_.max_utilization;
+
+    // Binary first: it is both smaller and cheaper to parse.
+    while (config_.allow_binary_switch && TotalLoad(plan.logs) > budget) {
+      PlannedLog *heaviest = nullptr;
+      for (auto &log : plan.logs) {
+        if (IsAscii(log.name) && BinaryLengths().count(BaseName(log.name)) &&
+            (!heaviest || log.bytes_per_s > heaviest->bytes_per_s)) {
+          heaviest = &log;
+        }
+      }
+      if (!heaviest) {
+        break;
+      }
+      heaviest->name = BaseName(heaviest->name) + "b";
+      UpdateLoad(*heaviest, config_.satellites);
+      MergeDuplicates(plan.logs);
+    }
+
+    // Then slow down the least important logs, heaviest first.
+    for (int32_t priority = PRIORITY_LOW;
+         config_.allow_decimation && priority > PRIORITY_CRITICAL &&
+         TotalLoad(plan.logs) > budget;) {
+      double max_period =
+          priority == PRIORITY_LOW ? LOW_MAX_PERIOD : NORMAL_MAX_PERIOD;
+      PlannedLog *heaviest = nullptr;
+      for (auto &log : plan.logs) {
+        if (LogPriority(log.name) == priority && log.period > 0.0 &&
+            log.period * 2.0 <= max_period &&
+            (!heaviest || log.bytes_per_s > heaviest->bytes_per_s)) {
+          heaviest = &log;
+        }
+      }
+      if (!heaviest) {
+        priority--;
+        continue;
+      }
+      heaviest->period *= 2.0;
+      UpdateLoad(*heaviest, config_.satellites);
+    }
+
+    // Last resort: leave out whole logs, least important and heaviest first.
+    for (int32_t priority = PRIORITY_LOW;
+         config_.allow_pruning && priority > PRIORITY_CRITICAL &&
+         TotalLoad(plan.logs) > budget;) {
+      auto heaviest = plan.logs.end();
+      for (auto log = plan.logs.begin(); log != plan.logs.end(); ++log) {
+        if (LogPriority(log->name) == priority &&
+            (heaviest == plan.logs.end() ||
+             log->bytes_per_s > heaviest->bytes_per_s)) {
+          heaviest = log;
+        }
+      }
+      if (heaviest == plan.logs.end()) {
+        priority--;
+        continue;
+      }
+      plan.dropped.push_back(*heaviest);
+      plan.logs.erase(heaviest);
+    }
+
+    plan.feasible = TotalLoad(plan.logs) <= budget;
+  }
+
+  plan.bytes_per_s = TotalLoad(plan.logs);
+  for (const auto &log : plan.logs) {
+    plan.opts[log.name] = log.period;
+  }
+  return plan;
+}
+
+std::string LogPlanner::Plan::Report() const {
+  std::string report;
+  for (const auto &log : logs) {
+    char line[192];
+    if (log.period < 0.0) {
+      snprintf(line, sizeof(line), "%s: onchanged, %zu B, ~%.1f B/s",
+               log.name.c_str(), log.message_bytes, log.bytes_per_s);
+    } else {
+      snprintf(line, sizeof(line), "%s: %.3f s, %zu B, %.1f B/s",
+               log.name.c_str(), log.period, log.message_bytes,
+               log.bytes_per_s);
+    }
+    report += line;
+    if (log.name != log.requested_name ||
+        log.period != log.requested_period) {
+      snprintf(line, sizeof(line), " (requested %s at %.3f s)",
+               log.requested_name.c_str(), log.requested_period);
+      report += line;
+    }
+    report += "\n";
+  }
+  for (const auto &log : dropped) {
+    char line[192];
+    snprintf(line, sizeof(line), "%s: dropped, %.1f B/s (requested at %.3f s)",
+             log.requested_name.c_str(), log.bytes_per_s,
+             log.requested_period);
+    report += line;
+    report += "\n";
+  }
+
+  char line[128];
+  if (capacity_bytes_per_s > 0.0) {
+    snprintf(line, sizeof(line), "Total: %.1f of %.1f B/s (%.0f%% of link)%s",
+             bytes_per_s, capacity_bytes_per_s, Utilization() * 100.0,
+             feasible ? "" : ", exceeds budget");
+  } else {
+    snprintf(line, sizeof(line), "Total: %.1f B/s (link not budgeted)",
+             bytes_per_s);
+  }
+  report += line;
+  return report;
+}
+
+} // namespace bynav_gps_driver
@@ -1,27 +1,40 @@
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
 #include <exception>
+#include <map>
+#include <memory>
 #include <string>
-
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics/max.hpp>
-#include <boost/accumulators/statistics/mean.hpp>
-#include <boost/accumulators/statistics/min.hpp>
-#include <boost/accumulators/statistics/rolling_mean.hpp>
-#include <boost/accumulators/statistics/stats.hpp>
-#include <boost/accumulators/statistics/variance.hpp>
-#include <boost/circular_buffer.hpp>
+#include <vector>
 
 #include <rclcpp/rclcpp.hpp>
 
+#include <bynav_gps_driver/attitude_interpolator.h>
 #include <bynav_gps_driver/bynav_nmea.h>
+#include <bynav_gps_driver/geodesy.h>
+#include <bynav_gps_driver/ins_covariance.h>
+#include <bynav_gps_driver/log_manager.h>
+#include <bynav_gps_driver/log_planner.h>
+#include <bynav_gps_driver/ntrip_client.h>
+#include <bynav_gps_driver/pipeline.h>
+#include <bynav_gps_driver/reconnect_backoff.h>
+#include <bynav_gps_driver/time_alignment.h>
 #include <bynav_gps_msgs/BynavConfig.h>
 #include <bynav_gps_msgs/BynavCorrectedImuData.h>
 #include <bynav_gps_msgs/BynavFRESET.h>
 #include <bynav_gps_msgs/BynavMessageHeader.h>
 #include <bynav_gps_msgs/BynavPosition.h>
+#include <bynav_gps_msgs/EventPose.h>
 #include <bynav_gps_msgs/Gpdop.h>
 #include <bynav_gps_msgs/Gpgga.h>
 #include <bynav_gps_msgs/Gprmc.h>
 #include <bynav_gps_msgs/Heading.h>
+#include <bynav_gps_msgs/ImuArray.h>
+#include <bynav_gps_msgs/InsCov.h>
 #include <bynav_gps_msgs/Inspva.h>
 #include <bynav_gps_msgs/Inspvax.h>
 #include <bynav_gps_msgs/Psrvel.h>
@@ -32,20 +45,77 @@
 #include <diagnostic_updater/msg/diagnostic_updater.h>
 #include <diagnostic_updater/msg/publisher.h>
 #include <gps_msgs/msg/gps_fix.hpp>
+#include <nav_msgs/msg/odometry.hpp>
 #include <sensor_msgs/msg/imu.hpp>
 #include <sensor_msgs/msg/nav_sat_fix.hpp>
 #include <swri_math_util/math_util.h>
+#include <tf2_msgs/msg/tf_message.hpp>
+
+#include <Eigen/Geometry>
 
-namespace stats = boost::accumulators;
 
 namespace bynav_gps_driver {
 
+// Bytes handed from the I/O stage to the parsing stage.
+struct RawChunk {
+  std::vector<uint8_t> data;
+  std::vector<BynavNmea::ReadStamp> stamps;
+  BynavNmea::ReadResult result;
+  std::string error_msg;
+  int64_t enqueue_ns;
+};
+
+// Everything one parsing pass produced, handed to the publishing stage.
+struct ParsedBatch {
+  ParsedBatch() : result(BynavNmea::READ_SUCCESS), read_ns(0), enqueue_ns(0) {}
+
+  BynavNmea::ReadResult result;
+  std::string error_msg;
+  std::string gga_sentence;
+
+  std::vector<gps_msgs::msg::GPSFixPtr> fix_msgs;
+  std::vector<bynav_gps_msgs::BynavPositionPtr> position_msgs;
+  std::vector<bynav_gps_msgs::BynavPositionPtr> gnss_position_msgs;
+  std::vector<bynav_gps_msgs::PtnlPJKPtr> pjk_position_msgs;
+  std::vector<bynav_gps_msgs::BynavVelocityPtr> velocity_msgs;
+  std::vector<bynav_gps_msgs::HeadingPtr> heading_msgs;
+  std::vector<bynav_gps_msgs::GpdopPtr> gpdop_msgs;
+  std::vector<bynav_gps_msgs::GpggaPtr> gpgga_msgs;
+  std::vector<bynav_gps_msgs::GprmcPtr> gprmc_msgs;
+  std::vector<bynav_gps_msgs::GpgsvPtr> gpgsv_msgs;
+  std::vector<bynav_gps_msgs::GphdtPtr> gphdt_msgs;
+  std::vector<bynav_gps_msgs::BynavCorrectedImuDataPtr> bynav_imu_msgs;
+  std::vector<std::unique_ptr<sensor_msgs::msg::Imu>> imu_msgs;
+  std::vector<std::unique_ptr<bynav_gps_msgs::ImuArray>> imu_arrays;
+  std::vector<bynav_gps_msgs::InspvaPtr> inspva_msgs;
+  std::vector<bynav_gps_msgs::InspvaxPtr> inspvax_msgs;
+  std::vector<bynav_gps_msgs::InsstdevPtr> insstdev_msgs;
+  std::vector<bynav_gps_msgs::InsCovPtr> inscov_msgs;
+  std::vector<bynav_gps_msgs::EventPosePtr> event_poses;
+
+  int64_t read_ns;
+  int64_t enqueue_ns;
+};
+
 class BynavGpsNode : public rclcpp::Node {
 public:
-  BynavGpsNode()
-      : device_(""), connection_type_("serial"), serial_baud_(115200),
+  explicit BynavGpsNode(const rclcpp::NodeOptions &options)
+      : BynavGpsNode("", options, false) {}
+
+  // A hosted node doesn't read the device from its own thread; whoever
+  // hosts it calls Prepare() once and then Step() whenever the device has
+  // data.
+  BynavGpsNode(const std::string &name_space,
+               const rclcpp::NodeOptions &options, bool hosted)
+      : rclcpp::Node("bynav_gps", name_space, options),
+        device_(""), connection_type_("serial"), serial_baud_(115200),
+        serial_auto_baud_(false), serial_receiver_port_("THISPORT"),
+        command_timeout_ms_(1000), command_retries_(2),
+        config_snapshot_enable_(true), config_snapshot_dir_(""),
         polling_period_(0.05), publish_gpgsv_(false), publish_gphdt_(false),
-        imu_rate_(100.0), imu_sample_rate_(-1), span_frame_to_ros_frame_(false),
+        imu_rate_(100.0), imu_sample_rate_(-1), imu_interpolate_(false),
+        imu_max_wait_s_(0.1), imu_batch_size_(0),
+        imu_batch_max_latency_s_(0.05), span_frame_to_ros_frame_(false),
         publish_clock_steering_(false), publish_imu_messages_(false),
         publish_obs_messages_(false), publish_nav_messages_(false),
         publish_bynav_positions_(false), publish_bynav_gnss_positions_(false),
@@ -53,96 +123,206 @@ public:
         publish_bynav_heading_(false), publish_bynav_gpdop_(false),
         publish_nmea_messages_(false), publish_diagnostics_(true),
         publish_sync_diagnostic_(true), publish_invalid_gpsfix_(false),
-        reconnect_delay_s_(0.5), use_binary_messages_(false),
-        connection_(BynavNmea::SERIAL), last_sync_(ros::TIME_MIN),
-        rolling_offset_(stats::tag::rolling_window::window_size = 10),
+        reconnect_delay_s_(0.5), reconnect_max_delay_s_(30.0),
+        reconnect_jitter_(0.25), link_state_(LINK_CONNECTING),
+        retry_at_ns_(0), retry_ns_(0), connected_ns_(0), poll_rate_(1000.0),
+        hosted_(hosted), use_binary_messages_(false),
+        event_driven_(true), gps_time_stamps_(true), shm_refclock_unit_(-1),
+        gps_leap_seconds_(18), shm_refclock_offset_s_(0.0),
+        connection_(BynavNmea::SERIAL), time_sync_window_(10),
         expected_rate_(20), device_timeouts_(0), device_interrupts_(0),
-        device_errors_(0), gps_parse_failures_(0),
+        device_errors_(0), idle_since_ns_(0), gps_parse_failures_(0),
         gps_insufficient_data_warnings_(0), publish_rate_warnings_(0),
-        measurement_count_(0), last_published_(ros::TIME_MIN),
-        imu_frame_id_(""), frame_id_("") {}
-
-  ~BynavGpsNode() override { gps_.Disconnect(); }
-
-  void onInit() override {
-    ros::NodeHandle &node = getNodeHandle();
-    ros::NodeHandle &priv = getPrivateNodeHandle();
-
-    swri::param(priv, "device", device_, device_);
-    swri::param(priv, "imu_rate", imu_rate_, imu_rate_);
-    swri::param(priv, "imu_sample_rate", imu_sample_rate_, imu_sample_rate_);
-    swri::param(priv, "publish_gpgsv", publish_gpgsv_, publish_gpgsv_);
-    swri::param(priv, "publish_gphdt", publish_gphdt_, publish_gphdt_);
-    swri::param(priv, "publish_imu_messages", publish_imu_messages_,
-                publish_imu_messages_);
-    swri::param(priv, "publish_obs_messages", publish_obs_messages_,
-                publish_obs_messages_);
-    swri::param(priv, "publish_nav_messages", publish_nav_messages_,
-                publish_nav_messages_);
-    swri::param(priv, "publish_bynav_positions", publish_bynav_positions_,
-                publish_bynav_positions_);
-    swri::param(priv, "publish_bynav_gnss_positions",
-                publish_bynav_gnss_positions_, publish_bynav_gnss_positions_);
-    swri::param(priv, "publish_bynav_pjk_positions",
-                publish_bynav_pjk_positions_, publish_bynav_pjk_positions_);
-    swri::param(priv, "publish_bynav_velocity", publish_bynav_velocity_,
-                publish_bynav_velocity_);
-    swri::param(priv, "publish_bynav_heading2", publish_bynav_heading_,
-                publish_bynav_heading_);
-    swri::param(priv, "publish_bynav_gpdop", publish_bynav_gpdop_,
-                publish_bynav_gpdop_);
-    swri::param(priv, "publish_nmea_messages", publish_nmea_messages_,
-                publish_nmea_messages_);
-    swri::param(priv, "publish_diagnostics", publish_diagnostics_,
-                publish_diagnostics_);
-    swri::param(priv, "publish_sync_diagnostic", publish_sync_diagnostic_,
-                publish_sync_diagnostic_);
-    swri::param(priv, "polling_period", polling_period_, polling_period_);
-    swri::param(priv, "reconnect_delay_s", reconnect_delay_s_,
-                reconnect_delay_s_);
-    swri::param(priv, "use_binary_messages", use_binary_messages_,
-                use_binary_messages_);
-    swri::param(priv, "span_frame_to_ros_frame", span_frame_to_ros_frame_,
-                span_frame_to_ros_frame_);
-
-    swri::param(priv, "connection_type", connection_type_, connection_type_);
-    connection_ = BynavNmea::ParseConnection(connection_type_);
-    swri::param(priv, "serial_baud", serial_baud_, serial_baud_);
-
-    swri::param(priv, "imu_frame_id", imu_frame_id_, std::string(""));
-    swri::param(priv, "frame_id", frame_id_, std::string(""));
-
-    swri::param(priv, "gpsfix_sync_tol", gps_.gpsfix_sync_tol_, 0.01);
-    swri::param(priv, "wait_for_sync", gps_.wait_for_sync_, true);
-
-    swri::param(priv, "publish_invalid_gpsfix", publish_invalid_gpsfix_,
-                publish_invalid_gpsfix_);
+        measurement_count_(0), last_published_(0.0),
+        imu_frame_id_(""), frame_id_(""), publish_odometry_(false),
+        publish_odometry_tf_(true), odometry_frame_id_("map"),
+        base_frame_id_("base_link"), publish_event_poses_(false),
+        event_use_mark2_(false), event_max_gap_s_(0.1), ntrip_enable_(false),
+        ntrip_inject_baud_(115200), pipeline_enable_(false), io_cpu_(-1),
+        parser_cpu_(-1), publisher_cpu_(-1), bulk_parse_threads_(1),
+        pipeline_running_(false),
+        raw_queue_(PIPELINE_QUEUE_SIZE), batch_queue_(PIPELINE_QUEUE_SIZE),
+        end_to_end_max_ns_(0), dynamic_logging_(false),
+        log_unlog_hold_s_(5.0), last_log_poll_ns_(0), active_logs_(0),
+        log_planner_enable_(true), log_planner_strict_(false),
+        max_link_utilization_(0.8), expected_satellites_(30),
+        planned_baud_(0), planned_utilization_(0.0),
+        running_(true), diagnostic_updater_(this) {
+    Initialize();
+  }
 
-    reset_service_ =
-        priv.advertiseService("freset", &BynavGpsNode::resetService, this);
+  ~BynavGpsNode() override {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    StopPipeline();
+    ntrip_client_.Stop();
+    correction_port_.Disconnect();
+    gps_.Disconnect();
+  }
 
-    sync_sub_ =
-        swri::Subscriber(node, "gps_sync", 100, &BynavGpsNode::SyncCallback, this);
+  void Initialize() {
+    Param("device", device_);
+    Param("imu_rate", imu_rate_);
+    Param("imu_sample_rate", imu_sample_rate_);
+    Param("imu_interpolate", imu_interpolate_);
+    Param("imu_max_wait_s", imu_max_wait_s_);
+    Param("imu_batch_size", imu_batch_size_);
+    Param("imu_batch_max_latency_s", imu_batch_max_latency_s_);
+    Param("publish_gpgsv", publish_gpgsv_);
+    Param("publish_gphdt", publish_gphdt_);
+    Param("publish_imu_messages", publish_imu_messages_);
+    Param("publish_obs_messages", publish_obs_messages_);
+    Param("publish_nav_messages", publish_nav_messages_);
+    Param("publish_bynav_positions", publish_bynav_positions_);
+    Param("publish_bynav_gnss_positions", publish_bynav_gnss_positions_);
+    Param("publish_bynav_pjk_positions", publish_bynav_pjk_positions_);
+    Param("publish_bynav_velocity", publish_bynav_velocity_);
+    Param("publish_bynav_heading2", publish_bynav_heading_);
+    Param("publish_bynav_gpdop", publish_bynav_gpdop_);
+    Param("publish_nmea_messages", publish_nmea_messages_);
+    Param("publish_diagnostics", publish_diagnostics_);
+    Param("publish_sync_diagnostic", publish_sync_diagnostic_);
+    Param("polling_period", polling_period_);
+    Param("reconnect_delay_s", reconnect_delay_s_);
+    Param("reconnect_max_delay_s", reconnect_max_delay_s_);
+    Param("reconnect_jitter", reconnect_jitter_);
+    Param("use_binary_messages", use_binary_messages_);
+    Param("span_frame_to_ros_frame", span_frame_to_ros_frame_);
+    Param("event_driven", event_driven_);
+    Param("gps_time_stamps", gps_time_stamps_);
+    Param("shm_refclock_unit", shm_refclock_unit_);
+    Param("gps_leap_seconds", gps_leap_seconds_);
+    Param("shm_refclock_offset_s", shm_refclock_offset_s_);
+    Param("time_sync_window", time_sync_window_);
+    time_sync_.SetWindow(std::max(time_sync_window_, 1));
+    Param("pipeline_enable", pipeline_enable_);
+    if (hosted_ && pipeline_enable_) {
+      RCLCPP_WARN(get_logger(), "pipeline_enable is ignored for hosted devices; "
+                  "the host's workers parse instead.");
+      pipeline_enable_ = false;
+    }
+    Param("io_cpu", io_cpu_);
+    Param("parser_cpu", parser_cpu_);
+    Param("publisher_cpu", publisher_cpu_);
+    Param("bulk_parse_threads", bulk_parse_threads_);
+    // Hosted devices share the host's bulk pool.
+    if (!hosted_) {
+      gps_.SetBulkWorkers(bulk_parse_threads_);
+    }
+    Param("dynamic_logging", dynamic_logging_);
+    Param("log_unlog_hold_s", log_unlog_hold_s_);
+    Param("log_planner_enable", log_planner_enable_);
+    Param("log_planner_strict", log_planner_strict_);
+    Param("max_link_utilization", max_link_utilization_);
+    Param("expected_satellites", expected_satellites_);
+
+    Param("connection_type", connection_type_);
+    connection_ = BynavNmea::ParseConnection(connection_type_);
+    Param("serial_baud", serial_baud_);
+    Param("serial_auto_baud", serial_auto_baud_);
+    Param("serial_receiver_port", serial_receiver_port_);
+    Param("command_timeout_ms", command_timeout_ms_);
+    Param("command_retries", command_retries_);
+    Param("config_snapshot_enable", config_snapshot_enable_);
+    Param("config_snapshot_dir", config_snapshot_dir_);
+
+    Param("imu_frame_id", imu_frame_id_, std::string(""));
+    Param("frame_id", frame_id_, std::string(""));
+
+    Param("gpsfix_sync_tol", gps_.gpsfix_sync_tol_, 0.01);
+    Param("wait_for_sync", gps_.wait_for_sync_, true);
+
+    Param("publish_invalid_gpsfix", publish_invalid_gpsfix_);
+
+    Param("publish_odometry", publish_odometry_);
+    Param("publish_odometry_tf", publish_odometry_tf_);
+    Param("odometry_frame_id", odometry_frame_id_);
+    Param("base_frame_id", base_frame_id_);
+    // [latitude, longitude, ellipsoidal height] in degrees and meters; the
+    // first INS fix is used when it is empty.
+    Param("odometry_origin", odometry_origin_, std::vector<double>());
+    if (odometry_origin_.size() == 3) {
+      enu_frame_.SetOrigin(odometry_origin_[0] * DEGREES_TO_RADIANS,
+                           odometry_origin_[1] * DEGREES_TO_RADIANS,
+                           odometry_origin_[2]);
+    } else if (!odometry_origin_.empty()) {
+      RCLCPP_WARN(get_logger(), "odometry_origin needs latitude, longitude and "
+                  "height; using the first fix instead.");
+    }
 
-    std::string gps_topic = node.resolveName("gps");
-    gps_pub_ = swri::advertise<gps_msgs::msg::GPSFix>(node, gps_topic, 100);
-    fix_pub_ = swri::advertise<sensor_msgs::msg::NavSatFix>(node, "fix", 100);
+    Param("publish_event_poses", publish_event_poses_);
+    Param("event_use_mark2", event_use_mark2_);
+    Param("event_max_gap_s", event_max_gap_s_);
+    gps_.SetEventPoses(publish_event_poses_, event_max_gap_s_);
+
+    Param("ntrip_enable", ntrip_enable_);
+    Param("ntrip_host", ntrip_config_.host);
+    int32_t ntrip_port = ntrip_config_.port;
+    Param("ntrip_port", ntrip_port);
+    ntrip_config_.port = static_cast<uint16_t>(ntrip_port);
+    Param("ntrip_mountpoint", ntrip_config_.mountpoint);
+    Param("ntrip_username", ntrip_config_.username);
+    Param("ntrip_password", ntrip_config_.password);
+    Param("ntrip_version", ntrip_config_.version);
+    Param("ntrip_gga_interval", ntrip_config_.gga_interval_s);
+    Param("ntrip_inject_device", ntrip_inject_device_);
+    Param("ntrip_inject_baud", ntrip_inject_baud_);
+    // Message types forwarded to the receiver, each limited to one frame per
+    // the matching interval if one is given. Empty forwards everything.
+    Param("ntrip_message_types", ntrip_message_types_,
+          std::vector<int64_t>());
+    Param("ntrip_message_intervals", ntrip_message_intervals_,
+          std::vector<double>());
+
+    reset_service_ = create_service<bynav_gps_msgs::BynavFRESET>(
+        "freset",
+        [this](const std::shared_ptr<bynav_gps_msgs::BynavFRESET::Request> req,
+               std::shared_ptr<bynav_gps_msgs::BynavFRESET::Response> res) {
+          resetService(*req, *res);
+        });
+
+    sync_sub_ = create_subscription<builtin_interfaces::msg::Time>(
+        "gps_sync", 100,
+        std::bind(&BynavGpsNode::SyncCallback, this, std::placeholders::_1));
+
+    gps_pub_ = create_publisher<gps_msgs::msg::GPSFix>("gps", 100);
+    fix_pub_ = create_publisher<sensor_msgs::msg::NavSatFix>("fix", 100);
 
     if (publish_nmea_messages_) {
-      gpgga_pub_ = swri::advertise<bynav_gps_msgs::Gpgga>(node, "gpgga", 100);
-      gprmc_pub_ = swri::advertise<bynav_gps_msgs::Gprmc>(node, "gprmc", 100);
+      gpgga_pub_ = create_publisher<bynav_gps_msgs::Gpgga>("gpgga", 100);
+      gprmc_pub_ = create_publisher<bynav_gps_msgs::Gprmc>("gprmc", 100);
     }
 
     if (publish_imu_messages_) {
-      imu_pub_ = swri::advertise<sensor_msgs::msg::Imu>(node, "imu", 100);
-      bynav_imu_pub_ = swri::advertise<bynav_gps_msgs::BynavCorrectedImuData>(
-          node, "corrimudata", 100);
+      imu_pub_ = create_publisher<sensor_msgs::msg::Imu>("imu", 100);
+      bynav_imu_pub_ = create_publisher<bynav_gps_msgs::BynavCorrectedImuData>(
+          "corrimudata", 100);
       insstdev_pub_ =
-          swri::advertise<bynav_gps_msgs::Insstdev>(node, "insstdev", 100);
+          create_publisher<bynav_gps_msgs::Insstdev>("insstdev", 100);
+      inscov_pub_ = create_publisher<bynav_gps_msgs::InsCov>("inscov", 100);
       inspva_pub_ =
-          swri::advertise<bynav_gps_msgs::Inspva>(node, "inspva", 100);
+          create_publisher<bynav_gps_msgs::Inspva>("inspva", 100);
       inspvax_pub_ =
-          swri::advertise<bynav_gps_msgs::Inspvax>(node, "inspvax", 100);
+          create_publisher<bynav_gps_msgs::Inspvax>("inspvax", 100);
+    }
+
+    if (publish_odometry_) {
+      odom_pub_ = create_publisher<nav_msgs::msg::Odometry>("odom", 100);
+      if (publish_odometry_tf_) {
+        tf_pub_ = create_publisher<tf2_msgs::msg::TFMessage>("/tf", 100);
+      }
+    }
+
+    if (publish_event_poses_) {
+      event_pose_pub_ =
+          create_publisher<bynav_gps_msgs::EventPose>("event_pose", 100);
+    }
+
+    if (imu_batch_size_ > 0) {
+      imu_array_pub_ =
+          create_publisher<bynav_gps_msgs::ImuArray>("imu_array", 100);
     }
 
     if (publish_obs_messages_) {
@@ -152,43 +332,47 @@ public:
     }
 
     if (publish_gpgsv_) {
-      gpgsv_pub_ = swri::advertise<bynav_gps_msgs::Gpgsv>(node, "gpgsv", 100);
+      gpgsv_pub_ = create_publisher<bynav_gps_msgs::Gpgsv>("gpgsv", 100);
     }
 
     if (publish_gphdt_) {
-      gphdt_pub_ = swri::advertise<bynav_gps_msgs::Gphdt>(node, "gphdt", 100);
+      gphdt_pub_ = create_publisher<bynav_gps_msgs::Gphdt>("gphdt", 100);
     }
 
     if (publish_bynav_positions_) {
       bynav_position_pub_ =
-          swri::advertise<bynav_gps_msgs::BynavPosition>(node, "bestpos", 100);
+          create_publisher<bynav_gps_msgs::BynavPosition>("bestpos", 100);
     }
 
     if (publish_bynav_gnss_positions_) {
-      bynav_gnss_position_pub_ = swri::advertise<bynav_gps_msgs::BynavPosition>(
-          node, "bestgnsspos", 100);
+      bynav_gnss_position_pub_ =
+          create_publisher<bynav_gps_msgs::BynavPosition>("bestgnsspos", 100);
     }
 
     if (publish_bynav_pjk_positions_) {
       bynav_pjk_position_pub_ =
-          swri::advertise<bynav_gps_msgs::PtnlPJK>(node, "ptnlpjk", 100);
+          create_publisher<bynav_gps_msgs::PtnlPJK>("ptnlpjk", 100);
     }
 
     if (publish_bynav_velocity_) {
       bynav_velocity_pub_ =
-          swri::advertise<bynav_gps_msgs::Psrvel>(node, "bestvel", 100);
+          create_publisher<bynav_gps_msgs::Psrvel>("bestvel", 100);
     } else {
       gps_.wait_for_sync_ = false;
     }
 
     if (publish_bynav_heading_) {
       bynav_heading_pub_ =
-          swri::advertise<bynav_gps_msgs::Heading>(node, "heading2", 100);
+          create_publisher<bynav_gps_msgs::Heading>("heading2", 100);
     }
 
     if (publish_bynav_gpdop_) {
-      gpdop_pub_ =
-          swri::advertise<bynav_gps_msgs::Gpdop>(node, "gpdop", 100, true);
+      // Intra-process publishers reject transient_local before Iron.
+      rclcpp::QoS qos(100);
+      if (!get_node_options().use_intra_process_comms()) {
+        qos.transient_local();
+      }
+      gpdop_pub_ = create_publisher<bynav_gps_msgs::Gpdop>("gpdop", qos);
     }
 
     hw_id_ = "Bynav GPS (" + device_ + ")";
@@ -201,27 +385,144 @@ public:
       if (publish_sync_diagnostic_) {
         diagnostic_updater_.add("Sync", this, &BynavGpsNode::SyncDiagnostic);
       }
+      if (gps_time_stamps_ || shm_refclock_unit_ >= 0) {
+        diagnostic_updater_.add("Clock", this, &BynavGpsNode::ClockDiagnostic);
+      }
+      if (ntrip_enable_) {
+        diagnostic_updater_.add("NTRIP", this, &BynavGpsNode::NtripDiagnostic);
+      }
+      if (pipeline_enable_) {
+        diagnostic_updater_.add("Pipeline", this,
+                                &BynavGpsNode::PipelineDiagnostic);
+      }
+    }
+
+    if (ntrip_enable_) {
+      StartNtripClient();
+    }
+
+    bynav_config_sub_ = create_subscription<bynav_gps_msgs::BynavConfig>(
+        "bynav/config", 10,
+        [this](const std::shared_ptr<bynav_gps_msgs::BynavConfig> conf) {
+          ConfigCallback(*conf);
+        });
+
+    if (pipeline_enable_) {
+      StartPipeline();
+    }
+
+    if (!hosted_) {
+      thread_ = boost::thread(&BynavGpsNode::Spin, this);
+      if (pipeline_enable_ && !SetThreadAffinity(thread_, io_cpu_)) {
+        RCLCPP_WARN(get_logger(), "Unable to pin the I/O stage to CPU %d", io_cpu_);
+      }
     }
+    RCLCPP_INFO(get_logger(), "%s initialized", hw_id_.c_str());
+  }
 
-    bynav_config_sub_ =
-        node.subscribe("bynav/config", 10u, &BynavGpsNode::ConfigCallback, this);
+  template <typename T> void Param(const std::string &name, T &value) {
+    value = declare_parameter<T>(name, value);
+  }
 
-    thread_ = boost::thread(&BynavGpsNode::Spin, this);
-    NODELET_INFO("%s initialized", hw_id_.c_str());
+  template <typename T, typename D>
+  void Param(const std::string &name, T &value, const D &default_value) {
+    value = declare_parameter<T>(name, default_value);
+  }
+
+  // Parsers keep shared ownership of what they produce, so each message is
+  // copied exactly once: into a middleware loan when the RMW supports it,
+  // otherwise into a unique_ptr that intra-process subscribers in the same
+  // container receive without further copies or serialization.
+  template <typename PublisherT, typename MessagePtrT>
+  void Publish(const PublisherT &pub, const MessagePtrT &msg) {
+    typedef typename std::decay<decltype(*msg)>::type MessageT;
+    if (!pub) {
+      return;
+    }
+
+    if (pub->can_loan_messages()) {
+      auto loaned = pub->borrow_loaned_message();
+      loaned.get() = *msg;
+      pub->publish(std::move(loaned));
+    } else {
+      pub->publish(std::make_unique<MessageT>(*msg));
+    }
+  }
+
+  // Messages the driver builds itself, such as the high-rate IMU ones, are
+  // owned by the batch alone and handed to the middleware without a copy.
+  template <typename PublisherT, typename MessageT>
+  void Publish(const PublisherT &pub, std::unique_ptr<MessageT> &msg) {
+    if (pub && msg) {
+      pub->publish(std::move(msg));
+    }
   }
 
   void
   SyncCallback(const std::shared_ptr<builtin_interfaces::msg::Time> &sync) {
-    boost::unique_lock<boost::mutex> lock(mutex_);
-    sync_times_.push_back(sync->data);
+    if (!time_sync_.PushReference(rclcpp::Time(sync->data).seconds())) {
+      RCLCPP_WARN_THROTTLE(get_logger(), *get_clock(), 1000,
+                           "Dropping sync times; they aren't being consumed.");
+    }
   }
 
+  // Only waits for the receiver's responses; the spin thread keeps reading
+  // and matches them to the commands.
   void ConfigCallback(const bynav_gps_msgs::BynavConfig &conf) {
     boost::unique_lock<boost::mutex> lock(config_mutex_);
-    gps_.SetupConfig(conf);
+    if (!gps_.SetupConfig(conf)) {
+      RCLCPP_ERROR(get_logger(), "Failed to apply the receiver configuration.");
+    }
+  }
+
+  void StartNtripClient() {
+    for (size_t i = 0; i < ntrip_message_types_.size(); i++) {
+      ntrip_client_.AllowMessageType(
+          static_cast<uint16_t>(ntrip_message_types_[i]),
+          i < ntrip_message_intervals_.size() ? ntrip_message_intervals_[i]
+                                              : 0.0);
+    }
+
+    if (!ntrip_inject_device_.empty()) {
+      correction_port_.SetSerialBaud(ntrip_inject_baud_);
+      if (!correction_port_.Connect(ntrip_inject_device_, BynavNmea::SERIAL,
+                                    BynavMessageOpts())) {
+        RCLCPP_ERROR(get_logger(), "Unable to open correction port %s: %s",
+                      ntrip_inject_device_.c_str(),
+                      correction_port_.ErrorMsg().c_str());
+        return;
+      }
+      ntrip_client_.SetSink([this](const uint8_t *data, size_t size) {
+        return correction_port_.IsConnected() &&
+               correction_port_.Write(data, size);
+      });
+    } else {
+      ntrip_client_.SetSink([this](const uint8_t *data, size_t size) {
+        return gps_.IsConnected() && gps_.Write(data, size);
+      });
+    }
+
+    if (!ntrip_client_.Start(ntrip_config_)) {
+      RCLCPP_ERROR(get_logger(), "Unable to start NTRIP client: %s",
+                    ntrip_client_.ErrorMsg().c_str());
+    }
   }
 
   void Spin() {
+    if (!Prepare()) {
+      return;
+    }
+    while (rclcpp::ok() && running_) {
+      Step();
+    }
+
+    gps_.Disconnect();
+    RCLCPP_INFO(get_logger(), "%s disconnected and shut down", hw_id_.c_str());
+  }
+
+  // Works out the logs to request and sets up the connection. False if the
+  // logs don't fit the link.
+  bool Prepare() {
     std::string format_suffix;
     if (use_binary_messages_) {
       format_suffix = "b";
@@ -259,7 +560,7 @@ public:
       opts["inspvax" + format_suffix] = period;
       opts["insstdev" + format_suffix] = 1.0;
       if (!use_binary_messages_) {
-        NODELET_WARN(
+        RCLCPP_WARN(get_logger(), 
             "Using the ASCII message format with CORRIMUDATA logs is not "
             "recommended.  "
             "A serial link will not be able to keep up with the data rate.");
@@ -268,57 +569,238 @@ public:
       if (imu_sample_rate_ > 0) {
         gps_.SetImuRate(imu_sample_rate_, true);
       }
+      gps_.SetImuInterpolation(imu_interpolate_, imu_max_wait_s_);
+    }
+    if (publish_odometry_) {
+      opts["inscov" + format_suffix] = 1.0;
+      opts["inspvax" + format_suffix] = 1.0 / imu_rate_;
+      opts["insstdev" + format_suffix] = 1.0;
+    }
+    if (publish_event_poses_) {
+      opts["marktime" + format_suffix] = -1.0;
+      if (event_use_mark2_) {
+        opts["mark2time" + format_suffix] = -1.0;
+      }
+      // Events need INS epochs on both sides to interpolate between.
+      if (opts.count("inspva" + format_suffix) == 0 &&
+          opts.count("inspvax" + format_suffix) == 0) {
+        opts["inspva" + format_suffix] = 1.0 / imu_rate_;
+      }
+    }
+    if (imu_batch_size_ > 0) {
+      if (use_binary_messages_) {
+        opts["rawimusb"] = 1.0 / imu_rate_;
+      } else {
+        RCLCPP_WARN(get_logger(), "IMU batching needs binary RAWIMU logs; "
+                    "set use_binary_messages.");
+      }
+      if (imu_sample_rate_ <= 0) {
+        gps_.SetImuRate(imu_rate_, false);
+      }
+    }
+    gps_.SetImuBatching(std::max(imu_batch_size_, 0),
+                        imu_batch_max_latency_s_);
+    if (log_planner_enable_) {
+      if (!dynamic_logging_) {
+        BynavNmea::AddDefaultLogs(opts);
+        gps_.SetDefaultLogs(false);
+      }
+      requested_log_opts_ = opts;
+      // Until the link is up, plan against the rate negotiation aims for.
+      if (!PlanLogs(opts, serial_baud_)) {
+        return false;
+      }
+    }
+    if (dynamic_logging_) {
+      SetupDynamicLogging(opts);
     }
     if (connection_ == BynavNmea::SERIAL) {
       gps_.SetSerialBaud(serial_baud_);
+      gps_.SetAutoBaud(serial_auto_baud_, serial_receiver_port_);
     }
-    ros::WallRate rate(1000.0);
-    while (ros::ok()) {
-      if (gps_.Connect(device_, connection_, opts)) {
-        NODELET_INFO("%s connected to device", hw_id_.c_str());
-        while (gps_.IsConnected() && ros::ok()) {
-          CheckDeviceForData();
-
-          if (publish_diagnostics_) {
-            diagnostic_updater_.update();
-          }
+    gps_.SetCommandTimeout(command_timeout_ms_, command_retries_);
+    gps_.SetGpsTimeStamps(gps_time_stamps_);
+    if (!gps_.SetShmRefclock(shm_refclock_unit_, gps_leap_seconds_,
+                             shm_refclock_offset_s_)) {
+      RCLCPP_WARN(get_logger(), "NTP SHM refclock disabled: %s",
+                  gps_.GetShmRefclock().ErrorMsg().c_str());
+    }
+    if (config_snapshot_enable_) {
+      gps_.SetConfigSnapshotDir(config_snapshot_dir_.empty()
+                                    ? ConfigSnapshot::DefaultDirectory()
+                                    : config_snapshot_dir_);
+    }
+    if (hosted_) {
+      // The host waits for the device itself and steps it once there is
+      // something to read.
+      gps_.SetReadTimeout(0);
+    } else if (event_driven_) {
+      // Reads wake up as soon as bytes arrive; the timeout only bounds how
+      // long diagnostics can go without an update on an idle link.
+      gps_.SetReadTimeout(EVENT_READ_TIMEOUT_MS);
+    }
+    backoff_.Configure(reconnect_delay_s_, reconnect_max_delay_s_,
+                       reconnect_jitter_);
+    log_opts_ = opts;
+    connected_ns_ = 0;
+    retry_ns_ = 0;
+    link_state_ = LINK_CONNECTING;
+    return true;
+  }
 
-          ros::spinOnce();
-          rate.sleep();
-        }
-      } else {
-        NODELET_ERROR_THROTTLE(1, "Error connecting to device <%s:%s>: %s",
+  // One pass of the link state machine. Hosted devices are stepped by the
+  // host's pools and only block here while connecting and configuring.
+  void Step() {
+    int64_t now_ns = PipelineNowNs();
+    switch (link_state_) {
+    case LINK_CONNECTING:
+      if (gps_.Open(device_, connection_, CONNECT_ATTEMPT_MS)) {
+        link_state_ = LINK_CONFIGURING;
+      } else if (!gps_.WaitingForPeer()) {
+        RCLCPP_ERROR_THROTTLE(get_logger(), *get_clock(), 1000, "Error connecting to device <%s:%s>: %s",
                                connection_type_.c_str(), device_.c_str(),
                                gps_.ErrorMsg().c_str());
         device_errors_++;
         error_msg_ = gps_.ErrorMsg();
+        retry_ns_ = now_ns + static_cast<int64_t>(backoff_.NextDelay() * 1e9);
+        link_state_ = LINK_BACKOFF;
       }
+      break;
 
-      if (ros::ok()) {
-        ros::WallDuration(reconnect_delay_s_).sleep();
+    case LINK_CONFIGURING: {
+      BynavMessageOpts connect_opts = log_opts_;
+      if (dynamic_logging_) {
+        connect_opts = log_manager_.OnConnect(now_ns * 1e-9);
+      } else if (log_planner_enable_ && connection_ == BynavNmea::SERIAL &&
+                 gps_.ActiveSerialBaud() > 0 &&
+                 gps_.ActiveSerialBaud() != planned_baud_) {
+        // Baud negotiation settled on another rate than the plan assumed.
+        BynavMessageOpts opts = requested_log_opts_;
+        if (!PlanLogs(opts, gps_.ActiveSerialBaud())) {
+          gps_.Disconnect();
+          device_errors_++;
+          retry_ns_ =
+              now_ns + static_cast<int64_t>(backoff_.NextDelay() * 1e9);
+          link_state_ = LINK_BACKOFF;
+          break;
+        }
+        log_opts_ = opts;
+        connect_opts = opts;
+      }
+      if (!gps_.Configure(connect_opts)) {
+        RCLCPP_ERROR(get_logger(), "Failed to configure GPS. This port may be read only, or the "
+                     "device may not be functioning as expected; however, the "
+                     "driver may still function correctly if the port has already "
+                     "been pre-configured.");
+      }
+      RCLCPP_INFO(get_logger(), "%s connected to device", hw_id_.c_str());
+      connected_ns_ = PipelineNowNs();
+      link_state_ = LINK_STREAMING;
+      break;
+    }
+
+    case LINK_STREAMING:
+      if (!gps_.IsConnected()) {
+        RCLCPP_WARN(get_logger(), "%s lost the device: %s", hw_id_.c_str(),
+                    gps_.ErrorMsg().c_str());
+        // A link that was up for a while most likely dropped for a
+        // transient reason; try again right away.
+        if (now_ns - connected_ns_ >= STABLE_LINK_NS) {
+          backoff_.Reset();
+          link_state_ = LINK_CONNECTING;
+        } else {
+          retry_ns_ =
+              now_ns + static_cast<int64_t>(backoff_.NextDelay() * 1e9);
+          link_state_ = LINK_BACKOFF;
+        }
+        break;
       }
 
-      if (publish_diagnostics_) {
-        diagnostic_updater_.update();
+      if (dynamic_logging_) {
+        UpdateDynamicLogs();
       }
 
-      ros::spinOnce();
-      rate.sleep();
+      if (pipeline_enable_) {
+        ReadStage();
+      } else {
+        CheckDeviceForData();
+      }
+
+      if (!event_driven_ && !pipeline_enable_ && !hosted_) {
+        poll_rate_.sleep();
+      }
+      break;
+
+    case LINK_BACKOFF:
+      if (now_ns >= retry_ns_) {
+        link_state_ = LINK_CONNECTING;
+      } else if (!hosted_) {
+        // Sleep in slices so shutdown isn't held up by a long backoff.
+        rclcpp::sleep_for(std::chrono::nanoseconds(
+            std::min<int64_t>(retry_ns_ - now_ns, BACKOFF_SLICE_NS)));
+      }
+      break;
     }
+    retry_at_ns_ = link_state_ == LINK_BACKOFF ? retry_ns_ : 0;
+  }
+
+  // Descriptor the host can wait on while the device is streaming, or -1
+  // if it has to be stepped on a timer instead.
+  int NativeHandle() {
+    return link_state_ == LINK_STREAMING ? gps_.NativeHandle() : -1;
+  }
+
+  // Until the device streams, Step() may block while connecting and
+  // configuring.
+  bool Streaming() const { return link_state_ == LINK_STREAMING; }
 
+  void SetBulkService(boost::asio::io_service *service) {
+    gps_.SetBulkService(service);
+  }
+
+  void Shutdown() {
+    running_ = false;
     gps_.Disconnect();
-    NODELET_INFO("%s disconnected and shut down", hw_id_.c_str());
+    RCLCPP_INFO(get_logger(), "%s disconnected and shut down", hw_id_.c_str());
   }
 
 private:
+  static constexpr int32_t EVENT_READ_TIMEOUT_MS = 100;
+  static constexpr int32_t DEVICE_TIMEOUT_MS = 1000;
+  static constexpr size_t PIPELINE_QUEUE_SIZE = 256;
+  static constexpr int32_t PIPELINE_IDLE_MS = 100;
+  static constexpr int64_t LOG_POLL_INTERVAL_NS = 500000000;
+  // How long one attempt may wait for a network peer.
+  static constexpr int32_t CONNECT_ATTEMPT_MS = 250;
+  static constexpr int64_t BACKOFF_SLICE_NS = 100000000;
+  // Links that were up at least this long reconnect without a delay.
+  static constexpr int64_t STABLE_LINK_NS = 10000000000;
+
+  enum LinkState {
+    LINK_CONNECTING,
+    LINK_CONFIGURING,
+    LINK_STREAMING,
+    LINK_BACKOFF
+  };
+
   std::string device_;
   std::string connection_type_;
   int32_t serial_baud_;
+  bool serial_auto_baud_;
+  std::string serial_receiver_port_;
+  int32_t command_timeout_ms_;
+  int32_t command_retries_;
+  bool config_snapshot_enable_;
+  std::string config_snapshot_dir_;
   double polling_period_;
   bool publish_gpgsv_;
   bool publish_gphdt_;
   double imu_rate_;
   double imu_sample_rate_;
+  bool imu_interpolate_;
+  double imu_max_wait_s_;
+  int32_t imu_batch_size_;
+  double imu_batch_max_latency_s_;
   bool span_frame_to_ros_frame_;
   bool publish_clock_steering_;
   bool publish_nav_messages_;
@@ -335,17 +817,36 @@ private:
   bool publish_sync_diagnostic_;
   bool publish_invalid_gpsfix_;
   double reconnect_delay_s_;
+  double reconnect_max_delay_s_;
+  double reconnect_jitter_;
+  ReconnectBackoff backoff_;
+  std::atomic<LinkState> link_state_;
+  std::atomic<int64_t> retry_at_ns_;
+  int64_t retry_ns_;
+  int64_t connected_ns_;
+  BynavMessageOpts log_opts_;
+  rclcpp::WallRate poll_rate_;
+  const bool hosted_;
   bool use_binary_messages_;
+  bool event_driven_;
+  bool gps_time_stamps_;
+  int32_t shm_refclock_unit_;
+  int32_t gps_leap_seconds_;
+  // Minimum transport latency taken off the refclock samples.
+  double shm_refclock_offset_s_;
 
   rclcpp::Publisher<sensor_msgs::msg::NavSatFix>::SharedPtr fix_pub_;
   rclcpp::Publisher<gps_msgs::msg::GPSFix>::SharedPtr gps_pub_;
   rclcpp::Publisher<sensor_msgs::msg::Imu>::SharedPtr imu_pub_;
+  rclcpp::Publisher<bynav_gps_msgs::ImuArray>::SharedPtr imu_array_pub_;
   rclcpp::Publisher<bynav_gps_msgs::Inspva>::SharedPtr inspva_pub_;
   rclcpp::Publisher<bynav_gps_msgs::Inspvax>::SharedPtr inspvax_pub_;
   rclcpp::Publisher<bynav_gps_msgs::Insstdev>::SharedPtr insstdev_pub_;
+  rclcpp::Publisher<bynav_gps_msgs::InsCov>::SharedPtr inscov_pub_;
   rclcpp::Publisher<bynav_gps_msgs::BynavCorrectedImuData>::SharedPtr
       bynav_imu_pub_;
-  rclcpp::Publisher<bynav_gps_msgs::Insstdev>::SharedPtr bynav_position_pub_;
+  rclcpp::Publisher<bynav_gps_msgs::BynavPosition>::SharedPtr
+      bynav_position_pub_;
   rclcpp::Publisher<bynav_gps_msgs::BynavPosition>::SharedPtr
       bynav_gnss_position_pub_;
   rclcpp::Publisher<bynav_gps_msgs::PtnlPJK>::SharedPtr bynav_pjk_position_pub_;
@@ -370,48 +871,216 @@ private:
   rclcpp::Subscription<bynav_gps_msgs::BynavConfig>::SharedPtr
       bynav_config_sub_;
 
-  ros::ServiceServer reset_service_;
+  rclcpp::Service<bynav_gps_msgs::BynavFRESET>::SharedPtr reset_service_;
 
   BynavNmea::ConnectionType connection_;
   BynavNmea gps_;
 
   boost::thread thread_;
-  boost::mutex mutex_;
+  std::atomic<bool> running_;
 
   boost::mutex config_mutex_;
 
   rclcpp::Subscription<builtin_interfaces::msg::Time>::SharedPtr sync_sub_;
-  rclcpp::Time last_sync_;
-
-  boost::circular_buffer<rclcpp::Time> sync_times_;
-
-  boost::circular_buffer<rclcpp::Time> msg_times_;
-
-  stats::accumulator_set<float,
-                         stats::stats<stats::tag::max, stats::tag::min,
-                                      stats::tag::mean, stats::tag::variance>>
-      offset_stats_;
-
-  stats::accumulator_set<float, stats::stats<stats::tag::rolling_mean>>
-      rolling_offset_;
+  // Sync pulses against the receiver's top-of-second GPGGA stamps.
+  TimeAlignment time_sync_;
+  int32_t time_sync_window_;
 
   std::string error_msg_;
   diagnostic_updater::Updater diagnostic_updater_;
   std::string hw_id_;
   double expected_rate_;
-  int32_t device_timeouts_;
-  int32_t device_interrupts_;
-  int32_t device_errors_;
-  int32_t gps_parse_failures_;
-  int32_t gps_insufficient_data_warnings_;
-  int32_t publish_rate_warnings_;
-  int32_t measurement_count_;
-  rclcpp::Time last_published_;
+  // Counted by the I/O and publishing threads and reset by the diagnostic
+  // tasks on the executor.
+  std::atomic<int32_t> device_timeouts_;
+  std::atomic<int32_t> device_interrupts_;
+  std::atomic<int32_t> device_errors_;
+  int64_t idle_since_ns_;
+  std::atomic<int32_t> gps_parse_failures_;
+  std::atomic<int32_t> gps_insufficient_data_warnings_;
+  std::atomic<int32_t> publish_rate_warnings_;
+  std::atomic<int32_t> measurement_count_;
+  // Seconds; zero until the first fix is published.
+  std::atomic<double> last_published_;
   bynav_gps_msgs::BynavPositionPtr last_bynav_position_;
 
   std::string imu_frame_id_;
   std::string frame_id_;
 
+  static constexpr double UNKNOWN_VARIANCE = 1e6;
+  bool publish_odometry_;
+  bool publish_odometry_tf_;
+  std::string odometry_frame_id_;
+  std::string base_frame_id_;
+  std::vector<double> odometry_origin_;
+  EnuFrame enu_frame_;
+  rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr odom_pub_;
+  rclcpp::Publisher<tf2_msgs::msg::TFMessage>::SharedPtr tf_pub_;
+
+  bool publish_event_poses_;
+  bool event_use_mark2_;
+  double event_max_gap_s_;
+  rclcpp::Publisher<bynav_gps_msgs::EventPose>::SharedPtr event_pose_pub_;
+
+  bool ntrip_enable_;
+  NtripClient::Config ntrip_config_;
+  std::string ntrip_inject_device_;
+  int32_t ntrip_inject_baud_;
+  std::vector<int64_t> ntrip_message_types_;
+  std::vector<double> ntrip_message_intervals_;
+  NtripClient ntrip_client_;
+  CorrectionPort correction_port_;
+
+  bool pipeline_enable_;
+  int32_t io_cpu_;
+  int32_t parser_cpu_;
+  int32_t publisher_cpu_;
+  int32_t bulk_parse_threads_;
+  std::atomic<bool> pipeline_running_;
+  boost::thread parser_thread_;
+  boost::thread publisher_thread_;
+  PipelineQueue<RawChunk> raw_queue_;
+  PipelineQueue<ParsedBatch> batch_queue_;
+  std::atomic<int64_t> end_to_end_max_ns_;
+
+  bool dynamic_logging_;
+  double log_unlog_hold_s_;
+  LogManager log_manager_;
+  std::map<std::string, std::vector<rclcpp::PublisherBase::SharedPtr>>
+      log_consumers_;
+  int64_t last_log_poll_ns_;
+  std::atomic<size_t> active_logs_;
+
+  // Registers every configured log with the log manager together with the
+  // topics that consume it. Logs without any consuming topic are kept on.
+  void SetupDynamicLogging(const BynavMessageOpts &opts) {
+    // The planner may have switched formats, so map both.
+    std::map<std::string, std::vector<rclcpp::PublisherBase::SharedPtr>>
+        consumers;
+    consumers["gpgga"] = {gpgga_pub_};
+    consumers["gprmc"] = {gprmc_pub_};
+    consumers["gpgsv"] = {gpgsv_pub_};
+    consumers["gphdt"] = {gphdt_pub_};
+    for (const std::string suffix : {"a", "b"}) {
+      consumers["bestpos" + suffix] = {gps_pub_, fix_pub_,
+                                       bynav_position_pub_};
+      consumers["bestvel" + suffix] = {gps_pub_, fix_pub_,
+                                       bynav_velocity_pub_};
+      consumers["ptnlpjk" + suffix] = {bynav_pjk_position_pub_};
+      consumers["heading2" + suffix] = {bynav_heading_pub_};
+      consumers["gpdop" + suffix] = {gpdop_pub_, gps_pub_};
+      consumers["corrimudata" + suffix] = {imu_pub_, bynav_imu_pub_};
+      consumers["inscov" + suffix] = {imu_pub_, inscov_pub_, odom_pub_,
+                                      tf_pub_};
+      consumers["inspva" + suffix] = {imu_pub_, inspva_pub_, event_pose_pub_};
+      consumers["inspvax" + suffix] = {inspvax_pub_, odom_pub_, tf_pub_,
+                                       event_pose_pub_};
+      consumers["marktime" + suffix] = {event_pose_pub_};
+      consumers["mark2time" + suffix] = {event_pose_pub_};
+      consumers["insstdev" + suffix] = {imu_pub_, insstdev_pub_, odom_pub_,
+                                        tf_pub_};
+      consumers["rawimus" + suffix] = {imu_array_pub_};
+    }
+
+    gps_.SetDefaultLogs(false);
+    log_manager_.Clear();
+    log_manager_.SetUnlogHold(log_unlog_hold_s_);
+    log_consumers_.clear();
+    for (const auto &option : opts) {
+      std::vector<rclcpp::PublisherBase::SharedPtr> pubs;
+      for (const auto &pub : consumers[option.first]) {
+        if (pub) {
+          pubs.push_back(pub);
+        }
+      }
+
+      // GGA also drives time sync and the NTRIP position report.
+      bool always_on = pubs.empty() ||
+                       (option.first == "gpgga" && ntrip_enable_);
+      log_manager_.AddLog(option.first, option.second, always_on);
+      log_consumers_[option.first] = pubs;
+    }
+    log_manager_.AddLog("gpzda", 1.0, true);
+  }
+
+  bool log_planner_enable_;
+  // Refuse to connect rather than drop logs that don't fit the link.
+  bool log_planner_strict_;
+  double max_link_utilization_;
+  int32_t expected_satellites_;
+  BynavMessageOpts requested_log_opts_;
+  int32_t planned_baud_;
+  std::atomic<double> planned_utilization_;
+
+  // Fits the requested logs to a serial link at the given baud before
+  // anything is sent to the receiver, dropping optional logs if needed.
+  // Returns false only in strict mode when they can't be made to fit.
+  bool PlanLogs(BynavMessageOpts &opts, int32_t baud) {
+    if (connection_ != BynavNmea::SERIAL) {
+      return true;
+    }
+
+    LogPlanner::Config config;
+    config.baud = baud;
+    config.max_utilization = max_link_utilization_;
+    config.satellites = expected_satellites_;
+    config.allow_pruning = !log_planner_strict_;
+    LogPlanner::Plan plan = LogPlanner(config).Build(opts);
+    planned_baud_ = baud;
+    planned_utilization_ = plan.Utilization();
+
+    if (!plan.feasible && log_planner_strict_) {
+      RCLCPP_ERROR(get_logger(),
+                   "Requested logs do not fit a %d baud link, not "
+                   "connecting:\n%s",
+                   baud, plan.Report().c_str());
+      error_msg_ = "Requested logs exceed the serial link bandwidth";
+      return false;
+    }
+
+    if (!plan.feasible) {
+      RCLCPP_WARN(get_logger(),
+                  "Critical logs alone exceed a %d baud link, expect "
+                  "delayed or lost messages:\n%s",
+                  baud, plan.Report().c_str());
+    } else if (plan.opts != opts) {
+      RCLCPP_WARN(get_logger(), "Adjusted logs to fit a %d baud link:\n%s",
+                  baud, plan.Report().c_str());
+    } else {
+      RCLCPP_INFO(get_logger(), "Planned serial link utilization: %.0f%%",
+                  plan.Utilization() * 100.0);
+    }
+    opts = plan.opts;
+    return true;
+  }
+
+  void UpdateDynamicLogs() {
+    int64_t now_ns = PipelineNowNs();
+    if (now_ns - last_log_poll_ns_ < LOG_POLL_INTERVAL_NS) {
+      return;
+    }
+    last_log_poll_ns_ = now_ns;
+
+    for (const auto &log : log_consumers_) {
+      bool wanted = false;
+      for (const auto &pub : log.second) {
+        wanted = wanted || pub->get_subscription_count() > 0;
+      }
+      if (log.first == "gpgga") {
+        wanted = wanted || sync_sub_->get_publisher_count() > 0;
+      }
+      log_manager_.SetWanted(log.first, wanted);
+    }
+
+    for (const auto &command : log_manager_.Update(now_ns * 1e-9)) {
+      RCLCPP_INFO(get_logger(), "Subscriber change: %s",
+                  command.substr(0, command.size() - 2).c_str());
+      // Runs on the I/O thread, which must not wait for the response.
+      gps_.SendCommand(command);
+    }
+    active_logs_ = log_manager_.LoggedCount();
+  }
+
   bool resetService(bynav_gps_msgs::BynavFRESET::Request &req,
                     bynav_gps_msgs::BynavFRESET::Response &res) {
     if (!gps_.IsConnected()) {
@@ -419,46 +1088,208 @@ private:
     }
 
     std::string command = "FRESET ";
-    command += req.target.length() ? "STANDARD" : req.target;
+    command += req.target.length() ? req.target : "STANDARD";
     command += "\r\n";
     gps_.Write(command);
+    gps_.ClearReceiverConfig();
 
     if (req.target.length() == 0) {
-      ROS_WARN("No FRESET target specified. Doing FRESET STANDARD. This may be "
-               "undesired behavior.");
+      RCLCPP_WARN(get_logger(),
+                  "No FRESET target specified. Doing FRESET STANDARD. This "
+                  "may be undesired behavior.");
     }
 
     res.success = true;
     return true;
   }
 
+  void StartPipeline() {
+    pipeline_running_ = true;
+    parser_thread_ = boost::thread(&BynavGpsNode::ParseStage, this);
+    publisher_thread_ = boost::thread(&BynavGpsNode::PublishStage, this);
+    if (!SetThreadAffinity(parser_thread_, parser_cpu_)) {
+      RCLCPP_WARN(get_logger(), "Unable to pin the parsing stage to CPU %d", parser_cpu_);
+    }
+    if (!SetThreadAffinity(publisher_thread_, publisher_cpu_)) {
+      RCLCPP_WARN(get_logger(), "Unable to pin the publishing stage to CPU %d",
+                   publisher_cpu_);
+    }
+  }
+
+  void StopPipeline() {
+    if (!pipeline_running_) {
+      return;
+    }
+    pipeline_running_ = false;
+    raw_queue_.Wake();
+    batch_queue_.Wake();
+    parser_thread_.join();
+    publisher_thread_.join();
+  }
+
+  // I/O stage: runs on the device thread and only reads.
+  void ReadStage() {
+    RawChunk *chunk = new RawChunk();
+    chunk->result = gps_.ReadChunk(chunk->data, chunk->stamps);
+    if (chunk->result != BynavNmea::READ_SUCCESS) {
+      chunk->error_msg = gps_.ErrorMsg();
+    }
+
+    // Back off rather than drop bytes, which would break framing; the OS
+    // buffers the device in the meantime.
+    while (!raw_queue_.Push(chunk)) {
+      if (!pipeline_running_) {
+        delete chunk;
+        return;
+      }
+      boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+    }
+  }
+
+  // Parsing stage: owns gps_'s parsers and message buffers.
+  void ParseStage() {
+    while (pipeline_running_) {
+      std::unique_ptr<RawChunk> chunk(raw_queue_.Pop(PIPELINE_IDLE_MS));
+      if (!chunk) {
+        continue;
+      }
+
+      ParsedBatch *batch = new ParsedBatch();
+      batch->read_ns = chunk->enqueue_ns;
+      batch->result = chunk->result;
+      batch->error_msg = chunk->error_msg;
+      if (chunk->result == BynavNmea::READ_SUCCESS) {
+        batch->result = gps_.ParseData(chunk->data.data(), chunk->data.size(),
+                                       chunk->stamps);
+        if (batch->result != BynavNmea::READ_SUCCESS) {
+          batch->error_msg = gps_.ErrorMsg();
+        }
+      }
+      CollectMessages(*batch);
+
+      while (!batch_queue_.Push(batch)) {
+        if (!pipeline_running_) {
+          delete batch;
+          return;
+        }
+        boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+      }
+    }
+  }
+
+  // Publishing stage: owns time sync and publishers. Diagnostics are only
+  // published by the updater's own timer.
+  void PublishStage() {
+    while (pipeline_running_) {
+      std::unique_ptr<ParsedBatch> batch(batch_queue_.Pop(PIPELINE_IDLE_MS));
+      if (batch) {
+        PublishBatch(*batch);
+        int64_t end_to_end = PipelineNowNs() - batch->read_ns;
+        if (end_to_end > end_to_end_max_ns_) {
+          end_to_end_max_ns_ = end_to_end;
+        }
+      }
+    }
+  }
+
   void CheckDeviceForData() {
-    std::vector<gps_msgs::msg::GPSFixPtr> fix_msgs;
-    std::vector<bynav_gps_msgs::BynavPositionPtr> position_msgs;
-    std::vector<bynav_gps_msgs::GpggaPtr> gpgga_msgs;
+    ParsedBatch batch;
+    batch.result = gps_.ProcessData();
+    if (batch.result != BynavNmea::READ_SUCCESS) {
+      batch.error_msg = gps_.ErrorMsg();
+    }
+    CollectMessages(batch);
+    PublishBatch(batch);
+  }
+
+  void CollectMessages(ParsedBatch &batch) {
+    gps_.GetFixMessages(batch.fix_msgs);
+    gps_.GetGpggaMessages(batch.gpgga_msgs);
+    gps_.GetBynavPositions(batch.position_msgs);
+
+    if (ntrip_enable_ && !batch.gpgga_msgs.empty()) {
+      batch.gga_sentence = gps_.GetLatestGgaSentence();
+    }
+    if (publish_nmea_messages_) {
+      gps_.GetGprmcMessages(batch.gprmc_msgs);
+    }
+    if (publish_gpgsv_) {
+      gps_.GetGpgsvMessages(batch.gpgsv_msgs);
+    }
+    if (publish_gphdt_) {
+      gps_.GetGphdtMessages(batch.gphdt_msgs);
+    }
+    if (publish_bynav_gnss_positions_) {
+      gps_.GetBynavGnssPositions(batch.gnss_position_msgs);
+    }
+    if (publish_bynav_pjk_positions_) {
+      gps_.GetBynavPJKPositions(batch.pjk_position_msgs);
+    }
+    if (publish_bynav_heading_) {
+      gps_.GetHeadingMessages(batch.heading_msgs);
+    }
+    if (publish_bynav_gpdop_) {
+      gps_.GetGpdopMessages(batch.gpdop_msgs);
+    }
+    if (publish_bynav_velocity_) {
+      gps_.GetBynavVelocities(batch.velocity_msgs);
+    }
+    if (publish_imu_messages_) {
+      gps_.GetBynavCorrectedImuData(batch.bynav_imu_msgs);
+      gps_.GetImuMessages(batch.imu_msgs);
+      gps_.GetInspvaMessages(batch.inspva_msgs);
+    }
+    if (publish_imu_messages_ || publish_odometry_) {
+      gps_.GetInspvaxMessages(batch.inspvax_msgs);
+      gps_.GetInsstdevMessages(batch.insstdev_msgs);
+      gps_.GetInscovMessages(batch.inscov_msgs);
+    }
+    if (imu_batch_size_ > 0) {
+      gps_.GetImuArrays(batch.imu_arrays);
+    }
+    if (publish_event_poses_) {
+      gps_.GetEventPoses(batch.event_poses);
+    }
+  }
 
-    BynavNmea::ReadResult result = gps_.ProcessData();
+  void PublishBatch(ParsedBatch &batch) {
+    BynavNmea::ReadResult result = batch.result;
     if (result == BynavNmea::READ_ERROR) {
-      NODELET_ERROR_THROTTLE(1, "Error reading from device <%s:%s>: %s",
+      RCLCPP_ERROR_THROTTLE(get_logger(), *get_clock(), 1000, "Error reading from device <%s:%s>: %s",
                              connection_type_.c_str(), device_.c_str(),
-                             gps_.ErrorMsg().c_str());
+                             batch.error_msg.c_str());
       device_errors_++;
     } else if (result == BynavNmea::READ_TIMEOUT) {
-      device_timeouts_++;
+      // Short waits only count once the link has been idle for as long as
+      // a legacy blocking read would have waited.
+      int64_t now_ns = PipelineNowNs();
+      if (!event_driven_ && !hosted_) {
+        device_timeouts_++;
+      } else if (idle_since_ns_ == 0) {
+        idle_since_ns_ = now_ns;
+      } else if (now_ns - idle_since_ns_ >= DEVICE_TIMEOUT_MS * 1000000ll) {
+        device_timeouts_++;
+        idle_since_ns_ = now_ns;
+      }
     } else if (result == BynavNmea::READ_INTERRUPTED) {
       device_interrupts_++;
     } else if (result == BynavNmea::READ_PARSE_FAILED) {
-      NODELET_ERROR("Error reading from device <%s:%s>: %s",
+      RCLCPP_ERROR(get_logger(), "Error reading from device <%s:%s>: %s",
                     connection_type_.c_str(), device_.c_str(),
-                    gps_.ErrorMsg().c_str());
+                    batch.error_msg.c_str());
       gps_parse_failures_++;
     } else if (result == BynavNmea::READ_INSUFFICIENT_DATA) {
       gps_insufficient_data_warnings_++;
     }
 
-    gps_.GetFixMessages(fix_msgs);
-    gps_.GetGpggaMessages(gpgga_msgs);
-    gps_.GetBynavPositions(position_msgs);
+    if (result != BynavNmea::READ_TIMEOUT) {
+      idle_since_ns_ = 0;
+    }
+
+    std::vector<gps_msgs::msg::GPSFixPtr> &fix_msgs = batch.fix_msgs;
+    std::vector<bynav_gps_msgs::BynavPositionPtr> &position_msgs =
+        batch.position_msgs;
+    std::vector<bynav_gps_msgs::GpggaPtr> &gpgga_msgs = batch.gpgga_msgs;
 
     measurement_count_ += position_msgs.size();
 
@@ -466,6 +1297,10 @@ private:
       last_bynav_position_ = position_msgs.back();
     }
 
+    if (!batch.gga_sentence.empty()) {
+      ntrip_client_.SetGgaSentence(batch.gga_sentence);
+    }
+
     for (const auto &msg : gpgga_msgs) {
       if (msg->utc_seconds != 0) {
         auto second =
@@ -473,52 +1308,46 @@ private:
         double difference = std::fabs(msg->utc_seconds - second);
 
         if (difference < 0.02) {
-          msg_times_.push_back(msg->header.stamp);
+          time_sync_.PushMeasurement(msg->header.stamp.toSec());
         }
       }
     }
 
-    CalculateTimeSync();
+    time_sync_.Align();
 
     ros::Duration sync_offset(0);
-    if (last_sync_ != ros::TIME_MIN) {
-      sync_offset = ros::Duration(stats::rolling_mean(rolling_offset_));
+    if (time_sync_.Synced()) {
+      sync_offset = ros::Duration(time_sync_.Offset());
     }
-    NODELET_DEBUG_STREAM("GPS TimeSync offset is " << sync_offset);
+    RCLCPP_DEBUG_STREAM(get_logger(), "GPS TimeSync offset is " << sync_offset);
 
     if (publish_nmea_messages_) {
       for (const auto &msg : gpgga_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        gpgga_pub_.publish(msg);
+        Publish(gpgga_pub_, msg);
       }
 
-      std::vector<bynav_gps_msgs::GprmcPtr> gprmc_msgs;
-      gps_.GetGprmcMessages(gprmc_msgs);
-      for (const auto &msg : gprmc_msgs) {
+      for (const auto &msg : batch.gprmc_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        gprmc_pub_.publish(msg);
+        Publish(gprmc_pub_, msg);
       }
     }
 
     if (publish_gpgsv_) {
-      std::vector<bynav_gps_msgs::GpgsvPtr> gpgsv_msgs;
-      gps_.GetGpgsvMessages(gpgsv_msgs);
-      for (const auto &msg : gpgsv_msgs) {
+      for (const auto &msg : batch.gpgsv_msgs) {
         msg->header.stamp = ros::Time::now();
         msg->header.frame_id = frame_id_;
-        gpgsv_pub_.publish(msg);
+        Publish(gpgsv_pub_, msg);
       }
     }
 
     if (publish_gphdt_) {
-      std::vector<bynav_gps_msgs::GphdtPtr> gphdt_msgs;
-      gps_.GetGphdtMessages(gphdt_msgs);
-      for (const auto &msg : gphdt_msgs) {
+      for (const auto &msg : batch.gphdt_msgs) {
         msg->header.stamp = ros::Time::now();
         msg->header.frame_id = frame_id_;
-        gphdt_pub_.publish(msg);
+        Publish(gphdt_pub_, msg);
       }
     }
 
@@ -526,123 +1355,214 @@ private:
       for (const auto &msg : position_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        bynav_position_pub_.publish(msg);
+        Publish(bynav_position_pub_, msg);
       }
     }
 
     if (publish_bynav_gnss_positions_) {
-      std::vector<bynav_gps_msgs::BynavPositionPtr> gnss_position_msgs;
-      gps_.GetBynavGnssPositions(gnss_position_msgs);
-      for (const auto &msg : gnss_position_msgs) {
+      for (const auto &msg : batch.gnss_position_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        bynav_gnss_position_pub_.publish(msg);
+        Publish(bynav_gnss_position_pub_, msg);
       }
     }
 
     if (publish_bynav_pjk_positions_) {
-      std::vector<bynav_gps_msgs::PtnlPJKPtr> xyz_position_msgs;
-      gps_.GetBynavPJKPositions(xyz_position_msgs);
-      for (const auto &msg : xyz_position_msgs) {
+      for (const auto &msg : batch.pjk_position_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        bynav_pjk_position_pub_.publish(msg);
+        Publish(bynav_pjk_position_pub_, msg);
       }
     }
 
     if (publish_bynav_heading_) {
-      std::vector<bynav_gps_msgs::HeadingPtr> heading_msgs;
-      gps_.GetHeadingMessages(heading_msgs);
-      for (const auto &msg : heading_msgs) {
+      for (const auto &msg : batch.heading_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        bynav_heading_pub_.publish(msg);
+        Publish(bynav_heading_pub_, msg);
       }
     }
 
     if (publish_bynav_gpdop_) {
-      std::vector<bynav_gps_msgs::GpdopPtr> gpdop_msgs;
-      gps_.GetGpdopMessages(gpdop_msgs);
-      for (const auto &msg : gpdop_msgs) {
+      for (const auto &msg : batch.gpdop_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        gpdop_pub_.publish(msg);
+        Publish(gpdop_pub_, msg);
       }
     }
 
     if (publish_bynav_velocity_) {
-      std::vector<bynav_gps_msgs::BynavVelocityPtr> velocity_msgs;
-      gps_.GetBynavVelocities(velocity_msgs);
-      for (const auto &msg : velocity_msgs) {
+      for (const auto &msg : batch.velocity_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = frame_id_;
-        bynav_velocity_pub_.publish(msg);
+        Publish(bynav_velocity_pub_, msg);
       }
     }
 
     if (publish_imu_messages_) {
-      std::vector<bynav_gps_msgs::BynavCorrectedImuDataPtr> bynav_imu_msgs;
-      gps_.GetBynavCorrectedImuData(bynav_imu_msgs);
-      for (const auto &msg : bynav_imu_msgs) {
+      for (const auto &msg : batch.bynav_imu_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = imu_frame_id_;
-        bynav_imu_pub_.publish(msg);
+        Publish(bynav_imu_pub_, msg);
       }
 
-      std::vector<sensor_msgs::msg::ImuPtr> imu_msgs;
-      gps_.GetImuMessages(imu_msgs);
-      for (const auto &msg : imu_msgs) {
+      for (auto &msg : batch.imu_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = imu_frame_id_;
-        imu_pub_.publish(msg);
+        Publish(imu_pub_, msg);
       }
 
-      std::vector<bynav_gps_msgs::InspvaPtr> inspva_msgs;
-      gps_.GetInspvaMessages(inspva_msgs);
-      for (const auto &msg : inspva_msgs) {
+      for (const auto &msg : batch.inspva_msgs) {
         msg->header.stamp += sync_offset;
         msg->header.frame_id = imu_frame_id_;
-        inspva_pub_.publish(msg);
+        Publish(inspva_pub_, msg);
       }
+    }
 
-      std::vector<bynav_gps_msgs::InspvaxPtr> inspvax_msgs;
-      gps_.GetInspvaxMessages(inspvax_msgs);
-      for (const auto &msg : inspvax_msgs) {
-        msg->header.stamp += sync_offset;
-        msg->header.frame_id = imu_frame_id_;
-        inspvax_pub_.publish(msg);
-      }
+    for (const auto &msg : batch.insstdev_msgs) {
+      msg->header.stamp += sync_offset;
+      msg->header.frame_id = imu_frame_id_;
+      Publish(insstdev_pub_, msg);
+    }
 
-      std::vector<bynav_gps_msgs::InsstdevPtr> insstdev_msgs;
-      gps_.GetInsstdevMessages(insstdev_msgs);
-      for (const auto &msg : insstdev_msgs) {
-        msg->header.stamp += sync_offset;
-        msg->header.frame_id = imu_frame_id_;
-        insstdev_pub_.publish(msg);
+    for (const auto &msg : batch.inscov_msgs) {
+      msg->header.stamp += sync_offset;
+      msg->header.frame_id = imu_frame_id_;
+      Publish(inscov_pub_, msg);
+    }
+
+    for (const auto &msg : batch.inspvax_msgs) {
+      msg->header.stamp += sync_offset;
+      msg->header.frame_id = imu_frame_id_;
+      Publish(inspvax_pub_, msg);
+      if (publish_odometry_) {
+        PublishOdometry(*msg);
       }
     }
 
+    for (auto &msg : batch.imu_arrays) {
+      msg->header.stamp += sync_offset;
+      msg->header.frame_id = imu_frame_id_;
+      Publish(imu_array_pub_, msg);
+    }
+
+    for (const auto &msg : batch.event_poses) {
+      msg->header.stamp += sync_offset;
+      msg->header.frame_id = imu_frame_id_;
+      Publish(event_pose_pub_, msg);
+    }
+
     for (const auto &msg : fix_msgs) {
       msg->header.stamp += sync_offset;
       msg->header.frame_id = frame_id_;
       if (publish_invalid_gpsfix_ ||
           msg->status.status != gps_msgs::msg::GPSStatus::STATUS_NO_FIX) {
-        gps_pub_.publish(msg);
+        Publish(gps_pub_, msg);
       }
 
-      if (fix_pub_.getNumSubscribers() > 0) {
+      if (fix_pub_->get_subscription_count() > 0) {
         sensor_msgs::msg::NavSatFixPtr fix_msg = ConvertGpsFixToNavSatFix(msg);
 
-        fix_pub_.publish(fix_msg);
+        Publish(fix_pub_, fix_msg);
       }
 
-      if (last_published_ != ros::TIME_MIN &&
-          (msg->header.stamp - last_published_).toSec() >
-              1.5 * (1.0 / expected_rate_)) {
+      double stamp = msg->header.stamp.toSec();
+      double last_published = last_published_.exchange(stamp);
+      if (last_published > 0.0 &&
+          stamp - last_published > 1.5 * (1.0 / expected_rate_)) {
         publish_rate_warnings_++;
       }
+    }
+  }
+
+  // INSPVAX in the tangent plane at the odometry origin. The child frame is
+  // the REP-103 body frame (x forward, y left, z up) rather than the
+  // receiver's IMU axes (x right, y forward), so azimuth, measured clockwise
+  // from north, becomes a yaw from east and nose-up pitch a negative
+  // rotation about y. The twist is in the body frame. INSPVAX has no angular
+  // rates.
+  void PublishOdometry(const bynav_gps_msgs::Inspvax &inspvax) {
+    double lat = inspvax.latitude * DEGREES_TO_RADIANS;
+    double lon = inspvax.longitude * DEGREES_TO_RADIANS;
+    double height = inspvax.altitude + inspvax.undulation;
+    if (!enu_frame_.HasOrigin()) {
+      enu_frame_.SetOrigin(lat, lon, height);
+      RCLCPP_INFO(get_logger(), "Odometry origin set to %.9f, %.9f, %.3f",
+                  inspvax.latitude, inspvax.longitude, height);
+    }
+
+    double enu[3];
+    enu_frame_.GeodeticToEnu(lat, lon, height, enu);
+    AttitudeInterpolator::Quaternion q =
+        AttitudeInterpolator::FromRollPitchYaw(
+            inspvax.roll * DEGREES_TO_RADIANS,
+            -inspvax.pitch * DEGREES_TO_RADIANS,
+            M_PI / 2.0 - inspvax.azimuth * DEGREES_TO_RADIANS);
+    Eigen::Matrix3d body_to_enu =
+        Eigen::Quaterniond(q.w, q.x, q.y, q.z).toRotationMatrix();
+
+    nav_msgs::msg::Odometry odom;
+    odom.header.stamp = inspvax.header.stamp;
+    odom.header.frame_id = odometry_frame_id_;
+    odom.child_frame_id = base_frame_id_;
+    odom.pose.pose.position.x = enu[0];
+    odom.pose.pose.position.y = enu[1];
+    odom.pose.pose.position.z = enu[2];
+    odom.pose.pose.orientation.x = q.x;
+    odom.pose.pose.orientation.y = q.y;
+    odom.pose.pose.orientation.z = q.z;
+    odom.pose.pose.orientation.w = q.w;
+
+    // Full matrices from INSCOV; only the diagonal from the INSPVAX std
+    // fields or INSSTDEV on receivers that don't log it.
+    typedef Eigen::Matrix<double, 3, 3, Eigen::RowMajor> RowMajorMatrix3d;
+    Eigen::Matrix3d velocity_cov =
+        Eigen::Matrix3d::Identity() * UNKNOWN_VARIANCE;
+    InsCovariance covariance = gps_.GetInsCovariance();
+    if (covariance.GetSource() != InsCovariance::NONE) {
+      Eigen::Map<const RowMajorMatrix3d> position_cov(covariance.Position());
+      Eigen::Map<const RowMajorMatrix3d> attitude_cov(covariance.Attitude());
+      for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+          odom.pose.covariance[r * 6 + c] = position_cov(r, c);
+          odom.pose.covariance[(r + 3) * 6 + c + 3] = attitude_cov(r, c);
+        }
+      }
+      velocity_cov = body_to_enu.transpose() *
+                     Eigen::Map<const RowMajorMatrix3d>(
+                         covariance.Velocity()) *
+                     body_to_enu;
+    } else {
+      for (int i = 0; i < 6; i++) {
+        odom.pose.covariance[i * 7] = UNKNOWN_VARIANCE;
+      }
+    }
 
-      last_published_ = msg->header.stamp;
+    Eigen::Vector3d velocity(inspvax.east_velocity, inspvax.north_velocity,
+                             inspvax.up_velocity);
+    Eigen::Vector3d body_velocity = body_to_enu.transpose() * velocity;
+    odom.twist.twist.linear.x = body_velocity.x();
+    odom.twist.twist.linear.y = body_velocity.y();
+    odom.twist.twist.linear.z = body_velocity.z();
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) {
+        odom.twist.covariance[r * 6 + c] = velocity_cov(r, c);
+      }
+      odom.twist.covariance[(r + 3) * 7] = UNKNOWN_VARIANCE;
+    }
+    Publish(odom_pub_, &odom);
+
+    if (tf_pub_) {
+      tf2_msgs::msg::TFMessage tf;
+      tf.transforms.resize(1);
+      geometry_msgs::msg::TransformStamped &transform = tf.transforms[0];
+      transform.header = odom.header;
+      transform.child_frame_id = base_frame_id_;
+      transform.transform.translation.x = enu[0];
+      transform.transform.translation.y = enu[1];
+      transform.transform.translation.z = enu[2];
+      transform.transform.rotation = odom.pose.pose.orientation;
+      Publish(tf_pub_, &tf);
     }
   }
 
@@ -671,7 +1591,8 @@ private:
     case gps_msgs::msg::GPSStatus::STATUS_DGPS_FIX:
     case gps_msgs::msg::GPSStatus::STATUS_WAAS_FIX:
     default:
-      ROS_WARN_ONCE("Unsupported fix status: %d", msg->status.status);
+      RCLCPP_WARN_ONCE(get_logger(), "Unsupported fix status: %d",
+                       msg->status.status);
       fix_msg->status.status = sensor_msgs::msg::NavSatStatus::STATUS_FIX;
       break;
     }
@@ -693,8 +1614,8 @@ private:
           sensor_msgs::msg::NavSatFix::COVARIANCE_TYPE_UNKNOWN;
       break;
     default:
-      ROS_WARN_ONCE("Unsupported covariance type: %d",
-                    msg->position_covariance_type);
+      RCLCPP_WARN_ONCE(get_logger(), "Unsupported covariance type: %d",
+                       msg->position_covariance_type);
       fix_msg->position_covariance_type =
           sensor_msgs::msg::NavSatFix::COVARIANCE_TYPE_UNKNOWN;
       break;
@@ -704,144 +1625,440 @@ private:
     return fix_msg;
   }
 
-  void CalculateTimeSync() {
-    boost::unique_lock<boost::mutex> lock(mutex_);
-    int32_t synced_i = -1;
-    int32_t synced_j = -1;
-
-    for (size_t i = 0; i < sync_times_.size(); i++) {
-      for (size_t j = synced_j + 1; j < msg_times_.size(); j++) {
-        double offset = (sync_times_[i] - msg_times_[j]).toSec();
-        if (std::fabs(offset) < 0.49) {
-          synced_i = static_cast<int32_t>(i);
-          synced_j = static_cast<int32_t>(j);
-          offset_stats_(offset);
-          rolling_offset_(offset);
-          last_sync_ = sync_times_[i];
-          break;
-        }
-      }
+  void SyncDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
+    status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Nominal");
+
+    TimeAlignment::Summary sync = time_sync_.GetSummary();
+    if (!sync.synced) {
+      status.summary(diagnostic_msgs::DiagnosticStatus::WARN, "No Sync");
+      return;
+    } else if (sync.last_reference < ros::Time::now().toSec() - 10.0) {
+      status.summary(diagnostic_msgs::DiagnosticStatus::ERROR, "Sync Stale");
+      RCLCPP_ERROR(get_logger(), "GPS time synchronization is stale.");
     }
 
-    for (int i = 0; i <= synced_i && !sync_times_.empty(); i++) {
-      sync_times_.pop_front();
+    status.add("Last Sync", sync.last_reference);
+    status.add("Window", sync.count);
+    status.add("Mean Offset", sync.mean);
+    status.add("Offset Variance", sync.variance);
+    status.add("Min Offset", sync.min);
+    status.add("Max Offset", sync.max);
+  }
+
+  void ClockDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
+    const ClockModel &clock = gps_.GetClockModel();
+    if (clock.Valid()) {
+      status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Nominal");
+    } else {
+      status.summary(diagnostic_msgs::DiagnosticStatus::WARN,
+                     "Stamping With Arrival Time");
     }
 
-    for (int j = 0; j <= synced_j && !msg_times_.empty(); j++) {
-      msg_times_.pop_front();
+    status.add("Offset (s)", clock.Offset());
+    status.add("Drift (ppm)", clock.DriftPpm());
+    status.add("Jitter (ms)", clock.Jitter() * 1e3);
+    status.add("Samples", clock.Samples());
+    status.add("Resets", clock.Resets());
+    status.add("Outliers", clock.Outliers());
+    const ShmRefclock &refclock = gps_.GetShmRefclock();
+    if (refclock.IsOpen()) {
+      status.add("SHM Unit", refclock.Unit());
+      status.add("SHM Samples", refclock.Samples());
     }
   }
 
-  void SyncDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
+  void NtripDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
+    if (ntrip_client_.IsStreaming()) {
+      status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Streaming");
+    } else {
+      status.summary(diagnostic_msgs::DiagnosticStatus::WARN,
+                     "Not Streaming");
+      status.add("Error", ntrip_client_.ErrorMsg());
+    }
+
+    status.add("Bytes Received", ntrip_client_.BytesReceived());
+    status.add("Frames Injected", ntrip_client_.FramesInjected());
+    status.add("Inject Failures", ntrip_client_.InjectFailures());
+    status.add("Frames Filtered", ntrip_client_.FramesFiltered());
+    status.add("Bandwidth", ntrip_client_.BandwidthReport());
+  }
+
+  void PipelineDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
     status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Nominal");
 
-    if (last_sync_ == ros::TIME_MIN) {
-      status.summary(diagnostic_msgs::DiagnosticStatus::WARN, "No Sync");
-      return;
-    } else if (last_sync_ < ros::Time::now() - ros::Duration(10)) {
-      status.summary(diagnostic_msgs::DiagnosticStatus::ERROR, "Sync Stale");
-      NODELET_ERROR("GPS time synchronization is stale.");
+    StageMetrics &parse = raw_queue_.Metrics();
+    StageMetrics &publish = batch_queue_.Metrics();
+    if (parse.overflows > 0 || publish.overflows > 0) {
+      status.summary(diagnostic_msgs::DiagnosticStatus::WARN,
+                     "Pipeline Queue Full");
     }
 
-    status.add("Last Sync", last_sync_);
-    status.add("Mean Offset", stats::mean(offset_stats_));
-    status.add("Mean Offset (rolling)", stats::rolling_mean(rolling_offset_));
-    status.add("Offset Variance", stats::variance(offset_stats_));
-    status.add("Min Offset", stats::min(offset_stats_));
-    status.add("Max Offset", stats::max(offset_stats_));
+    status.add("Parse Queue Max Depth", static_cast<size_t>(parse.max_depth));
+    status.add("Parse Queue Mean Latency (us)", parse.MeanLatencyUs());
+    status.add("Parse Queue Max Latency (us)", parse.max_latency_ns / 1000.0);
+    status.add("Parse Queue Full", static_cast<uint64_t>(parse.overflows));
+    status.add("Publish Queue Max Depth",
+               static_cast<size_t>(publish.max_depth));
+    status.add("Publish Queue Mean Latency (us)", publish.MeanLatencyUs());
+    status.add("Publish Queue Max Latency (us)",
+               publish.max_latency_ns / 1000.0);
+    status.add("Publish Queue Full", static_cast<uint64_t>(publish.overflows));
+    status.add("Read To Publish Max Latency (us)",
+               end_to_end_max_ns_.exchange(0) / 1000.0);
+
+    parse.Reset();
+    publish.Reset();
   }
 
   void DeviceDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
     status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Nominal");
 
-    if (device_errors_ > 0) {
+    int32_t device_errors = device_errors_.exchange(0);
+    int32_t device_interrupts = device_interrupts_.exchange(0);
+    int32_t device_timeouts = device_timeouts_.exchange(0);
+    if (device_errors > 0) {
       status.summary(diagnostic_msgs::DiagnosticStatus::ERROR, "Device Errors");
-    } else if (device_interrupts_ > 0) {
+    } else if (device_interrupts > 0) {
       status.summary(diagnostic_msgs::DiagnosticStatus::WARN,
                      "Device Interrupts");
-      NODELET_WARN("device interrupts detected <%s:%s>: %d",
+      RCLCPP_WARN(get_logger(), "device interrupts detected <%s:%s>: %d",
                    connection_type_.c_str(), device_.c_str(),
-                   device_interrupts_);
-    } else if (device_timeouts_) {
+                   device_interrupts);
+    } else if (device_timeouts) {
       status.summary(diagnostic_msgs::DiagnosticStatus::WARN,
                      "Device Timeouts");
-      NODELET_WARN("device timeouts detected <%s:%s>: %d",
-                   connection_type_.c_str(), device_.c_str(), device_timeouts_);
+      RCLCPP_WARN(get_logger(), "device timeouts detected <%s:%s>: %d",
+                   connection_type_.c_str(), device_.c_str(), device_timeouts);
     }
 
-    status.add("Errors", device_errors_);
-    status.add("Interrupts", device_interrupts_);
-    status.add("Timeouts", device_timeouts_);
-
-    device_timeouts_ = 0;
-    device_interrupts_ = 0;
-    device_errors_ = 0;
+    static const char *LINK_STATE_NAMES[] = {"Connecting", "Configuring",
+                                             "Streaming", "Backing Off"};
+    LinkState state = link_state_;
+    if (state != LINK_STREAMING) {
+      status.summary(diagnostic_msgs::DiagnosticStatus::ERROR,
+                     "Not Connected");
+    }
+    status.add("State", LINK_STATE_NAMES[state]);
+    status.add("Reconnect Attempts", backoff_.Attempts());
+    int64_t retry_at_ns = retry_at_ns_;
+    if (retry_at_ns > 0) {
+      status.add("Next Attempt In (s)",
+                 std::max<int64_t>(retry_at_ns - PipelineNowNs(), 0) * 1e-9);
+    }
+    status.add("Errors", device_errors);
+    status.add("Interrupts", device_interrupts);
+    status.add("Timeouts", device_timeouts);
   }
 
   void GpsDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
     status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Nominal");
 
-    if (gps_parse_failures_ > 0) {
+    int32_t parse_failures = gps_parse_failures_.exchange(0);
+    if (parse_failures > 0) {
       status.summary(diagnostic_msgs::DiagnosticStatus::WARN, "Parse Failures");
-      NODELET_WARN("gps parse failures detected <%s>: %d", hw_id_.c_str(),
-                   gps_parse_failures_);
+      RCLCPP_WARN(get_logger(), "gps parse failures detected <%s>: %d", hw_id_.c_str(),
+                   parse_failures);
     }
 
-    status.add("Parse Failures", gps_parse_failures_);
-    status.add("Insufficient Data Warnings", gps_insufficient_data_warnings_);
-
-    gps_parse_failures_ = 0;
-    gps_insufficient_data_warnings_ = 0;
+    status.add("Parse Failures", parse_failures);
+    status.add("Insufficient Data Warnings",
+               gps_insufficient_data_warnings_.exchange(0));
+    status.add("Bulk Parse Failures", gps_.BulkParseFailures());
+    if (dynamic_logging_) {
+      status.add("Active Logs", active_logs_.load());
+    }
+    if (publish_event_poses_) {
+      status.add("Events Without Pose", gps_.EventsWithoutPose());
+    }
+    if (connection_ == BynavNmea::SERIAL) {
+      status.add("Serial Baud", gps_.ActiveSerialBaud());
+    }
+    status.add("Commands Rejected", gps_.Commands().Errors());
+    status.add("Commands Timed Out", gps_.Commands().Timeouts());
+    if (log_planner_enable_ && connection_ == BynavNmea::SERIAL) {
+      status.add("Planned Link Utilization", planned_utilization_.load());
+    }
   }
 
   void DataDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
     status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Nominal");
 
     double period = diagnostic_updater_.getPeriod();
-    double measured_rate = measurement_count_ / period;
+    double measured_rate = measurement_count_.exchange(0) / period;
 
     if (measured_rate < 0.5 * expected_rate_) {
       status.summary(diagnostic_msgs::DiagnosticStatus::ERROR,
                      "Insufficient Data Rate");
-      NODELET_ERROR("insufficient data rate <%s>: %lf < %lf", hw_id_.c_str(),
+      RCLCPP_ERROR(get_logger(), "insufficient data rate <%s>: %lf < %lf", hw_id_.c_str(),
                     measured_rate, expected_rate_);
     } else if (measured_rate < 0.95 * expected_rate_) {
       status.summary(diagnostic_msgs::DiagnosticStatus::WARN,
                      "Insufficient Data Rate");
-      NODELET_WARN("insufficient data rate <%s>: %lf < %lf", hw_id_.c_str(),
+      RCLCPP_WARN(get_logger(), "insufficient data rate <%s>: %lf < %lf", hw_id_.c_str(),
                    measured_rate, expected_rate_);
     }
 
     status.add("Measurement Rate (Hz)", measured_rate);
-
-    measurement_count_ = 0;
   }
 
   void RateDiagnostic(diagnostic_updater::DiagnosticStatusWrapper &status) {
     status.summary(diagnostic_msgs::DiagnosticStatus::OK,
                    "Nominal Publish Rate");
 
-    double elapsed = (ros::Time::now() - last_published_).toSec();
+    double elapsed = ros::Time::now().toSec() - last_published_;
+    int32_t warnings = publish_rate_warnings_.exchange(0);
     bool gap_detected = false;
     if (elapsed > 2.0 / expected_rate_) {
-      publish_rate_warnings_++;
+      warnings++;
       gap_detected = true;
     }
 
-    if (publish_rate_warnings_ > 1 || gap_detected) {
+    if (warnings > 1 || gap_detected) {
       status.summary(diagnostic_msgs::DiagnosticStatus::WARN,
                      "Insufficient Publish Rate");
-      NODELET_WARN("publish rate failures detected <%s>: %d", hw_id_.c_str(),
-                   publish_rate_warnings_);
+      RCLCPP_WARN(get_logger(), "publish rate failures detected <%s>: %d", hw_id_.c_str(),
+                   warnings);
+    }
+
+    status.add("Warnings", warnings);
+  }
+};
+
+// Runs several receivers in one process. Every name in "devices" becomes a
+// BynavGpsNode in <namespace>/<name>, configured from the "<name>.*"
+// parameters. One thread waits on all of their ports at once and a small
+// worker pool reads and parses whichever devices are ready, so an idle
+// receiver costs nothing and busy ones share the cores. Connecting and
+// configuring block, so they run on a separate pool, and the bulk lane of
+// every device is parsed on one shared pool.
+class BynavGpsHost : public rclcpp::Node {
+public:
+  explicit BynavGpsHost(const rclcpp::NodeOptions &options)
+      : rclcpp::Node(
+            "bynav_gps_host",
+            rclcpp::NodeOptions(options)
+                .allow_undeclared_parameters(true)
+                .automatically_declare_parameters_from_overrides(true)),
+        worker_threads_(2), setup_threads_(1), bulk_parse_threads_(1),
+        serial_poll_ms_(10), running_(true),
+        wake_fd_(::eventfd(0, EFD_NONBLOCK)) {
+    std::vector<std::string> names;
+    get_parameter_or("devices", names, std::vector<std::string>());
+    get_parameter_or("worker_threads", worker_threads_, worker_threads_);
+    get_parameter_or("setup_threads", setup_threads_, setup_threads_);
+    get_parameter_or("bulk_parse_threads", bulk_parse_threads_,
+                     bulk_parse_threads_);
+    get_parameter_or("serial_poll_ms", serial_poll_ms_, serial_poll_ms_);
+    serial_poll_ms_ = std::max(serial_poll_ms_, 1);
+
+    executor_ = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+    for (const auto &name : names) {
+      AddDevice(name);
+    }
+    if (devices_.empty()) {
+      RCLCPP_ERROR(get_logger(), "No devices to host; list them in the devices parameter.");
+      return;
+    }
+
+    work_.reset(new boost::asio::io_service::work(workers_));
+    for (int32_t i = 0; i < std::max(worker_threads_, 1); i++) {
+      worker_pool_.emplace_back([this]() { workers_.run(); });
+    }
+    setup_work_.reset(new boost::asio::io_service::work(setup_));
+    for (int32_t i = 0; i < std::max(setup_threads_, 1); i++) {
+      worker_pool_.emplace_back([this]() { setup_.run(); });
+    }
+    if (bulk_parse_threads_ > 0) {
+      bulk_work_.reset(new boost::asio::io_service::work(bulk_));
+      for (int32_t i = 0; i < bulk_parse_threads_; i++) {
+        worker_pool_.emplace_back([this]() { bulk_.run(); });
+      }
+    }
+    spin_thread_ = boost::thread([this]() { executor_->spin(); });
+    thread_ = boost::thread(&BynavGpsHost::Poll, this);
+    RCLCPP_INFO(get_logger(), "Hosting %zu devices on %d workers",
+                devices_.size(), std::max(worker_threads_, 1));
+  }
+
+  ~BynavGpsHost() override {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    // Lets the workers finish the steps and bulk jobs already queued and
+    // exit.
+    work_.reset();
+    setup_work_.reset();
+    bulk_work_.reset();
+    for (auto &worker : worker_pool_) {
+      worker.join();
+    }
+    for (auto &device : devices_) {
+      device->node->Shutdown();
+    }
+    executor_->cancel();
+    if (spin_thread_.joinable()) {
+      spin_thread_.join();
+    }
+    if (wake_fd_ >= 0) {
+      ::close(wake_fd_);
+    }
+  }
+
+private:
+  // Devices that have been quiet this long are stepped anyway, so link
+  // timeouts and diagnostics still come around.
+  static constexpr int64_t IDLE_STEP_NS = 100000000;
+
+  struct Device {
+    std::string name;
+    std::shared_ptr<BynavGpsNode> node;
+    // Set while a worker is stepping the device; it isn't waited on or
+    // stepped again until then.
+    std::atomic<bool> busy;
+    int64_t last_step_ns;
+  };
+
+  void AddDevice(const std::string &name) {
+    if (name.empty() || name.find('/') != std::string::npos) {
+      RCLCPP_ERROR(get_logger(), "Invalid device name \"%s\"", name.c_str());
+      return;
+    }
+
+    std::vector<rclcpp::Parameter> overrides;
+    std::string prefix = name + ".";
+    for (const auto &parameter :
+         get_parameters(list_parameters({name}, 0).names)) {
+      overrides.emplace_back(parameter.get_name().substr(prefix.size()),
+                             parameter.get_parameter_value());
+    }
+
+    std::string name_space = get_namespace();
+    if (name_space.empty() || name_space.back() != '/') {
+      name_space += '/';
     }
+    name_space += name;
+
+    auto device = std::make_shared<Device>();
+    device->name = name;
+    device->busy = false;
+    device->last_step_ns = 0;
+    device->node = std::make_shared<BynavGpsNode>(
+        name_space,
+        rclcpp::NodeOptions()
+            .use_global_arguments(false)
+            .use_intra_process_comms(
+                get_node_options().use_intra_process_comms())
+            .parameter_overrides(overrides),
+        true);
+    if (!device->node->Prepare()) {
+      RCLCPP_ERROR(get_logger(), "Not hosting %s", name.c_str());
+      return;
+    }
+    if (bulk_parse_threads_ > 0) {
+      device->node->SetBulkService(&bulk_);
+    }
+
+    executor_->add_node(device->node);
+    devices_.push_back(device);
+    RCLCPP_INFO(get_logger(), "Hosting %s in %s", name.c_str(),
+                name_space.c_str());
+  }
+
+  void Poll() {
+    std::vector<pollfd> fds;
+    std::vector<std::shared_ptr<Device>> waiting;
+    while (rclcpp::ok() && running_) {
+      int64_t now_ns = PipelineNowNs();
+      int timeout_ms = static_cast<int>(IDLE_STEP_NS / 1000000);
+
+      fds.clear();
+      waiting.clear();
+      fds.push_back(pollfd{wake_fd_, POLLIN, 0});
+      waiting.push_back(nullptr);
+      for (auto &device : devices_) {
+        if (device->busy) {
+          continue;
+        }
+        int fd = device->node->NativeHandle();
+        int64_t since_ns = now_ns - device->last_step_ns;
+        if (fd < 0) {
+          // Devices that aren't streaming yet are stepped on a timer
+          // instead.
+          if (since_ns >= serial_poll_ms_ * 1000000ll) {
+            Dispatch(device, now_ns);
+          } else {
+            timeout_ms = std::min(
+                timeout_ms,
+                static_cast<int>(serial_poll_ms_ - since_ns / 1000000));
+          }
+        } else if (since_ns >= IDLE_STEP_NS) {
+          Dispatch(device, now_ns);
+        } else {
+          fds.push_back(pollfd{fd, POLLIN, 0});
+          waiting.push_back(device);
+        }
+      }
 
-    status.add("Warnings", publish_rate_warnings_);
+      if (::poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+        continue;
+      }
+      if (fds[0].revents & POLLIN) {
+        uint64_t count;
+        if (::read(wake_fd_, &count, sizeof(count)) < 0) {
+          count = 0;
+        }
+      }
+      now_ns = PipelineNowNs();
+      for (size_t i = 1; i < fds.size(); i++) {
+        if (fds[i].revents != 0) {
+          Dispatch(waiting[i], now_ns);
+        }
+      }
+    }
+  }
 
-    publish_rate_warnings_ = 0;
+  void Dispatch(const std::shared_ptr<Device> &device, int64_t now_ns) {
+    device->busy = true;
+    device->last_step_ns = now_ns;
+    // Connecting and configuring may block for seconds; keep them off the
+    // workers that read the streaming devices.
+    boost::asio::io_service &pool =
+        device->node->Streaming() ? workers_ : setup_;
+    pool.post([this, device]() {
+      device->node->Step();
+      device->busy = false;
+      // Wakes up Poll() so it waits on the device again.
+      uint64_t one = 1;
+      if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+        RCLCPP_DEBUG(get_logger(), "Unable to wake the host: %s",
+                     strerror(errno));
+      }
+    });
   }
+
+  int32_t worker_threads_;
+  int32_t setup_threads_;
+  int32_t bulk_parse_threads_;
+  int32_t serial_poll_ms_;
+  std::atomic<bool> running_;
+  int wake_fd_;
+
+  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> executor_;
+  std::vector<std::shared_ptr<Device>> devices_;
+
+  boost::asio::io_service workers_;
+  std::unique_ptr<boost::asio::io_service::work> work_;
+  boost::asio::io_service setup_;
+  std::unique_ptr<boost::asio::io_service::work> setup_work_;
+  boost::asio::io_service bulk_;
+  std::unique_ptr<boost::asio::io_service::work> bulk_work_;
+  std::vector<boost::thread> worker_pool_;
+  boost::thread spin_thread_;
+  boost::thread thread_;
 };
 } // namespace bynav_gps_driver
 
-// Register nodelet plugin
-#include <swri_nodelet/class_list_macros.h>
-SWRI_NODELET_EXPORT_CLASS(bynav_gps_driver, BynavGpsNode)
+#include <rclcpp_components/register_node_macro.hpp>
+RCLCPP_COMPONENTS_REGISTER_NODE(bynav_gps_driver::BynavGpsNode)
+RCLCPP_COMPONENTS_REGISTER_NODE(bynav_gps_driver::BynavGpsHost)
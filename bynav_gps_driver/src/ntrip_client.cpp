@@ -0,0 +1,420 @@
+#include <bynav_gps_driver/ntrip_client.h>
+
+#include <chrono>
+#include <sstream>
+
+#include <boost/bind.hpp>
+
+#include <rclcpp/rclcpp.hpp>
+
+namespace bynav_gps_driver {
+
+NtripClient::NtripClient()
+    : socket_(io_service_), gga_timer_(io_service_),
+      reconnect_timer_(io_service_), chunked_(false), chunk_remaining_(0),
+      gga_write_pending_(false), running_(false), streaming_(false),
+      bytes_received_(0),
+      frames_injected_(0), inject_failures_(0), frames_filtered_(0) {
+  framer_.RegisterBufferCallback(
+      [this](uint8_t *buf, size_t size, uint16_t id, uint32_t crc) {
+        OnFrame(buf, size, id);
+      });
+}
+
+NtripClient::~NtripClient() { Stop(); }
+
+void NtripClient::SetSink(CorrectionSink sink) { sink_ = std::move(sink); }
+
+void NtripClient::AllowMessageType(uint16_t type, double min_interval_s) {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  filter_.AllowMessageType(type, min_interval_s);
+}
+
+std::string NtripClient::BandwidthReport() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return filter_.BandwidthReport();
+}
+
+bool NtripClient::Start(const Config &config) {
+  Stop();
+
+  if (config.host.empty() || config.mountpoint.empty()) {
+    error_msg_ = "NTRIP caster host and mountpoint are required.";
+    return false;
+  }
+
+  config_ = config;
+  request_ = BuildRequest(config_);
+
+  io_service_.reset();
+  running_ = true;
+  work_.reset(new boost::asio::io_service::work(io_service_));
+  io_service_.post(boost::bind(&NtripClient::Connect, this));
+  io_service_.post(boost::bind(&NtripClient::StartGgaTimer, this));
+  thread_ = boost::thread([this]() { io_service_.run(); });
+
+  ROS_INFO("Starting NTRIP client for %s:%u/%s", config_.host.c_str(),
+           config_.port, config_.mountpoint.c_str());
+  return true;
+}
+
+void NtripClient::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+
+  // Abort everything from the I/O thread and let run() drain the aborted
+  // handlers instead of stopping it, so nothing stale is left queued for
+  // the next Start().
+  running_ = false;
+  io_service_.post([this]() {
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    gga_timer_.cancel(ignored);
+    reconnect_timer_.cancel(ignored);
+  });
+  work_.reset();
+  thread_.join();
+  io_service_.reset();
+  streaming_ = false;
+}
+
+void NtripClient::SetGgaSentence(const std::string &gga) {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  gga_sentence_ = gga;
+}
+
+std::string NtripClient::ErrorMsg() const {
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  return error_msg_;
+}
+
+std::string NtripClient::BuildRequest(const Config &config) {
+  std::stringstream request;
+  request << "GET /" << config.mountpoint << " HTTP/1.1\r\n";
+  request << "Host: " << config.host << ":" << config.port << "\r\n";
+  request << "User-Agent: NTRIP bynav_gps_driver\r\n";
+  if (config.version == 2) {
+    request << "Ntrip-Version: Ntrip/2.0\r\n";
+  }
+  if (!config.username.empty()) {
+    request << "Authorization: Basic "
+            << Base64Encode(config.username + ":" + config.password) << "\r\n";
+  }
+  request << "Connection: close\r\n";
+  request << "\r\n";
+  return request.str();
+}
+
+std::string NtripClient::Base64Encode(const std::string &input) {
+  static const char TABLE[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  std::string output;
+  output.reserve(((input.size() + 2) / 3) * 4);
+
+  size_t i = 0;
+  for (; i + 2 < input.size(); i += 3) {
+    uint32_t n = (static_cast<uint8_t>(input[i]) << 16) |
+                 (static_cast<uint8_t>(input[i + 1]) << 8) |
+                 static_cast<uint8_t>(input[i + 2]);
+    output.push_back(TABLE[(n >> 18) & 0x3F]);
+    output.push_back(TABLE[(n >> 12) & 0x3F]);
+    output.push_back(TABLE[(n >> 6) & 0x3F]);
+    output.push_back(TABLE[n & 0x3F]);
+  }
+
+  if (i < input.size()) {
+    uint32_t n = static_cast<uint8_t>(input[i]) << 16;
+    if (i + 1 < input.size()) {
+      n |= static_cast<uint8_t>(input[i + 1]) << 8;
+    }
+    output.push_back(TABLE[(n >> 18) & 0x3F]);
+    output.push_back(TABLE[(n >> 12) & 0x3F]);
+    output.push_back(i + 1 < input.size() ? TABLE[(n >> 6) & 0x3F] : '=');
+    output.push_back('=');
+  }
+
+  return output;
+}
+
+void NtripClient::Connect() {
+  if (!running_) {
+    return;
+  }
+
+  boost::system::error_code error;
+  boost::asio::ip::tcp::resolver resolver(io_service_);
+  boost::asio::ip::tcp::resolver::query query(config_.host,
+                                              std::to_string(config_.port));
+  boost::asio::ip::tcp::resolver::iterator iter =
+      resolver.resolve(query, error);
+  if (error) {
+    Fail("Unable to resolve NTRIP caster: " + error.message());
+    return;
+  }
+
+  chunked_ = false;
+  chunk_remaining_ = 0;
+  chunk_line_.clear();
+  response_.consume(response_.size());
+
+  boost::asio::async_connect(
+      socket_, iter,
+      [this](const boost::system::error_code &error,
+             boost::asio::ip::tcp::resolver::iterator) { OnConnect(error); });
+}
+
+void NtripClient::OnConnect(const boost::system::error_code &error) {
+  if (error == boost::asio::error::operation_aborted) {
+    return;
+  } else if (error) {
+    Fail("Unable to connect to NTRIP caster: " + error.message());
+    return;
+  }
+
+  boost::asio::ip::tcp::no_delay option(true);
+  boost::system::error_code ignored;
+  socket_.set_option(option, ignored);
+
+  boost::asio::async_write(
+      socket_, boost::asio::buffer(request_),
+      [this](const boost::system::error_code &error, size_t) {
+        if (error == boost::asio::error::operation_aborted) {
+          return;
+        } else if (error) {
+          Fail("Unable to send NTRIP request: " + error.message());
+          return;
+        }
+        boost::asio::async_read_until(
+            socket_, response_, "\r\n",
+            boost::bind(&NtripClient::OnResponse, this,
+                        boost::asio::placeholders::error,
+                        boost::asio::placeholders::bytes_transferred));
+      });
+}
+
+void NtripClient::OnResponse(const boost::system::error_code &error,
+                             size_t bytes) {
+  if (error == boost::asio::error::operation_aborted) {
+    return;
+  } else if (error) {
+    Fail("No response from NTRIP caster: " + error.message());
+    return;
+  }
+
+  std::string status(boost::asio::buffers_begin(response_.data()),
+                     boost::asio::buffers_begin(response_.data()) + bytes);
+
+  if (status.find(" 200") == std::string::npos) {
+    Fail("NTRIP caster rejected request: " +
+         status.substr(0, status.find('\r')));
+    return;
+  }
+
+  if (status.compare(0, 5, "HTTP/") == 0) {
+    // NTRIP v2 (or a v1 caster answering in HTTP); the stream only starts
+    // after the header block.
+    boost::asio::async_read_until(
+        socket_, response_, "\r\n\r\n",
+        [this](const boost::system::error_code &error, size_t bytes) {
+          if (error == boost::asio::error::operation_aborted) {
+            return;
+          } else if (error) {
+            Fail("Incomplete NTRIP response: " + error.message());
+            return;
+          }
+          std::string headers(
+              boost::asio::buffers_begin(response_.data()),
+              boost::asio::buffers_begin(response_.data()) + bytes);
+          for (auto &c : headers) {
+            c = static_cast<char>(std::tolower(c));
+          }
+          chunked_ = headers.find("transfer-encoding: chunked") !=
+                     std::string::npos;
+          response_.consume(bytes);
+          OnStreamStart();
+        });
+    return;
+  }
+
+  response_.consume(bytes);
+  OnStreamStart();
+}
+
+void NtripClient::OnStreamStart() {
+  ROS_INFO("NTRIP stream established from %s:%u/%s", config_.host.c_str(),
+           config_.port, config_.mountpoint.c_str());
+  streaming_ = true;
+
+  // Whatever arrived with the header is already stream data.
+  if (response_.size() > 0) {
+    std::vector<uint8_t> leftover(boost::asio::buffers_begin(response_.data()),
+                                  boost::asio::buffers_end(response_.data()));
+    response_.consume(response_.size());
+    Feed(leftover.data(), leftover.size());
+  }
+
+  StartRead();
+}
+
+void NtripClient::StartRead() {
+  socket_.async_read_some(
+      boost::asio::buffer(read_buffer_),
+      boost::bind(&NtripClient::OnRead, this, boost::asio::placeholders::error,
+                  boost::asio::placeholders::bytes_transferred));
+}
+
+void NtripClient::OnRead(const boost::system::error_code &error,
+                         size_t bytes) {
+  if (error == boost::asio::error::operation_aborted) {
+    return;
+  } else if (error) {
+    Fail("NTRIP stream interrupted: " + error.message());
+    return;
+  }
+
+  Feed(read_buffer_.data(), bytes);
+  if (streaming_) {
+    StartRead();
+  }
+}
+
+void NtripClient::Feed(const uint8_t *data, size_t size) {
+  bytes_received_ += size;
+  if (chunked_) {
+    FeedChunked(data, size);
+    return;
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    framer_.ReadCB(data[i]);
+  }
+}
+
+void NtripClient::FeedChunked(const uint8_t *data, size_t size) {
+  size_t i = 0;
+  while (i < size) {
+    if (chunk_remaining_ > 0) {
+      size_t n = std::min(chunk_remaining_, size - i);
+      for (size_t j = 0; j < n; j++) {
+        framer_.ReadCB(data[i + j]);
+      }
+      chunk_remaining_ -= n;
+      i += n;
+      continue;
+    }
+
+    char c = static_cast<char>(data[i++]);
+    if (c != '\n') {
+      if (c != '\r') {
+        chunk_line_.push_back(c);
+      }
+      if (chunk_line_.size() > 64) {
+        Fail("Invalid chunk header in NTRIP stream.");
+        return;
+      }
+      continue;
+    }
+
+    // Empty lines are the CRLF that terminates the previous chunk.
+    if (chunk_line_.empty()) {
+      continue;
+    }
+
+    chunk_remaining_ = std::strtoul(chunk_line_.c_str(), nullptr, 16);
+    chunk_line_.clear();
+    if (chunk_remaining_ == 0) {
+      Fail("NTRIP caster ended the stream.");
+      return;
+    }
+  }
+}
+
+void NtripClient::OnFrame(uint8_t *buf, size_t size, uint16_t id) {
+  if (!sink_) {
+    return;
+  }
+
+  double now = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count();
+  {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (!filter_.Pass(id, size, now)) {
+      frames_filtered_++;
+      return;
+    }
+  }
+
+  if (sink_(buf, size)) {
+    frames_injected_++;
+  } else {
+    inject_failures_++;
+    ROS_WARN_THROTTLE(1.0, "Failed to inject RTCM correction frame.");
+  }
+}
+
+void NtripClient::StartGgaTimer() {
+  if (!running_ || config_.gga_interval_s <= 0.0) {
+    return;
+  }
+
+  gga_timer_.expires_from_now(boost::posix_time::milliseconds(
+      static_cast<int64_t>(config_.gga_interval_s * 1000.0)));
+  gga_timer_.async_wait(boost::bind(&NtripClient::OnGgaTimer, this,
+                                    boost::asio::placeholders::error));
+}
+
+void NtripClient::OnGgaTimer(const boost::system::error_code &error) {
+  if (error == boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  if (streaming_ && !gga_write_pending_) {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      gga_write_ = gga_sentence_;
+    }
+    if (!gga_write_.empty()) {
+      gga_write_ += "\r\n";
+      gga_write_pending_ = true;
+      boost::asio::async_write(
+          socket_, boost::asio::buffer(gga_write_),
+          [this](const boost::system::error_code &error, size_t) {
+            gga_write_pending_ = false;
+            if (error && error != boost::asio::error::operation_aborted) {
+              ROS_WARN("Failed to send GGA to NTRIP caster: %s",
+                       error.message().c_str());
+            }
+          });
+    }
+  }
+
+  StartGgaTimer();
+}
+
+void NtripClient::Fail(const std::string &msg) {
+  ROS_WARN_THROTTLE(1.0, "%s", msg.c_str());
+  {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    error_msg_ = msg;
+  }
+
+  streaming_ = false;
+  boost::system::error_code ignored;
+  socket_.close(ignored);
+  if (!running_) {
+    return;
+  }
+
+  reconnect_timer_.expires_from_now(boost::posix_time::milliseconds(
+      static_cast<int64_t>(config_.reconnect_delay_s * 1000.0)));
+  reconnect_timer_.async_wait([this](const boost::system::error_code &error) {
+    if (error != boost::asio::error::operation_aborted) {
+      Connect();
+    }
+  });
+}
+
+} // namespace bynav_gps_driver
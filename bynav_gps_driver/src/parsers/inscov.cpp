@@ -0,0 +1,71 @@
+#include <boost/make_shared.hpp>
+#include <bynav_gps_driver/parsers/header.h>
+#include <bynav_gps_driver/parsers/inscov.h>
+
+const std::string bynav_gps_driver::InscovParser::MESSAGE_NAME = "INSCOV";
+
+uint32_t bynav_gps_driver::InscovParser::GetMessageId() const {
+  return MESSAGE_ID;
+}
+
+const std::string bynav_gps_driver::InscovParser::GetMessageName() const {
+  return MESSAGE_NAME;
+}
+
+bynav_gps_msgs::InsCovPtr bynav_gps_driver::InscovParser::ParseBinary(
+    const bynav_gps_driver::BinaryMessage &bin_msg) {
+  if (bin_msg.data_.size() != BINARY_LENGTH) {
+    std::stringstream error;
+    error << "Unexpected INSCOV message size: " << bin_msg.data_.size();
+    throw ParseException(error.str());
+  }
+
+  bynav_gps_msgs::InsCovPtr ros_msg =
+      boost::make_shared<bynav_gps_msgs::InsCov>();
+
+  HeaderParser h_parser;
+  ros_msg->bynav_msg_header = h_parser.ParseBinary(bin_msg);
+  ros_msg->bynav_msg_header.message_name = GetMessageName();
+
+  ros_msg->week = ParseUInt32(&bin_msg.data_[0]);
+  ros_msg->seconds = ParseDouble(&bin_msg.data_[4]);
+  for (size_t i = 0; i < 9; i++) {
+    ros_msg->position_covariance[i] = ParseDouble(&bin_msg.data_[12 + i * 8]);
+    ros_msg->attitude_covariance[i] = ParseDouble(&bin_msg.data_[84 + i * 8]);
+    ros_msg->velocity_covariance[i] =
+        ParseDouble(&bin_msg.data_[156 + i * 8]);
+  }
+
+  return ros_msg;
+}
+
+bynav_gps_msgs::InsCovPtr bynav_gps_driver::InscovParser::ParseAscii(
+    const bynav_gps_driver::BynavSentence &sentence) {
+  if (sentence.body.size() != ASCII_FIELDS) {
+    std::stringstream error;
+    error << "Unexpected number of fields in INSCOV log: "
+          << sentence.body.size();
+    throw ParseException(error.str());
+  }
+
+  bynav_gps_msgs::InsCovPtr msg = boost::make_shared<bynav_gps_msgs::InsCov>();
+
+  HeaderParser h_parser;
+  msg->bynav_msg_header = h_parser.ParseAscii(sentence);
+
+  bool valid = true;
+
+  valid &= ParseUInt32(sentence.body[0], msg->week);
+  valid &= ParseDouble(sentence.body[1], msg->seconds);
+  for (size_t i = 0; i < 9; i++) {
+    valid &= ParseDouble(sentence.body[2 + i], msg->position_covariance[i]);
+    valid &= ParseDouble(sentence.body[11 + i], msg->attitude_covariance[i]);
+    valid &= ParseDouble(sentence.body[20 + i], msg->velocity_covariance[i]);
+  }
+
+  if (!valid) {
+    throw ParseException("Error parsing INSCOV log.");
+  }
+
+  return msg;
+}
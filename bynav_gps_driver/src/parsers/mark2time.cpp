@@ -17,7 +17,7 @@ bynav_gps_msgs::MarkTimePtr bynav_gps_driver::Mark2TimeParser::ParseBinary(
     const bynav_gps_driver::BinaryMessage &bin_msg) {
   if (bin_msg.data_.size() != BINARY_LENGTH) {
     std::stringstream error;
-    error << "Unexpected inspva message size: " << bin_msg.data_.size();
+    error << "Unexpected MARK2TIME message size: " << bin_msg.data_.size();
     throw ParseException(error.str());
   }
   
@@ -51,7 +51,7 @@ bynav_gps_msgs::MarkTimePtr bynav_gps_driver::Mark2TimeParser::ParseBinary(
     break;
   default: {
     std::stringstream error;
-    error << "Unexpected inertial solution status: " << status;
+    error << "Unexpected clock model status: " << status;
     throw ParseException(error.str());
   }
   }
@@ -60,7 +60,7 @@ bynav_gps_msgs::MarkTimePtr bynav_gps_driver::Mark2TimeParser::ParseBinary(
 
 bynav_gps_msgs::MarkTimePtr bynav_gps_driver::Mark2TimeParser::ParseAscii(
     const bynav_gps_driver::BynavSentence &sentence) {
-  const size_t EXPECTED_LEN = 3;
+  const size_t EXPECTED_LEN = 6;
 
   if (sentence.body.size() != EXPECTED_LEN) {
     std::stringstream error;
@@ -86,7 +86,7 @@ bynav_gps_msgs::MarkTimePtr bynav_gps_driver::Mark2TimeParser::ParseAscii(
   msg->status = sentence.body[5];
 
   if (!valid) {
-    throw ParseException("Error parsing heading as double in MARK2TIME");
+    throw ParseException("Error parsing MARK2TIME");
   }
 
   return msg;
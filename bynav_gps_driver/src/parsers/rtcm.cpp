@@ -87,7 +87,7 @@ bool Rtcm::ReadCB(uint8_t byte) {
     in_buffer_.buf[buffer_head_++] = byte;
     payload_len_ = ((prev_byte_ & 0x3) << 8) | byte;
     parse_state_ = GOT_LENGTH2;
-    if (payload_len_ > BUFFER_SIZE || payload_len_ == 0) {
+    if (payload_len_ + 6 > BUFFER_SIZE || payload_len_ == 0) {
       num_errors_++;
       parse_state_ = START;
       prev_byte_ = byte;
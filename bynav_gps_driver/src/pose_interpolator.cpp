@@ -0,0 +1,81 @@
+#include <bynav_gps_driver/pose_interpolator.h>
+
+#include <cmath>
+
+namespace bynav_gps_driver {
+
+namespace {
+
+double Lerp(double a, double b, double t) { return a + (b - a) * t; }
+
+// Degrees.
+double LerpAngle(double a, double b, double t) {
+  double delta = std::remainder(b - a, 360.0);
+  return std::remainder(a + delta * t, 360.0);
+}
+
+} // namespace
+
+constexpr size_t PoseInterpolator::CAPACITY;
+
+PoseInterpolator::PoseInterpolator(double max_gap_s) : max_gap_s_(max_gap_s) {}
+
+PoseInterpolator::Pose PoseInterpolator::Interpolate(const Pose &a,
+                                                     const Pose &b,
+                                                     double t) {
+  Pose pose;
+  pose.latitude = Lerp(a.latitude, b.latitude, t);
+  pose.longitude = LerpAngle(a.longitude, b.longitude, t);
+  pose.height = Lerp(a.height, b.height, t);
+  pose.north_velocity = Lerp(a.north_velocity, b.north_velocity, t);
+  pose.east_velocity = Lerp(a.east_velocity, b.east_velocity, t);
+  pose.up_velocity = Lerp(a.up_velocity, b.up_velocity, t);
+  pose.roll = LerpAngle(a.roll, b.roll, t);
+  pose.pitch = Lerp(a.pitch, b.pitch, t);
+  pose.azimuth = LerpAngle(a.azimuth, b.azimuth, t);
+  if (pose.azimuth < 0.0) {
+    pose.azimuth += 360.0;
+  }
+  return pose;
+}
+
+void PoseInterpolator::Add(double gps_time, const Pose &pose) {
+  if (!epochs_.Empty() && gps_time <= epochs_.BackTime()) {
+    return;
+  }
+  if (epochs_.Full()) {
+    epochs_.Pop();
+  }
+  epochs_.Push(gps_time, pose);
+}
+
+PoseInterpolator::Result PoseInterpolator::Lookup(double gps_time,
+                                                  Pose &pose) const {
+  if (epochs_.Empty() || gps_time > epochs_.BackTime()) {
+    return PENDING;
+  }
+  if (gps_time < epochs_.FrontTime()) {
+    return UNAVAILABLE;
+  }
+
+  // Events are usually close to the newest epochs, so search backwards.
+  size_t i = epochs_.Size() - 1;
+  while (i > 0 && epochs_.TimeAt(i - 1) >= gps_time) {
+    i--;
+  }
+  if (i == 0 || epochs_.TimeAt(i) == gps_time) {
+    pose = epochs_.At(i);
+    return INTERPOLATED;
+  }
+
+  double t0 = epochs_.TimeAt(i - 1);
+  double t1 = epochs_.TimeAt(i);
+  if (t1 - t0 > max_gap_s_) {
+    return UNAVAILABLE;
+  }
+  pose = Interpolate(epochs_.At(i - 1), epochs_.At(i),
+                     (gps_time - t0) / (t1 - t0));
+  return INTERPOLATED;
+}
+
+} // namespace bynav_gps_driver
@@ -0,0 +1,163 @@
+#include <bynav_gps_driver/receiver_config.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace bynav_gps_driver {
+
+namespace {
+
+// How many arguments after the command select the setting it changes.
+size_t KeyArguments(const std::string &name) {
+  static const std::map<std::string, size_t> KEY_ARGUMENTS = {
+      {"INTERFACEMODE", 1}, {"SERIALCONFIG", 1}, {"ICOMCONFIG", 1},
+      {"NTRIPCONFIG", 1},   {"IPCONFIG", 1},     {"DNSCONFIG", 1},
+      {"SET", 1}};
+  auto iter = KEY_ARGUMENTS.find(name);
+  return iter != KEY_ARGUMENTS.end() ? iter->second : 0;
+}
+
+bool ParseNumber(const std::string &token, double &value) {
+  if (token.empty()) {
+    return false;
+  }
+  char *end = nullptr;
+  value = std::strtod(token.c_str(), &end);
+  return end == token.c_str() + token.size();
+}
+
+bool SameArgument(const std::string &a, const std::string &b) {
+  if (a == b) {
+    return true;
+  }
+  double x;
+  double y;
+  if (ParseNumber(a, x) && ParseNumber(b, y)) {
+    return std::fabs(x - y) <= 1e-6 * std::max(1.0, std::fabs(x));
+  }
+  return false;
+}
+
+} // namespace
+
+std::vector<std::string> ReceiverConfig::Tokenize(const std::string &command) {
+  std::vector<std::string> tokens;
+  std::string token;
+  for (char c : command) {
+    if (c == ' ' || c == ',' || c == '\t' || c == '\r' || c == '\n') {
+      if (!token.empty()) {
+        tokens.push_back(token);
+        token.clear();
+      }
+    } else if (c != '[' && c != ']') {
+      token.push_back(static_cast<char>(std::toupper(c)));
+    }
+  }
+  if (!token.empty()) {
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+std::string ReceiverConfig::Key(const std::string &command) {
+  std::vector<std::string> tokens = Tokenize(command);
+  if (tokens.empty()) {
+    return "";
+  }
+
+  // Every authorization code is its own entry.
+  size_t args =
+      tokens[0] == "AUTH" ? tokens.size() - 1 : KeyArguments(tokens[0]);
+  std::string key = tokens[0];
+  for (size_t i = 1; i <= args && i < tokens.size(); i++) {
+    key += " " + tokens[i];
+  }
+  return key;
+}
+
+void ReceiverConfig::Set(const std::string &command) {
+  std::string key = Key(command);
+  if (!key.empty()) {
+    commands_[key] = command;
+  }
+}
+
+std::string ReceiverConfig::Get(const std::string &key) const {
+  auto iter = commands_.find(key);
+  return iter != commands_.end() ? iter->second : "";
+}
+
+bool ReceiverConfig::Covers(const std::string &command) const {
+  auto iter = commands_.find(Key(command));
+  if (iter == commands_.end()) {
+    return false;
+  }
+
+  std::vector<std::string> wanted = Tokenize(command);
+  std::vector<std::string> known = Tokenize(iter->second);
+  if (known.size() < wanted.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < wanted.size(); i++) {
+    if (!SameArgument(wanted[i], known[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<std::string>
+ReceiverConfig::Diff(const std::vector<std::string> &commands) const {
+  std::vector<std::string> changes;
+  for (const auto &command : commands) {
+    if (!Covers(command)) {
+      changes.push_back(command);
+    }
+  }
+  return changes;
+}
+
+size_t ReceiverConfig::LoadRxConfig(const std::string &rxconfig) {
+  size_t loaded = 0;
+  std::istringstream lines(rxconfig);
+  std::string line;
+  while (std::getline(lines, line)) {
+    size_t start = line.find("#RXCONFIG");
+    if (start == std::string::npos) {
+      continue;
+    }
+
+    // The embedded header names the command, its body holds the arguments.
+    size_t embedded = line.find(";#", start);
+    if (embedded == std::string::npos) {
+      continue;
+    }
+    size_t name_end = line.find(',', embedded);
+    size_t body = line.find(';', embedded + 2);
+    if (name_end == std::string::npos || body == std::string::npos) {
+      continue;
+    }
+
+    std::string name = line.substr(embedded + 2, name_end - embedded - 2);
+    if (!name.empty() && name.back() == 'A') {
+      name.pop_back();
+    }
+    if (name == "LOG" || name == "UNLOG") {
+      continue;
+    }
+
+    size_t body_end = line.find('*', body);
+    std::string args = line.substr(body + 1, body_end == std::string::npos
+                                                 ? std::string::npos
+                                                 : body_end - body - 1);
+    std::replace(args.begin(), args.end(), ',', ' ');
+    Set(name + " " + args);
+    loaded++;
+  }
+  return loaded;
+}
+
+} // namespace bynav_gps_driver
@@ -0,0 +1,35 @@
+#include <bynav_gps_driver/reconnect_backoff.h>
+
+#include <algorithm>
+
+namespace bynav_gps_driver {
+
+ReconnectBackoff::ReconnectBackoff(double initial_s, double max_s,
+                                   double jitter, uint32_t seed)
+    : rng_(seed) {
+  Configure(initial_s, max_s, jitter);
+}
+
+void ReconnectBackoff::Configure(double initial_s, double max_s,
+                                 double jitter) {
+  initial_s_ = std::max(initial_s, 0.0);
+  max_s_ = std::max(max_s, initial_s_);
+  jitter_ = std::min(std::max(jitter, 0.0), 1.0);
+  Reset();
+}
+
+double ReconnectBackoff::NextDelay() {
+  double delay = base_s_;
+  base_s_ = std::min(base_s_ * 2.0, max_s_);
+  attempts_++;
+
+  std::uniform_real_distribution<double> spread(1.0 - jitter_, 1.0 + jitter_);
+  return std::min(delay * spread(rng_), max_s_);
+}
+
+void ReconnectBackoff::Reset() {
+  base_s_ = initial_s_;
+  attempts_ = 0;
+}
+
+} // namespace bynav_gps_driver
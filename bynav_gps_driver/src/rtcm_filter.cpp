@@ -0,0 +1,77 @@
+#include <bynav_gps_driver/rtcm_filter.h>
+
+#include <cstdio>
+
+namespace bynav_gps_driver {
+
+RtcmFilter::RtcmFilter() {}
+
+void RtcmFilter::AllowMessageType(uint16_t type, double min_interval_s) {
+  allowed_[type] = min_interval_s;
+}
+
+void RtcmFilter::Clear() {
+  allowed_.clear();
+  stats_.clear();
+}
+
+bool RtcmFilter::Pass(uint16_t type, size_t size, double stamp) {
+  TypeStats &stats = stats_[type];
+  if (stats.first_stamp < 0.0) {
+    stats.first_stamp = stamp;
+  }
+  stats.last_stamp = stamp;
+
+  bool pass = true;
+  if (!allowed_.empty()) {
+    auto iter = allowed_.find(type);
+    if (iter == allowed_.end()) {
+      pass = false;
+    } else if (iter->second > 0.0 && stats.last_passed_stamp >= 0.0 &&
+               stamp - stats.last_passed_stamp < iter->second) {
+      pass = false;
+    }
+  }
+
+  if (pass) {
+    stats.frames_passed++;
+    stats.bytes_passed += size;
+    stats.last_passed_stamp = stamp;
+  } else {
+    stats.frames_dropped++;
+    stats.bytes_dropped += size;
+  }
+
+  return pass;
+}
+
+std::string RtcmFilter::BandwidthReport() const {
+  std::string report;
+  uint64_t total_passed = 0;
+  double total_rate = 0.0;
+
+  for (const auto &entry : stats_) {
+    const TypeStats &stats = entry.second;
+    double span = stats.last_stamp - stats.first_stamp;
+    double rate = span > 0.0 ? stats.bytes_passed / span : 0.0;
+    total_passed += stats.bytes_passed;
+    total_rate += rate;
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "RTCM%u: %lu/%lu frames passed, %lu bytes, %.1f B/s, "
+             "%lu bytes dropped\n",
+             entry.first, stats.frames_passed,
+             stats.frames_passed + stats.frames_dropped, stats.bytes_passed,
+             rate, stats.bytes_dropped);
+    report += line;
+  }
+
+  char line[96];
+  snprintf(line, sizeof(line), "Total: %lu bytes passed, %.1f B/s", total_passed,
+           total_rate);
+  report += line;
+  return report;
+}
+
+} // namespace bynav_gps_driver
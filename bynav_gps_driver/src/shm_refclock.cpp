@@ -0,0 +1,133 @@
+#include <bynav_gps_driver/shm_refclock.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace bynav_gps_driver {
+
+constexpr int32_t ShmRefclock::BASE_KEY;
+constexpr int32_t ShmRefclock::PRECISION;
+
+// Layout shared with ntpd, chrony and gpsd.
+struct ShmRefclock::ShmTime {
+  int mode;
+  volatile int count;
+  time_t clockTimeStampSec;
+  int clockTimeStampUSec;
+  time_t receiveTimeStampSec;
+  int receiveTimeStampUSec;
+  int leap;
+  int precision;
+  int nsamples;
+  volatile int valid;
+  unsigned clockTimeStampNSec;
+  unsigned receiveTimeStampNSec;
+  int dummy[8];
+};
+
+namespace {
+
+void SplitTime(double time, time_t &sec, int &usec, unsigned &nsec) {
+  double whole = std::floor(time);
+  int64_t ns = std::llround((time - whole) * 1e9);
+  if (ns >= 1000000000) {
+    whole += 1.0;
+    ns -= 1000000000;
+  }
+  sec = static_cast<time_t>(whole);
+  usec = static_cast<int>(ns / 1000);
+  nsec = static_cast<unsigned>(ns);
+}
+
+} // namespace
+
+ShmRefclock::ShmRefclock() : shm_(nullptr), unit_(-1), samples_(0) {}
+
+ShmRefclock::~ShmRefclock() { Close(); }
+
+bool ShmRefclock::Open(int32_t unit) {
+  Close();
+  if (unit < 0) {
+    error_msg_ = "Invalid SHM unit " + std::to_string(unit);
+    return false;
+  }
+
+  int perm = unit < 2 ? 0600 : 0666;
+  int id = shmget(BASE_KEY + unit, sizeof(ShmTime), IPC_CREAT | perm);
+  if (id < 0) {
+    error_msg_ = "shmget failed for SHM unit " + std::to_string(unit) + ": " +
+                 strerror(errno);
+    return false;
+  }
+  void *address = shmat(id, nullptr, 0);
+  if (address == reinterpret_cast<void *>(-1)) {
+    error_msg_ = "shmat failed for SHM unit " + std::to_string(unit) + ": " +
+                 strerror(errno);
+    return false;
+  }
+
+  shm_ = static_cast<ShmTime *>(address);
+  unit_ = unit;
+  samples_ = 0;
+  return true;
+}
+
+void ShmRefclock::Close() {
+  if (shm_ != nullptr) {
+    shmdt(shm_);
+    shm_ = nullptr;
+  }
+  unit_ = -1;
+}
+
+void ShmRefclock::Publish(double reference_time, double host_time) {
+  if (shm_ == nullptr) {
+    return;
+  }
+
+  // Mode 1: readers take count before and after copying the sample and
+  // throw it away if it changed.
+  shm_->mode = 1;
+  shm_->valid = 0;
+  shm_->count++;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  SplitTime(reference_time, shm_->clockTimeStampSec, shm_->clockTimeStampUSec,
+            shm_->clockTimeStampNSec);
+  SplitTime(host_time, shm_->receiveTimeStampSec, shm_->receiveTimeStampUSec,
+            shm_->receiveTimeStampNSec);
+  shm_->leap = 0;
+  shm_->precision = PRECISION;
+  shm_->nsamples = 0;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  shm_->count++;
+  shm_->valid = 1;
+  samples_++;
+}
+
+bool ShmRefclock::Read(double &reference_time, double &host_time) const {
+  if (shm_ == nullptr || !shm_->valid) {
+    return false;
+  }
+
+  int count = shm_->count;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  ShmTime sample = *shm_;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (count != shm_->count) {
+    return false;
+  }
+
+  reference_time = static_cast<double>(sample.clockTimeStampSec) +
+                   sample.clockTimeStampNSec * 1e-9;
+  host_time = static_cast<double>(sample.receiveTimeStampSec) +
+              sample.receiveTimeStampNSec * 1e-9;
+  return true;
+}
+
+} // namespace bynav_gps_driver
@@ -0,0 +1,161 @@
+#include <bynav_gps_driver/time_alignment.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace bynav_gps_driver {
+
+constexpr size_t TimeAlignment::QUEUE_SIZE;
+
+WindowedStats::WindowedStats(size_t window) { SetWindow(window); }
+
+void WindowedStats::SetWindow(size_t window) {
+  window_ = std::max<size_t>(window, 1);
+  Clear();
+}
+
+void WindowedStats::Add(double value) {
+  uint64_t index = added_++;
+  values_.push_back(value);
+  sum_ += value;
+  sum_squares_ += value * value;
+  if (values_.size() > window_) {
+    double oldest = values_.front();
+    values_.pop_front();
+    sum_ -= oldest;
+    sum_squares_ -= oldest * oldest;
+  }
+
+  while (!min_.empty() && min_.back().second >= value) {
+    min_.pop_back();
+  }
+  min_.emplace_back(index, value);
+  while (!max_.empty() && max_.back().second <= value) {
+    max_.pop_back();
+  }
+  max_.emplace_back(index, value);
+
+  uint64_t first = added_ - values_.size();
+  while (min_.front().first < first) {
+    min_.pop_front();
+  }
+  while (max_.front().first < first) {
+    max_.pop_front();
+  }
+
+  // Start the sums over once per window so rounding can't build up.
+  if (added_ % window_ == 0) {
+    sum_ = 0.0;
+    sum_squares_ = 0.0;
+    for (double v : values_) {
+      sum_ += v;
+      sum_squares_ += v * v;
+    }
+  }
+}
+
+void WindowedStats::Clear() {
+  added_ = 0;
+  values_.clear();
+  min_.clear();
+  max_.clear();
+  sum_ = 0.0;
+  sum_squares_ = 0.0;
+}
+
+double WindowedStats::Mean() const {
+  return values_.empty() ? 0.0 : sum_ / values_.size();
+}
+
+double WindowedStats::Variance() const {
+  if (values_.size() < 2) {
+    return 0.0;
+  }
+  double mean = Mean();
+  return std::max(sum_squares_ / values_.size() - mean * mean, 0.0);
+}
+
+double WindowedStats::Min() const {
+  return min_.empty() ? 0.0 : min_.front().second;
+}
+
+double WindowedStats::Max() const {
+  return max_.empty() ? 0.0 : max_.front().second;
+}
+
+TimeAlignment::TimeAlignment(size_t window, double tolerance_s)
+    : tolerance_s_(tolerance_s), references_in_(QUEUE_SIZE),
+      measurements_in_(QUEUE_SIZE), synced_(false), last_reference_(0.0),
+      stats_(window) {}
+
+void TimeAlignment::SetWindow(size_t window) {
+  stats_.SetWindow(window);
+  boost::unique_lock<boost::mutex> lock(summary_mutex_);
+  summary_ = Summary();
+  summary_.synced = synced_;
+  summary_.last_reference = last_reference_;
+}
+
+bool TimeAlignment::PushReference(double time) {
+  return references_in_.push(time);
+}
+
+bool TimeAlignment::PushMeasurement(double time) {
+  return measurements_in_.push(time);
+}
+
+size_t TimeAlignment::Align() {
+  Drain(references_in_, references_);
+  Drain(measurements_in_, measurements_);
+
+  // Both streams are in order, so whichever head is too far behind the
+  // other can't be paired with anything that arrives later either.
+  size_t pairs = 0;
+  while (!references_.empty() && !measurements_.empty()) {
+    double offset = references_.front() - measurements_.front();
+    if (std::fabs(offset) < tolerance_s_) {
+      stats_.Add(offset);
+      last_reference_ = references_.front();
+      synced_ = true;
+      references_.pop_front();
+      measurements_.pop_front();
+      pairs++;
+    } else if (offset > 0.0) {
+      measurements_.pop_front();
+    } else {
+      references_.pop_front();
+    }
+  }
+
+  // A stream whose partner never shows up shouldn't grow forever.
+  while (references_.size() > QUEUE_SIZE) {
+    references_.pop_front();
+  }
+  while (measurements_.size() > QUEUE_SIZE) {
+    measurements_.pop_front();
+  }
+
+  if (pairs > 0) {
+    boost::unique_lock<boost::mutex> lock(summary_mutex_);
+    summary_.synced = synced_;
+    summary_.last_reference = last_reference_;
+    summary_.count = stats_.Count();
+    summary_.mean = stats_.Mean();
+    summary_.variance = stats_.Variance();
+    summary_.min = stats_.Min();
+    summary_.max = stats_.Max();
+  }
+  return pairs;
+}
+
+TimeAlignment::Summary TimeAlignment::GetSummary() const {
+  boost::unique_lock<boost::mutex> lock(summary_mutex_);
+  return summary_;
+}
+
+void TimeAlignment::Drain(boost::lockfree::spsc_queue<double> &in,
+                          std::deque<double> &out) {
+  in.consume_all([&out](double time) { out.push_back(time); });
+}
+
+} // namespace bynav_gps_driver
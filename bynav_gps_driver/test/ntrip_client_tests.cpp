@@ -0,0 +1,137 @@
+#include <bynav_gps_driver/ntrip_client.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::vector<uint8_t> MakeRtcmFrame(uint16_t type, size_t payload_len) {
+  std::vector<uint8_t> frame;
+  frame.push_back(0xD3);
+  frame.push_back(static_cast<uint8_t>((payload_len >> 8) & 0x03));
+  frame.push_back(static_cast<uint8_t>(payload_len & 0xFF));
+  frame.push_back(static_cast<uint8_t>(type >> 4));
+  frame.push_back(static_cast<uint8_t>((type & 0x0F) << 4));
+  for (size_t i = 2; i < payload_len; i++) {
+    frame.push_back(static_cast<uint8_t>(i));
+  }
+
+  uint32_t crc = 0;
+  for (uint8_t byte : frame) {
+    crc = ((crc << 8) & 0xFFFFFF) ^
+          bynav_gps_driver::Rtcm::CRC24_TABLE[(crc >> 16) ^ byte];
+  }
+  frame.push_back(static_cast<uint8_t>(crc >> 16));
+  frame.push_back(static_cast<uint8_t>(crc >> 8));
+  frame.push_back(static_cast<uint8_t>(crc));
+  return frame;
+}
+
+// Minimal caster: accepts one client, checks the request, answers like a
+// NTRIP v1 caster and sends two frames split across writes.
+class MockCaster {
+public:
+  MockCaster()
+      : acceptor_(io_service_, boost::asio::ip::tcp::endpoint(
+                                   boost::asio::ip::address_v4::loopback(),
+                                   0)),
+        socket_(io_service_) {}
+
+  uint16_t Port() const { return acceptor_.local_endpoint().port(); }
+
+  void Serve(const std::vector<uint8_t> &stream) {
+    acceptor_.accept(socket_);
+
+    boost::asio::streambuf buf;
+    boost::asio::read_until(socket_, buf, "\r\n\r\n");
+    request_.assign(boost::asio::buffers_begin(buf.data()),
+                    boost::asio::buffers_end(buf.data()));
+
+    std::string ok = "ICY 200 OK\r\n";
+    boost::asio::write(socket_, boost::asio::buffer(ok));
+    size_t half = stream.size() / 2;
+    boost::asio::write(socket_, boost::asio::buffer(stream.data(), half));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    boost::asio::write(socket_, boost::asio::buffer(stream.data() + half,
+                                                    stream.size() - half));
+
+    boost::asio::streambuf gga;
+    boost::asio::read_until(socket_, gga, "\r\n");
+    gga_.assign(boost::asio::buffers_begin(gga.data()),
+                boost::asio::buffers_end(gga.data()));
+  }
+
+  std::string request_;
+  std::string gga_;
+
+private:
+  boost::asio::io_service io_service_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  boost::asio::ip::tcp::socket socket_;
+};
+
+} // namespace
+
+TEST(NtripClientTestSuite, testBase64Encode) {
+  EXPECT_EQ("dXNlcjpwYXNz",
+            bynav_gps_driver::NtripClient::Base64Encode("user:pass"));
+  EXPECT_EQ("YQ==", bynav_gps_driver::NtripClient::Base64Encode("a"));
+  EXPECT_EQ("YWI=", bynav_gps_driver::NtripClient::Base64Encode("ab"));
+}
+
+TEST(NtripClientTestSuite, testInjectsFramesFromCaster) {
+  std::vector<uint8_t> frame_a = MakeRtcmFrame(1074, 120);
+  std::vector<uint8_t> frame_b = MakeRtcmFrame(1006, 21);
+  std::vector<uint8_t> stream(frame_a);
+  stream.insert(stream.end(), frame_b.begin(), frame_b.end());
+
+  MockCaster caster;
+  std::thread server([&]() { caster.Serve(stream); });
+
+  std::mutex mutex;
+  std::vector<std::vector<uint8_t>> injected;
+
+  bynav_gps_driver::NtripClient client;
+  client.SetSink([&](const uint8_t *data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    injected.emplace_back(data, data + size);
+    return true;
+  });
+  client.SetGgaSentence("$GPGGA,134658.00,5106.9792,N,11402.3003,W,2,09,1.0,"
+                        "1048.47,M,-16.27,M,08,AAAA*60");
+
+  bynav_gps_driver::NtripClient::Config config;
+  config.host = "127.0.0.1";
+  config.port = caster.Port();
+  config.mountpoint = "MOUNT";
+  config.username = "user";
+  config.password = "pass";
+  config.gga_interval_s = 0.05;
+  ASSERT_TRUE(client.Start(config));
+
+  server.join();
+  for (int i = 0; i < 100 && client.FramesInjected() < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  client.Stop();
+
+  EXPECT_NE(std::string::npos, caster.request_.find("GET /MOUNT HTTP/1.1"));
+  EXPECT_NE(std::string::npos,
+            caster.request_.find("Authorization: Basic dXNlcjpwYXNz"));
+  EXPECT_EQ(0u, caster.gga_.find("$GPGGA,134658.00"));
+
+  ASSERT_EQ(2u, injected.size());
+  EXPECT_EQ(frame_a, injected[0]);
+  EXPECT_EQ(frame_b, injected[1]);
+  EXPECT_EQ(2u, client.FramesInjected());
+  EXPECT_EQ(stream.size(), client.BytesReceived());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -1,16 +1,36 @@
+#include <bynav_gps_driver/attitude_interpolator.h>
+#include <bynav_gps_driver/bynav_control.h>
 #include <bynav_gps_driver/bynav_message_extractor.h>
+#include <bynav_gps_driver/clock_model.h>
+#include <bynav_gps_driver/command_channel.h>
+#include <bynav_gps_driver/config_snapshot.h>
+#include <bynav_gps_driver/geodesy.h>
+#include <bynav_gps_driver/gps_time_sync.h>
+#include <bynav_gps_driver/imu_batcher.h>
+#include <bynav_gps_driver/imu_models.h>
+#include <bynav_gps_driver/ins_covariance.h>
+#include <bynav_gps_driver/log_manager.h>
+#include <bynav_gps_driver/log_planner.h>
+#include <bynav_gps_driver/pose_interpolator.h>
+#include <bynav_gps_driver/receiver_config.h>
+#include <bynav_gps_driver/reconnect_backoff.h>
 #include <bynav_gps_driver/parsers/bestpos.h>
 #include <bynav_gps_driver/parsers/gpgga.h>
 #include <bynav_gps_driver/parsers/gpgsv.h>
 #include <bynav_gps_driver/parsers/gphdt.h>
 #include <bynav_gps_driver/parsers/heading.h>
 #include <bynav_gps_driver/parsers/ptnlpjk.h>
+#include <bynav_gps_driver/rtcm_filter.h>
+#include <bynav_gps_driver/shm_refclock.h>
+#include <bynav_gps_driver/time_alignment.h>
 
 #include <bynav_gps_driver/parsers/corrimudata.h>
 #include <bynav_gps_driver/parsers/inscov.h>
 #include <bynav_gps_driver/parsers/inspva.h>
 #include <bynav_gps_driver/parsers/insstdev.h>
+#include <cmath>
 #include <gtest/gtest.h>
+#include <sys/shm.h>
 
 TEST(ParserTestSuite, testBestposAsciiParsing) {
   bynav_gps_driver::BestposParser parser;
@@ -341,6 +361,51 @@ TEST(ParserTestSuite, testInsstdevAsciiParsing) {
   ASSERT_EQ(26000005, msg->extended_solution_status.original_mask);
 }
 
+TEST(ParserTestSuite, testInscovAsciiParsing) {
+  bynav_gps_driver::InscovParser parser;
+  std::string sentence_str =
+      "#INSCOVA,COM1,0,66.5,FINESTEERING,1959,336623.000,02000020,f078,"
+      "32768;1959,336623.000000000,0.0211,-0.0013,0.0022,-0.0013,0.0184,"
+      "-0.0009,0.0022,-0.0009,0.0479,0.0007,0.0000,-0.0002,0.0000,0.0007,"
+      "0.0001,-0.0002,0.0001,0.0121,0.0002,-0.0000,0.0000,-0.0000,0.0003,"
+      "-0.0000,0.0000,-0.0000,0.0004*31825418\r\n";
+  std::string extracted_str;
+
+  bynav_gps_driver::BynavMessageExtractor extractor;
+
+  std::vector<bynav_gps_driver::NmeaSentence> nmea_sentences;
+  std::vector<bynav_gps_driver::BynavSentence> bynav_sentences;
+  std::vector<bynav_gps_driver::BinaryMessage> binary_messages;
+  std::vector<bynav_gps_driver::BinaryMicroMessage> binary_mirco_messages;
+  std::string remaining;
+
+  extractor.ExtractCompleteMessages(sentence_str, nmea_sentences,
+                                    bynav_sentences, binary_messages,
+                                    binary_mirco_messages, remaining);
+
+  ASSERT_EQ(0, nmea_sentences.size());
+  ASSERT_EQ(0, binary_messages.size());
+  ASSERT_EQ(1, bynav_sentences.size());
+
+  bynav_gps_driver::BynavSentence sentence = bynav_sentences.front();
+
+  ASSERT_EQ(parser.GetMessageName() + "A", sentence.id);
+
+  bynav_gps_msgs::InsCovPtr msg = parser.ParseAscii(sentence);
+
+  ASSERT_NE(msg.get(), nullptr);
+
+  ASSERT_EQ(1959, msg->week);
+  ASSERT_DOUBLE_EQ(336623.0, msg->seconds);
+  ASSERT_DOUBLE_EQ(0.0211, msg->position_covariance[0]);
+  ASSERT_DOUBLE_EQ(-0.0013, msg->position_covariance[1]);
+  ASSERT_DOUBLE_EQ(0.0479, msg->position_covariance[8]);
+  ASSERT_DOUBLE_EQ(0.0007, msg->attitude_covariance[0]);
+  ASSERT_DOUBLE_EQ(0.0121, msg->attitude_covariance[8]);
+  ASSERT_DOUBLE_EQ(0.0002, msg->velocity_covariance[0]);
+  ASSERT_DOUBLE_EQ(0.0004, msg->velocity_covariance[8]);
+}
+
 TEST(ParserTestSuite, testBestxyzAsciiParsing) {
   bynav_gps_driver::PtnlPJKParser parser;
   std::string ptnlpjk_str =
@@ -465,6 +530,777 @@ TEST(ParserTestSuite, testHeadingAsciiParsing) {
             msg->solution_source);
 }
 
+TEST(ParserTestSuite, testRtcmFilter) {
+  bynav_gps_driver::RtcmFilter filter;
+
+  // Without an allowed set every frame passes.
+  ASSERT_TRUE(filter.Pass(1077, 300, 0.0));
+
+  filter.Clear();
+  filter.AllowMessageType(1074);
+  filter.AllowMessageType(1006, 10.0);
+
+  ASSERT_TRUE(filter.Pass(1074, 200, 0.0));
+  ASSERT_FALSE(filter.Pass(1077, 300, 0.0));
+  ASSERT_TRUE(filter.Pass(1006, 27, 0.0));
+  ASSERT_FALSE(filter.Pass(1006, 27, 5.0));
+  ASSERT_TRUE(filter.Pass(1006, 27, 10.0));
+  ASSERT_TRUE(filter.Pass(1074, 200, 1.0));
+
+  const auto &stats = filter.GetStats();
+  ASSERT_EQ(2u, stats.at(1074).frames_passed);
+  ASSERT_EQ(400u, stats.at(1074).bytes_passed);
+  ASSERT_EQ(1u, stats.at(1077).frames_dropped);
+  ASSERT_EQ(300u, stats.at(1077).bytes_dropped);
+  ASSERT_EQ(2u, stats.at(1006).frames_passed);
+  ASSERT_EQ(1u, stats.at(1006).frames_dropped);
+  ASSERT_NE(std::string::npos, filter.BandwidthReport().find("RTCM1074"));
+}
+
+TEST(ParserTestSuite, testLogManagerHysteresis) {
+  bynav_gps_driver::LogManager logs(5.0);
+  logs.AddLog("inspvab", 0.01);
+  logs.AddLog("gpzda", 1.0, true);
+
+  // Only the always-on log is requested on connect.
+  bynav_gps_driver::BynavMessageOpts opts = logs.OnConnect(0.0);
+  ASSERT_EQ(1u, opts.size());
+  ASSERT_EQ(1u, opts.count("gpzda"));
+  ASSERT_TRUE(logs.Update(1.0).empty());
+
+  logs.SetWanted("inspvab", true);
+  std::vector<std::string> commands = logs.Update(2.0);
+  ASSERT_EQ(1u, commands.size());
+  ASSERT_EQ("log inspvab ontime 0.01\r\n", commands[0]);
+  ASSERT_TRUE(logs.IsLogged("inspvab"));
+
+  // A subscriber that leaves briefly doesn't unlog.
+  logs.SetWanted("inspvab", false);
+  ASSERT_TRUE(logs.Update(4.0).empty());
+  logs.SetWanted("inspvab", true);
+  ASSERT_TRUE(logs.Update(5.0).empty());
+
+  logs.SetWanted("inspvab", false);
+  ASSERT_TRUE(logs.Update(9.0).empty());
+  commands = logs.Update(10.0);
+  ASSERT_EQ(1u, commands.size());
+  ASSERT_EQ("unlog inspvab\r\n", commands[0]);
+  ASSERT_FALSE(logs.IsLogged("inspvab"));
+  ASSERT_TRUE(logs.IsLogged("gpzda"));
+  ASSERT_EQ(1u, logs.LoggedCount());
+}
+
+TEST(ParserTestSuite, testLogPlanner) {
+  bynav_gps_driver::LogPlanner::Config config;
+  config.baud = 115200;
+  config.satellites = 30;
+
+  // ASCII IMU and position logs only fit once switched to binary.
+  bynav_gps_driver::BynavMessageOpts opts;
+  opts["corrimudataa"] = 0.02;
+  opts["bestposa"] = 0.05;
+  opts["rangecmpb"] = 1.0;
+  bynav_gps_driver::LogPlanner::Plan plan =
+      bynav_gps_driver::LogPlanner(config).Build(opts);
+  ASSERT_TRUE(plan.feasible);
+  ASSERT_EQ(3u, plan.opts.size());
+  ASSERT_EQ(1u, plan.opts.count("corrimudatab"));
+  ASSERT_EQ(1u, plan.opts.count("bestposb"));
+  ASSERT_DOUBLE_EQ(1.0, plan.opts["rangecmpb"]);
+  ASSERT_LE(plan.Utilization(), config.max_utilization);
+
+  // Observations are decimated before the INS solution.
+  opts.clear();
+  opts["inspvab"] = 0.02;
+  opts["rangecmpb"] = 0.25;
+  plan = bynav_gps_driver::LogPlanner(config).Build(opts);
+  ASSERT_TRUE(plan.feasible);
+  ASSERT_DOUBLE_EQ(0.02, plan.opts["inspvab"]);
+  ASSERT_DOUBLE_EQ(0.5, plan.opts["rangecmpb"]);
+
+  config.baud = 9600;
+  opts.clear();
+  opts["corrimudatab"] = 0.01;
+  plan = bynav_gps_driver::LogPlanner(config).Build(opts);
+  ASSERT_FALSE(plan.feasible);
+  ASSERT_NE(std::string::npos, plan.Report().find("exceeds budget"));
+
+  // Pruning drops low priority logs, heaviest first, but never critical ones.
+  config.allow_pruning = true;
+  plan = bynav_gps_driver::LogPlanner(config).Build(opts);
+  ASSERT_FALSE(plan.feasible);
+  ASSERT_TRUE(plan.dropped.empty());
+
+  opts.clear();
+  opts["inspvab"] = 0.2;
+  opts["bestposb"] = 0.1;
+  opts["rangecmpb"] = 1.0;
+  opts["gpgsv"] = 1.0;
+  plan = bynav_gps_driver::LogPlanner(config).Build(opts);
+  ASSERT_TRUE(plan.feasible);
+  ASSERT_EQ(2u, plan.dropped.size());
+  ASSERT_EQ("rangecmpb", plan.dropped[0].requested_name);
+  ASSERT_EQ("gpgsv", plan.dropped[1].requested_name);
+  ASSERT_EQ(2u, plan.opts.size());
+  ASSERT_DOUBLE_EQ(0.2, plan.opts["inspvab"]);
+  ASSERT_EQ(1u, plan.opts.count("bestposb"));
+  ASSERT_NE(std::string::npos, plan.Report().find("gpgsv: dropped"));
+
+  // Network links are not budgeted.
+  config.serial = false;
+  plan = bynav_gps_driver::LogPlanner(config).Build(opts);
+  ASSERT_TRUE(plan.feasible);
+  ASSERT_EQ(opts, plan.opts);
+}
+
+TEST(ParserTestSuite, testReceiverConfigDiff) {
+  bynav_gps_driver::ReceiverConfig config;
+  ASSERT_EQ(2u, config.LoadRxConfig(
+                    "#RXCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,0;"
+                    "#SERIALCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,"
+                    "0;COM1,115200,N,8,1,N,OFF*5e3c6a41*b9d5b5b4\r\n"
+                    "#RXCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,0;"
+                    "#ECUTOFFA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,0;"
+                    "10.0*4aa3b2c1*0d6f2f32\r\n"
+                    "#RXCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,0;"
+                    "#LOGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,0;"
+                    "COM1,BESTPOSA,ONTIME,1.0*00000000*00000000\r\n"));
+  ASSERT_EQ("SERIALCONFIG COM1", bynav_gps_driver::ReceiverConfig::Key(
+                                     "SERIALCONFIG COM1 115200"));
+  ASSERT_EQ("SET OBSFREQ",
+            bynav_gps_driver::ReceiverConfig::Key("SET OBSFREQ 5"));
+
+  std::vector<std::string> wanted = {"SERIALCONFIG COM1 115200",
+                                     "SERIALCONFIG COM2 460800",
+                                     "ECUTOFF 10.000000", "SET OBSFREQ 5"};
+  std::vector<std::string> changes = config.Diff(wanted);
+  ASSERT_EQ(2u, changes.size());
+  ASSERT_EQ("SERIALCONFIG COM2 460800", changes[0]);
+  ASSERT_EQ("SET OBSFREQ 5", changes[1]);
+
+  for (const auto &command : changes) {
+    config.Set(command);
+  }
+  ASSERT_TRUE(config.Diff(wanted).empty());
+
+  config.Set("ECUTOFF 15");
+  ASSERT_EQ(1u, config.Diff(wanted).size());
+  ASSERT_EQ("ECUTOFF 15", config.Get("ECUTOFF"));
+}
+
+// Answers the RXCONFIG query and records what SetupConfig would send,
+// without a device.
+class FakeRxConfigControl : public bynav_gps_driver::BynavControl {
+public:
+  std::string rxconfig;
+  std::vector<std::string> sent;
+
+protected:
+  bool QueryRxConfig(std::string &out) override {
+    out = rxconfig;
+    return !rxconfig.empty();
+  }
+
+  bool SendCommands(const std::vector<std::string> &commands,
+                    size_t &applied) override {
+    sent.insert(sent.end(), commands.begin(), commands.end());
+    applied = commands.size();
+    return true;
+  }
+};
+
+TEST(ParserTestSuite, testReceiverConfigSeededFromRxConfig) {
+  FakeRxConfigControl control;
+  // Saving needs a device; keep it pending.
+  control.BeginConfigBatch();
+
+  bynav_gps_msgs::BynavConfig conf;
+  bynav_gps_msgs::SerialConfig serial;
+  serial.port = 1;
+  serial.bps = 115200;
+  conf.serials.push_back(serial);
+  serial.port = 2;
+  serial.bps = 460800;
+  conf.serials.push_back(serial);
+
+  // Nothing known yet, so everything is sent.
+  ASSERT_FALSE(control.RefreshReceiverConfig());
+  ASSERT_TRUE(control.SetupConfig(conf));
+  ASSERT_EQ(2u, control.sent.size());
+
+  control.sent.clear();
+  control.rxconfig =
+      "#RXCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,0;"
+      "#SERIALCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,"
+      "0;COM1,115200,N,8,1,N,OFF*5e3c6a41*b9d5b5b4\r\n"
+      "#RXCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,0;"
+      "#SERIALCONFIGA,COM1,0,0.0,UNKNOWN,0,0.000,00000000,0000,"
+      "0;COM2,9600,N,8,1,N,OFF*5e3c6a41*b9d5b5b4\r\n";
+  ASSERT_TRUE(control.RefreshReceiverConfig());
+  ASSERT_EQ(2u, control.GetReceiverConfig().Size());
+  ASSERT_TRUE(control.SetupConfig(conf));
+  ASSERT_EQ(1u, control.sent.size());
+  ASSERT_EQ("SERIALCONFIG COM2 460800", control.sent[0]);
+
+  control.sent.clear();
+  ASSERT_TRUE(control.SetupConfig(conf));
+  ASSERT_TRUE(control.sent.empty());
+}
+
+TEST(ParserTestSuite, testCommandChannel) {
+  std::vector<std::string> sent;
+  bynav_gps_driver::CommandChannel channel([&sent](const std::string &data) {
+    sent.push_back(data);
+    return true;
+  });
+  channel.SetTimeout(100, 1);
+
+  const int64_t ms = 1000000;
+  auto log = channel.Submit("log gpgga ontime 1\r\n", 0);
+  auto bad = channel.Submit("ecutoff abc", 0);
+  auto lost = channel.Submit("saveconfig", 0);
+  ASSERT_EQ(3u, sent.size());
+  ASSERT_EQ("log gpgga ontime 1\r\n", sent[0]);
+  ASSERT_EQ("ecutoff abc\r\n", sent[1]);
+
+  // Responses may be split across reads and mixed with logs.
+  std::string first = "$GPGGA,1*00\r\n<O";
+  std::string second = "K\r\n<VERSION COM1 0\r\n[COM1]<ERROR:Invalid\r\n";
+  ASSERT_EQ(0u, channel.Feed(reinterpret_cast<const uint8_t *>(first.data()),
+                             first.size(), 5 * ms));
+  ASSERT_EQ(2u, channel.Feed(reinterpret_cast<const uint8_t *>(second.data()),
+                             second.size(), 10 * ms));
+  ASSERT_EQ(bynav_gps_driver::CommandResult::OK, log.get().status);
+  ASSERT_EQ(10 * ms, log.get().latency_ns);
+  ASSERT_EQ(bynav_gps_driver::CommandResult::ERROR, bad.get().status);
+  ASSERT_EQ("ERROR:Invalid", bad.get().response);
+  ASSERT_EQ(1u, channel.Pending());
+
+  // One retry, then the command times out.
+  channel.Poll(50 * ms);
+  ASSERT_EQ(3u, sent.size());
+  channel.Poll(100 * ms);
+  ASSERT_EQ(4u, sent.size());
+  ASSERT_EQ("saveconfig\r\n", sent[3]);
+  channel.Poll(200 * ms);
+  ASSERT_EQ(bynav_gps_driver::CommandResult::TIMEOUT, lost.get().status);
+  ASSERT_EQ(2, lost.get().attempts);
+  ASSERT_EQ(0u, channel.Pending());
+  ASSERT_EQ(1u, channel.Timeouts());
+  ASSERT_EQ(1u, channel.Errors());
+}
+
+TEST(ParserTestSuite, testConfigSnapshot) {
+  // Kept on disk, so the hash must not change between builds.
+  ASSERT_EQ(0xaf63dc4c8601ec8cull, bynav_gps_driver::ConfigSnapshot::Hash("a"));
+  ASSERT_NE(bynav_gps_driver::ConfigSnapshot::HashCommands({"ab", "c"}),
+            bynav_gps_driver::ConfigSnapshot::HashCommands({"a", "bc"}));
+
+  char directory[] = "/tmp/bynav_snapshot_XXXXXX";
+  ASSERT_TRUE(mkdtemp(directory) != nullptr);
+
+  bynav_gps_driver::ConfigSnapshot snapshot;
+  bynav_gps_driver::ConfigSnapshot::Entry entry;
+  ASSERT_FALSE(snapshot.Store("/dev/ttyUSB0", entry));
+
+  snapshot.SetDirectory(std::string(directory) + "/cache");
+  ASSERT_EQ(std::string(directory) + "/cache/_dev_ttyUSB0.snapshot",
+            snapshot.FileName("/dev/ttyUSB0"));
+  ASSERT_FALSE(snapshot.Load("/dev/ttyUSB0", entry));
+
+  entry.desired = 0x0123456789abcdefull;
+  entry.receiver = 0xfedcba9876543210ull;
+  ASSERT_TRUE(snapshot.Store("/dev/ttyUSB0", entry));
+  bynav_gps_driver::ConfigSnapshot::Entry loaded;
+  ASSERT_TRUE(snapshot.Load("/dev/ttyUSB0", loaded));
+  ASSERT_EQ(entry.desired, loaded.desired);
+  ASSERT_EQ(entry.receiver, loaded.receiver);
+  ASSERT_FALSE(snapshot.Load("192.168.1.10:3001", loaded));
+
+  snapshot.Remove("/dev/ttyUSB0");
+  ASSERT_FALSE(snapshot.Load("/dev/ttyUSB0", loaded));
+}
+
+TEST(ParserTestSuite, testReconnectBackoff) {
+  bynav_gps_driver::ReconnectBackoff exact(0.5, 3.0, 0.0);
+  ASSERT_DOUBLE_EQ(0.5, exact.NextDelay());
+  ASSERT_DOUBLE_EQ(1.0, exact.NextDelay());
+  ASSERT_DOUBLE_EQ(2.0, exact.NextDelay());
+  ASSERT_DOUBLE_EQ(3.0, exact.NextDelay());
+  ASSERT_DOUBLE_EQ(3.0, exact.NextDelay());
+  ASSERT_EQ(5, exact.Attempts());
+  exact.Reset();
+  ASSERT_EQ(0, exact.Attempts());
+  ASSERT_DOUBLE_EQ(0.5, exact.NextDelay());
+
+  bynav_gps_driver::ReconnectBackoff jittered(1.0, 100.0, 0.25, 42);
+  bynav_gps_driver::ReconnectBackoff other(1.0, 100.0, 0.25, 43);
+  bool differs = false;
+  double base = 1.0;
+  for (int i = 0; i < 6; i++) {
+    double delay = jittered.NextDelay();
+    ASSERT_GE(delay, 0.75 * base);
+    ASSERT_LE(delay, 1.25 * base);
+    differs = differs || delay != other.NextDelay();
+    base *= 2.0;
+  }
+  ASSERT_TRUE(differs);
+}
+
+TEST(ParserTestSuite, testClockModel) {
+  bynav_gps_driver::ClockModel model;
+  double host_offset = 315964782.0;
+  double drift = 20e-6;
+  double latency = 0.005;
+  double gps_start = 2200 * 604800.0;
+  auto host_at = [&](double gps) {
+    return gps + host_offset + drift * (gps - gps_start);
+  };
+
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> jitter(0.0, 0.004);
+  double gps = gps_start;
+  for (int i = 0; i < 600; i++, gps += 0.05) {
+    double delay = latency + jitter(rng);
+    if (i % 37 == 0) {
+      delay += 0.05;
+    }
+    model.Update(gps, host_at(gps) + delay);
+  }
+  ASSERT_TRUE(model.Valid());
+  ASSERT_NEAR(drift * 1e6, model.DriftPpm(), 5.0);
+
+  double host_time = 0.0;
+  ASSERT_TRUE(model.ToHost(gps, host_time));
+  ASSERT_NEAR(host_at(gps) + latency, host_time, 0.0005);
+
+  // The host clock steps a second ahead; the model follows once it is
+  // clearly not a glitch.
+  host_offset += 1.0;
+  for (int i = 0; i < 300; i++, gps += 0.05) {
+    model.Update(gps, host_at(gps) + latency + jitter(rng));
+  }
+  ASSERT_EQ(1u, model.Resets());
+  ASSERT_TRUE(model.ToHost(gps, host_time));
+  ASSERT_NEAR(host_at(gps) + latency, host_time, 0.0005);
+
+  // A late log of an earlier epoch still lands in that epoch's slot.
+  model.Reset();
+  model.Update(gps, host_at(gps) + latency);
+  model.Update(gps + 0.25, host_at(gps + 0.25) + latency);
+  model.Update(gps, host_at(gps) + latency + 0.02);
+  ASSERT_EQ(2u, model.Samples());
+}
+
+TEST(ParserTestSuite, testTimeAlignment) {
+  bynav_gps_driver::WindowedStats stats(3);
+  stats.Add(1.0);
+  stats.Add(5.0);
+  stats.Add(3.0);
+  ASSERT_DOUBLE_EQ(3.0, stats.Mean());
+  ASSERT_DOUBLE_EQ(1.0, stats.Min());
+  ASSERT_DOUBLE_EQ(5.0, stats.Max());
+  stats.Add(2.0);
+  ASSERT_EQ(3u, stats.Count());
+  ASSERT_DOUBLE_EQ(2.0, stats.Min());
+  ASSERT_DOUBLE_EQ(5.0, stats.Max());
+  stats.Add(2.5);
+  ASSERT_DOUBLE_EQ(2.0, stats.Min());
+  ASSERT_DOUBLE_EQ(3.0, stats.Max());
+  ASSERT_NEAR(1.0 / 6.0, stats.Variance(), 1e-12);
+
+  bynav_gps_driver::TimeAlignment sync(2);
+  ASSERT_FALSE(sync.Synced());
+  // A message with no sync pulse, then two matched seconds and a pulse
+  // with no message.
+  sync.PushMeasurement(99.0);
+  sync.PushMeasurement(100.02);
+  sync.PushMeasurement(101.04);
+  ASSERT_EQ(0u, sync.Align());
+  sync.PushReference(100.0);
+  sync.PushReference(101.0);
+  sync.PushReference(101.4);
+  ASSERT_EQ(2u, sync.Align());
+  ASSERT_TRUE(sync.Synced());
+  ASSERT_NEAR(-0.03, sync.Offset(), 1e-9);
+  sync.PushMeasurement(102.01);
+  sync.PushReference(102.0);
+  ASSERT_EQ(1u, sync.Align());
+  ASSERT_NEAR(-0.025, sync.Offset(), 1e-9);
+
+  bynav_gps_driver::TimeAlignment::Summary summary = sync.GetSummary();
+  ASSERT_DOUBLE_EQ(102.0, summary.last_reference);
+  ASSERT_EQ(2u, summary.count);
+  ASSERT_NEAR(-0.04, summary.min, 1e-9);
+  ASSERT_NEAR(-0.01, summary.max, 1e-9);
+}
+
+TEST(ParserTestSuite, testShmRefclock) {
+  // Units 0 and 1 belong to the time daemon; use one anybody may write.
+  const int32_t unit = 9;
+  bynav_gps_driver::ShmRefclock writer;
+  bynav_gps_driver::ShmRefclock reader;
+  ASSERT_FALSE(writer.Open(-1));
+  ASSERT_TRUE(writer.Open(unit)) << writer.ErrorMsg();
+  ASSERT_TRUE(reader.Open(unit)) << reader.ErrorMsg();
+
+  writer.Publish(1700000000.25, 1700000000.2505);
+  double reference = 0.0;
+  double host = 0.0;
+  ASSERT_TRUE(reader.Read(reference, host));
+  ASSERT_NEAR(1700000000.25, reference, 1e-6);
+  ASSERT_NEAR(1700000000.2505, host, 1e-6);
+  ASSERT_EQ(1u, writer.Samples());
+
+  writer.Close();
+  reader.Close();
+  shmctl(shmget(bynav_gps_driver::ShmRefclock::BASE_KEY + unit, 0, 0),
+         IPC_RMID, nullptr);
+}
+
+TEST(ParserTestSuite, testGpsTimeSync) {
+  using bynav_gps_driver::GpsTimeSyncPolicy;
+  bynav_gps_driver::GpsTimeSync<4, int, char, double> sync;
+  bynav_gps_driver::GpsTimeSync<4, int, char, double>::Set set;
+
+  sync.Push<0>(2000, 10.0, 1);
+  sync.Push<0>(2000, 10.05, 2);
+  sync.Push<1>(2000, 10.05, 'b');
+  ASSERT_FALSE(sync.Pop(set));
+  sync.Push<2>(2000, 10.05, 2.5);
+  ASSERT_TRUE(sync.Pop(set));
+  ASSERT_EQ(2, std::get<0>(set));
+  ASSERT_EQ('b', std::get<1>(set));
+  ASSERT_DOUBLE_EQ(2.5, std::get<2>(set));
+  ASSERT_EQ(1u, sync.Drops(0));
+  ASSERT_EQ(1u, sync.Matched());
+
+  // Exact matching needs the same millisecond.
+  sync.Push<0>(2000, 10.1, 3);
+  sync.Push<1>(2000, 10.1, 'c');
+  sync.Push<2>(2000, 10.102, 3.5);
+  ASSERT_FALSE(sync.Pop(set));
+  ASSERT_EQ(0u, sync.Pending<0>());
+  sync.SetPolicy(GpsTimeSyncPolicy::APPROXIMATE, 0.01);
+  sync.Push<0>(2000, 10.101, 4);
+  sync.Push<1>(2000, 10.103, 'd');
+  ASSERT_TRUE(sync.Pop(set));
+  ASSERT_EQ(4, std::get<0>(set));
+
+  // A full ring loses its oldest message.
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ(i < 4, sync.Push<0>(2001, i, i));
+  }
+  int unmatched = 0;
+  ASSERT_TRUE(sync.PopUnmatched<0>(unmatched));
+  ASSERT_EQ(1, unmatched);
+  ASSERT_EQ(3u, sync.Drops(0));
+  ASSERT_EQ(4u, sync.Drops());
+}
+
+TEST(ParserTestSuite, testAttitudeInterpolator) {
+  using bynav_gps_driver::AttitudeInterpolator;
+  AttitudeInterpolator attitude;
+  AttitudeInterpolator::Quaternion q;
+  ASSERT_EQ(AttitudeInterpolator::PENDING, attitude.Lookup(100.0, q));
+
+  attitude.Add(100.0, AttitudeInterpolator::FromRollPitchYaw(0.0, 0.0, 0.0));
+  attitude.Add(100.1,
+               AttitudeInterpolator::FromRollPitchYaw(0.0, 0.0, M_PI / 2.0));
+  ASSERT_EQ(AttitudeInterpolator::UNAVAILABLE, attitude.Lookup(99.9, q));
+  ASSERT_EQ(AttitudeInterpolator::PENDING, attitude.Lookup(100.2, q));
+
+  // A quarter of the way through a 90 degree yaw.
+  ASSERT_EQ(AttitudeInterpolator::INTERPOLATED, attitude.Lookup(100.025, q));
+  ASSERT_NEAR(std::sin(M_PI / 16.0), q.z, 1e-9);
+  ASSERT_NEAR(std::cos(M_PI / 16.0), q.w, 1e-9);
+  ASSERT_NEAR(0.0, q.x, 1e-12);
+
+  ASSERT_TRUE(attitude.Hold(100.2, q));
+  ASSERT_NEAR(std::sin(M_PI / 4.0), q.z, 1e-9);
+
+  // Takes the short way between q and -q.
+  AttitudeInterpolator::Quaternion a = {0.0, 0.0, 0.0, 1.0};
+  AttitudeInterpolator::Quaternion b = {0.0, 0.0, 0.0, -1.0};
+  q = AttitudeInterpolator::Slerp(a, b, 0.5);
+  ASSERT_NEAR(1.0, std::fabs(q.w), 1e-9);
+}
+
+TEST(ParserTestSuite, testInsCovariance) {
+  using bynav_gps_driver::DEGREES_TO_RADIANS;
+  using bynav_gps_driver::InsCovariance;
+  InsCovariance covariance(2.0);
+  ASSERT_EQ(InsCovariance::NONE, covariance.GetSource());
+
+  bynav_gps_msgs::Insstdev insstdev;
+  insstdev.bynav_msg_header.gps_week_num = 2000;
+  insstdev.bynav_msg_header.gps_seconds = 100.0;
+  insstdev.latitude_dev = 0.5;
+  insstdev.longitude_dev = 0.25;
+  insstdev.height_dev = 1.0;
+  insstdev.north_velocity_dev = 0.5;
+  insstdev.east_velocity_dev = 0.25;
+  insstdev.up_velocity_dev = 1.0;
+  insstdev.roll_dev = 1.0;
+  insstdev.pitch_dev = 2.0;
+  insstdev.azimuth_dev = 4.0;
+  covariance.Update(insstdev);
+  ASSERT_EQ(InsCovariance::DIAGONAL, covariance.GetSource());
+  // Sigma squared, east first, attitude in radians as roll, pitch, yaw.
+  ASSERT_DOUBLE_EQ(0.0625, covariance.Position()[0]);
+  ASSERT_DOUBLE_EQ(0.25, covariance.Position()[4]);
+  ASSERT_DOUBLE_EQ(0.0, covariance.Position()[1]);
+  ASSERT_NEAR(DEGREES_TO_RADIANS * DEGREES_TO_RADIANS,
+              covariance.Attitude()[0], 1e-15);
+  ASSERT_NEAR(4.0 * DEGREES_TO_RADIANS * DEGREES_TO_RADIANS,
+              covariance.Attitude()[4], 1e-15);
+  ASSERT_NEAR(16.0 * DEGREES_TO_RADIANS * DEGREES_TO_RADIANS,
+              covariance.Attitude()[8], 1e-15);
+  ASSERT_DOUBLE_EQ(0.25, covariance.Velocity()[4]);
+  // The imu topic's x axis is the pitch axis.
+  double imu_attitude[9];
+  covariance.ImuAttitude(imu_attitude);
+  ASSERT_NEAR(4.0 * DEGREES_TO_RADIANS * DEGREES_TO_RADIANS, imu_attitude[0],
+              1e-15);
+  ASSERT_NEAR(DEGREES_TO_RADIANS * DEGREES_TO_RADIANS, imu_attitude[4],
+              1e-15);
+
+  bynav_gps_msgs::InsCov inscov;
+  inscov.week = 2000;
+  inscov.seconds = 101.0;
+  for (size_t i = 0; i < 9; i++) {
+    inscov.position_covariance[i] = 0.01 * i;
+    inscov.attitude_covariance[i] = 1.0 + i;
+    inscov.velocity_covariance[i] = 0.001 * i;
+  }
+  covariance.Update(inscov);
+  ASSERT_EQ(InsCovariance::FULL, covariance.GetSource());
+  ASSERT_DOUBLE_EQ(0.01, covariance.Position()[1]);
+  // INSCOV's attitude is about the IMU axes: x, the pitch axis, is the
+  // body's -y and y, the roll axis, its x.
+  const double DEG2 = DEGREES_TO_RADIANS * DEGREES_TO_RADIANS;
+  ASSERT_NEAR(5.0 * DEG2, covariance.Attitude()[0], 1e-15);
+  ASSERT_NEAR(-4.0 * DEG2, covariance.Attitude()[1], 1e-15);
+  ASSERT_NEAR(6.0 * DEG2, covariance.Attitude()[2], 1e-15);
+  ASSERT_NEAR(1.0 * DEG2, covariance.Attitude()[4], 1e-15);
+  ASSERT_NEAR(-3.0 * DEG2, covariance.Attitude()[5], 1e-15);
+  ASSERT_NEAR(9.0 * DEG2, covariance.Attitude()[8], 1e-15);
+  covariance.ImuAttitude(imu_attitude);
+  for (size_t i = 0; i < 9; i++) {
+    ASSERT_NEAR((1.0 + i) * DEG2, imu_attitude[i], 1e-15);
+  }
+
+  // INSSTDEV doesn't replace a recent INSCOV, but does replace a stale one.
+  insstdev.bynav_msg_header.gps_seconds = 102.0;
+  covariance.Update(insstdev);
+  ASSERT_EQ(InsCovariance::FULL, covariance.GetSource());
+  insstdev.bynav_msg_header.gps_seconds = 104.0;
+  covariance.Update(insstdev);
+  ASSERT_EQ(InsCovariance::DIAGONAL, covariance.GetSource());
+
+  // INSPVAX without std fields is ignored.
+  bynav_gps_msgs::Inspvax inspvax;
+  inspvax.bynav_msg_header.gps_week_num = 2000;
+  inspvax.bynav_msg_header.gps_seconds = 105.0;
+  covariance.Update(inspvax);
+  ASSERT_DOUBLE_EQ(0.0625, covariance.Position()[0]);
+}
+
+TEST(ParserTestSuite, testPoseInterpolator) {
+  using bynav_gps_driver::PoseInterpolator;
+  PoseInterpolator poses(0.1);
+  PoseInterpolator::Pose pose;
+  ASSERT_EQ(PoseInterpolator::PENDING, poses.Lookup(100.0, pose));
+
+  PoseInterpolator::Pose a = {30.0, 179.9999, 10.0, 1.0, 0.0, 0.0,
+                              0.0,  1.0,      359.0};
+  PoseInterpolator::Pose b = {30.0001, -179.9999, 12.0, 3.0, 0.0, 0.0,
+                              0.0,     2.0,       1.0};
+  poses.Add(100.0, a);
+  poses.Add(100.05, b);
+  ASSERT_EQ(PoseInterpolator::UNAVAILABLE, poses.Lookup(99.99, pose));
+  ASSERT_EQ(PoseInterpolator::PENDING, poses.Lookup(100.06, pose));
+
+  // Halfway, across the antimeridian and through north.
+  ASSERT_EQ(PoseInterpolator::INTERPOLATED, poses.Lookup(100.025, pose));
+  ASSERT_NEAR(30.00005, pose.latitude, 1e-9);
+  ASSERT_NEAR(180.0, std::fabs(pose.longitude), 1e-9);
+  ASSERT_NEAR(11.0, pose.height, 1e-9);
+  ASSERT_NEAR(2.0, pose.north_velocity, 1e-9);
+  ASSERT_NEAR(1.5, pose.pitch, 1e-9);
+  ASSERT_NEAR(0.0, std::remainder(pose.azimuth, 360.0), 1e-9);
+  ASSERT_GE(pose.azimuth, 0.0);
+
+  ASSERT_EQ(PoseInterpolator::INTERPOLATED, poses.Lookup(100.05, pose));
+  ASSERT_DOUBLE_EQ(12.0, pose.height);
+
+  // A dropped epoch leaves a gap that is not interpolated across.
+  poses.Add(100.25, b);
+  ASSERT_EQ(PoseInterpolator::UNAVAILABLE, poses.Lookup(100.15, pose));
+}
+
+TEST(ParserTestSuite, testImuBatcher) {
+  bynav_gps_driver::ImuBatcher batcher(3, 0.05);
+  const double gyro[3] = {0.1, 0.2, 0.3};
+  const double accel[3] = {0.0, 0.0, 9.8};
+  ASSERT_FALSE(batcher.Add(ros::Time(10.0), 2000, 1.0, 7, gyro, accel));
+  ASSERT_FALSE(batcher.Add(ros::Time(10.01), 2000, 1.01, 7, gyro, accel));
+  std::unique_ptr<bynav_gps_msgs::ImuArray> batch =
+      batcher.Add(ros::Time(10.02), 2000, 1.02, 7, gyro, accel);
+  ASSERT_TRUE(batch);
+  ASSERT_EQ(3u, batch->time_offsets.size());
+  ASSERT_NEAR(0.02, batch->time_offsets[2], 1e-9);
+  ASSERT_EQ(9u, batch->angular_velocity.size());
+  ASSERT_DOUBLE_EQ(0.3, batch->angular_velocity[5]);
+  ASSERT_DOUBLE_EQ(9.8, batch->linear_acceleration[8]);
+  ASSERT_DOUBLE_EQ(1.0, batch->gps_seconds);
+  ASSERT_EQ(0u, batcher.Pending());
+
+  // Latency closes a batch before it is full.
+  ASSERT_FALSE(batcher.Add(ros::Time(11.0), 2000, 2.0, 7, gyro, accel));
+  batch = batcher.Add(ros::Time(11.06), 2000, 2.06, 7, gyro, accel);
+  ASSERT_TRUE(batch);
+  ASSERT_EQ(2u, batch->imu_status.size());
+
+  bynav_gps_msgs::RawIMU raw;
+  raw.x_gyro = 1 << 20;
+  raw.z_accel = -(1 << 24);
+  double rates[3];
+  double accels[3];
+  bynav_gps_driver::RawImuToSi<bynav_gps_driver::ImuModelAdis16488>(
+      raw, 200.0, rates, accels);
+  ASSERT_NEAR(720.0 / 2048.0 * M_PI / 180.0, rates[0], 1e-12);
+  ASSERT_NEAR(-200.0 / 128.0, accels[2], 1e-12);
+  bynav_gps_driver::RawImuToSi<bynav_gps_driver::ImuModelHg1700Ag58>(
+      raw, 100.0, rates, accels);
+  ASSERT_NEAR(100.0 / 8192.0, rates[0], 1e-12);
+}
+
+TEST(ParserTestSuite, testGeodesy) {
+  using bynav_gps_driver::DEGREES_TO_RADIANS;
+  double ecef[3];
+  bynav_gps_driver::GeodeticToEcef(0.0, 0.0, 0.0, ecef);
+  ASSERT_NEAR(6378137.0, ecef[0], 1e-6);
+  bynav_gps_driver::GeodeticToEcef(M_PI / 2.0, 0.0, 0.0, ecef);
+  ASSERT_NEAR(6356752.314245, ecef[2], 1e-6);
+
+  bynav_gps_driver::EnuFrame frame;
+  ASSERT_FALSE(frame.HasOrigin());
+  double lat = 45.0 * DEGREES_TO_RADIANS;
+  double lon = 10.0 * DEGREES_TO_RADIANS;
+  frame.SetOrigin(lat, lon, 100.0);
+  ASSERT_TRUE(frame.HasOrigin());
+
+  double enu[3];
+  frame.GeodeticToEnu(lat, lon, 150.0, enu);
+  ASSERT_NEAR(0.0, enu[0], 1e-6);
+  ASSERT_NEAR(0.0, enu[1], 1e-6);
+  ASSERT_NEAR(50.0, enu[2], 1e-6);
+
+  // About 111 m per millidegree of latitude here, and cos(45) of that east.
+  frame.GeodeticToEnu(lat + 0.001 * DEGREES_TO_RADIANS, lon, 100.0, enu);
+  ASSERT_NEAR(0.0, enu[0], 1e-6);
+  ASSERT_NEAR(111.13, enu[1], 0.01);
+  frame.GeodeticToEnu(lat, lon + 0.001 * DEGREES_TO_RADIANS, 100.0, enu);
+  ASSERT_NEAR(78.85, enu[0], 0.01);
+  ASSERT_NEAR(0.0, enu[1], 0.01);
+
+  double height;
+  frame.EnuToGeodetic(enu, lat, lon, height);
+  ASSERT_NEAR(45.0, lat / DEGREES_TO_RADIANS, 1e-12);
+  ASSERT_NEAR(10.001, lon / DEGREES_TO_RADIANS, 1e-12);
+  ASSERT_NEAR(100.0, height, 1e-6);
+
+  // Reference values from PROJ 9.5.1 through pyproj 3.7.2:
+  //   Transformer.from_crs("EPSG:4979", "EPSG:4978", always_xy=True)
+  //       .transform(lon, lat, height)
+  double lats[2] = {39.906217 * DEGREES_TO_RADIANS,
+                    -45.25 * DEGREES_TO_RADIANS};
+  double lons[2] = {116.3912757 * DEGREES_TO_RADIANS,
+                    -70.5 * DEGREES_TO_RADIANS};
+  double heights[2] = {43.5, 1200.0};
+  double x[2];
+  double y[2];
+  double z[2];
+  bynav_gps_driver::GeodeticToEcef(2, lats, lons, heights, x, y, z);
+  ASSERT_NEAR(-2177789.724308, x[0], 1e-6);
+  ASSERT_NEAR(4388806.787323, y[0], 1e-6);
+  ASSERT_NEAR(4070031.125155, z[0], 1e-6);
+  ASSERT_NEAR(1501712.592414, x[1], 1e-6);
+  ASSERT_NEAR(-4240705.540188, y[1], 1e-6);
+  ASSERT_NEAR(-4507803.648126, z[1], 1e-6);
+
+  bynav_gps_driver::EcefToGeodetic(2, x, y, z, x, y, z);
+  for (int i = 0; i < 2; i++) {
+    ASSERT_NEAR(lats[i], x[i], 1e-14);
+    ASSERT_NEAR(lons[i], y[i], 1e-14);
+    ASSERT_NEAR(heights[i], z[i], 1e-8);
+  }
+}
+
+TEST(ParserTestSuite, testTransverseMercator) {
+  using bynav_gps_driver::DEGREES_TO_RADIANS;
+  using bynav_gps_driver::TransverseMercator;
+  // Reference values from PROJ 9.5.1 through pyproj 3.7.2:
+  //   Transformer.from_crs("EPSG:4326", target, always_xy=True)
+  //       .transform(lon, lat)
+  // with target EPSG:32613 and EPSG:32750 for the UTM zones, and
+  // "+proj=tmerc +lon_0=117 +k=0.99923 +x_0=500000 +a=6378245 +rf=298.3"
+  // and "+proj=tmerc +lon_0=114 +lat_0=22.3 +x_0=800000 +y_0=800000
+  // +ellps=WGS84" for the PJK and local grids.
+  ASSERT_EQ(13, TransverseMercator::UtmZone(-105.0 * DEGREES_TO_RADIANS));
+  ASSERT_EQ(50, TransverseMercator::UtmZone(117.2 * DEGREES_TO_RADIANS));
+  TransverseMercator utm13n = TransverseMercator::Utm(13, true);
+  double northing;
+  double easting;
+  utm13n.Forward(40.0 * DEGREES_TO_RADIANS, -105.0 * DEGREES_TO_RADIANS,
+                 northing, easting);
+  ASSERT_NEAR(4427757.218738, northing, 1e-6);
+  ASSERT_NEAR(500000.0, easting, 1e-6);
+  utm13n.Forward(45.25 * DEGREES_TO_RADIANS, -103.5 * DEGREES_TO_RADIANS,
+                 northing, easting);
+  ASSERT_NEAR(5011817.212824, northing, 1e-6);
+  ASSERT_NEAR(617707.604258, easting, 1e-6);
+
+  double lat;
+  double lon;
+  utm13n.Inverse(northing, easting, lat, lon);
+  ASSERT_NEAR(45.25, lat / DEGREES_TO_RADIANS, 1e-12);
+  ASSERT_NEAR(-103.5, lon / DEGREES_TO_RADIANS, 1e-12);
+
+  TransverseMercator utm50s = TransverseMercator::Utm(50, false);
+  utm50s.Forward(-33.9 * DEGREES_TO_RADIANS, 117.2 * DEGREES_TO_RADIANS,
+                 northing, easting);
+  ASSERT_NEAR(6248913.733599, northing, 1e-6);
+  ASSERT_NEAR(518491.195410, easting, 1e-6);
+
+  // SET PJKPARA 6378245 298.3 2.042035225 0 0 500000 [0.99923 EHT]
+  TransverseMercator pjk = TransverseMercator::FromPjk(
+      6378245.0, 298.3, 117.0 * DEGREES_TO_RADIANS, 0.0, 0.0, 500000.0,
+      0.99923);
+  double lats[2] = {39.5 * DEGREES_TO_RADIANS, 22.0 * DEGREES_TO_RADIANS};
+  double lons[2] = {118.1 * DEGREES_TO_RADIANS, 115.0 * DEGREES_TO_RADIANS};
+  double northings[2];
+  double eastings[2];
+  pjk.Forward(2, lats, lons, northings, eastings);
+  ASSERT_NEAR(4371300.759999, northings[0], 1e-6);
+  ASSERT_NEAR(594544.611890, eastings[0], 1e-6);
+  pjk.Inverse(2, northings, eastings, northings, eastings);
+  for (int i = 0; i < 2; i++) {
+    ASSERT_NEAR(lats[i], northings[i], 1e-14);
+    ASSERT_NEAR(lons[i], eastings[i], 1e-14);
+  }
+
+  // A grid whose origin is off the equator.
+  TransverseMercator local(bynav_gps_driver::WGS84,
+                           114.0 * DEGREES_TO_RADIANS,
+                           22.3 * DEGREES_TO_RADIANS, 800000.0, 800000.0, 1.0);
+  local.Forward(22.28 * DEGREES_TO_RADIANS, 114.17 * DEGREES_TO_RADIANS,
+                northing, easting);
+  ASSERT_NEAR(797795.170056, northing, 1e-6);
+  ASSERT_NEAR(817519.914109, easting, 1e-6);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
 